@@ -0,0 +1,453 @@
+/*
+ * Micro benchmarks of the frame conversions and frame io.
+ *
+ * Each benchmark is run at the resolutions of the supported cameras (see frameSizes),
+ * use --benchmark_filter to select a subset, e.g. --benchmark_filter=Export.
+ */
+
+#include "imageframe.h"
+#include "cameragrabber.h"
+#include "framepixmap.h"
+#include "framequeue.h"
+
+#include "LibStevi/imageProcessing/colorConversions.h"
+
+#include <benchmark/benchmark.h>
+
+#include <librealsense2/hpp/rs_internal.hpp>
+#include <opencv2/core.hpp>
+
+#include <QApplication>
+#include <QTemporaryDir>
+#include <QDir>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+QTemporaryDir* benchmarkDir = nullptr;
+
+QString benchmarkFilePath(QString const& name) {
+	return QDir(benchmarkDir->path()).filePath(name);
+}
+
+/*!
+ * \brief syntheticFrame generate a frame owning its pixels, filled with a gradient.
+ */
+ImageFrame syntheticFrame(ImageFrame::ImgType type, int h, int w, int c = 3) {
+
+	switch (type) {
+	case ImageFrame::GRAY_8: {
+		std::vector<uint8_t> data(h*w);
+		for (int i = 0; i < h*w; i++) {
+			data[i] = static_cast<uint8_t>(i % 251);
+		}
+		return ImageFrame(data.data(), Multidim::Array<uint8_t,2>::ShapeBlock{h,w}, Multidim::Array<uint8_t,2>::ShapeBlock{w,1}, true);
+	}
+	case ImageFrame::GRAY_16: {
+		std::vector<uint16_t> data(h*w);
+		for (int i = 0; i < h*w; i++) {
+			data[i] = static_cast<uint16_t>((i*97) & 0xFFFF);
+		}
+		return ImageFrame(data.data(), Multidim::Array<uint16_t,2>::ShapeBlock{h,w}, Multidim::Array<uint16_t,2>::ShapeBlock{w,1}, true);
+	}
+	case ImageFrame::GRAY_F32: {
+		std::vector<float> data(h*w);
+		for (int i = 0; i < h*w; i++) {
+			data[i] = static_cast<float>(i % 1021)/1021.f;
+		}
+		return ImageFrame(data.data(), Multidim::Array<float,2>::ShapeBlock{h,w}, Multidim::Array<float,2>::ShapeBlock{w,1}, true);
+	}
+	case ImageFrame::MULTICHANNEL_8: {
+		std::vector<uint8_t> data(h*w*c);
+		for (int i = 0; i < h*w*c; i++) {
+			data[i] = static_cast<uint8_t>(i % 253);
+		}
+		return ImageFrame(data.data(), Multidim::Array<uint8_t,3>::ShapeBlock{h,w,c}, Multidim::Array<uint8_t,3>::ShapeBlock{c*w,c,1}, true);
+	}
+	default:
+		return ImageFrame();
+	}
+}
+
+void frameSizes(benchmark::internal::Benchmark* b) {
+	b->Args({480, 640});
+	b->Args({480, 848});
+	b->Args({720, 1280});
+	b->Args({1080, 1920});
+}
+
+void setProcessedBytes(benchmark::State& state, ImageFrame const& frame) {
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations())*frame.payloadBytes());
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_CopyConstruction(benchmark::State& state) {
+
+	ImageFrame frame = syntheticFrame(type, state.range(0), state.range(1), c);
+
+	for (auto _ : state) {
+		ImageFrame copy(frame);
+		benchmark::DoNotOptimize(copy);
+	}
+
+	setProcessedBytes(state, frame);
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_DeepCopy(benchmark::State& state) {
+
+	ImageFrame frame = syntheticFrame(type, state.range(0), state.range(1), c);
+
+	for (auto _ : state) {
+		ImageFrame copy = frame.deepCopy();
+		benchmark::DoNotOptimize(copy);
+	}
+
+	setProcessedBytes(state, frame);
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_PayloadCrc32c(benchmark::State& state) {
+
+	ImageFrame frame = syntheticFrame(type, state.range(0), state.range(1), c);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(frame.payloadCrc32c());
+	}
+
+	setProcessedBytes(state, frame);
+}
+
+/*!
+ * \brief The SoftwareCamera class produce a realsense frame from a software device, so that no camera is needed.
+ */
+class SoftwareCamera {
+public:
+
+	SoftwareCamera(int h, int w, rs2_format format, int bpp) :
+		_pixels(h*w*bpp, 42)
+	{
+		rs2::software_sensor sensor = _dev.add_sensor("benchmark");
+
+		rs2_intrinsics intrinsics = {};
+		intrinsics.width = w;
+		intrinsics.height = h;
+		intrinsics.fx = w;
+		intrinsics.fy = w;
+		intrinsics.ppx = w/2.f;
+		intrinsics.ppy = h/2.f;
+
+		rs2_video_stream stream = {};
+		stream.type = (format == RS2_FORMAT_RGB8) ? RS2_STREAM_COLOR : RS2_STREAM_INFRARED;
+		stream.index = 1;
+		stream.uid = 0;
+		stream.width = w;
+		stream.height = h;
+		stream.fps = 30;
+		stream.bpp = bpp;
+		stream.fmt = format;
+		stream.intrinsics = intrinsics;
+
+		rs2::stream_profile profile = sensor.add_video_stream(stream);
+
+		sensor.open(profile);
+		sensor.start(_queue);
+
+		rs2_software_video_frame frame = {};
+		frame.pixels = _pixels.data();
+		frame.deleter = [] (void*) {};
+		frame.stride = w*bpp;
+		frame.bpp = bpp;
+		frame.timestamp = 0;
+		frame.domain = RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK;
+		frame.frame_number = 0;
+		frame.profile = profile.get();
+
+		sensor.on_video_frame(frame);
+
+		_frame = _queue.wait_for_frame();
+	}
+
+	rs2::frame const& frame() const {
+		return _frame;
+	}
+
+protected:
+
+	std::vector<uint8_t> _pixels;
+	rs2::software_device _dev;
+	rs2::frame_queue _queue;
+	rs2::frame _frame;
+};
+
+template<rs2_format format, int bpp>
+void BM_RealsenseFrameToImageFrame(benchmark::State& state) {
+
+	SoftwareCamera camera(state.range(0), state.range(1), format, bpp);
+
+	for (auto _ : state) {
+		ImageFrame frame = realsenseFrameToImageFrame(camera.frame());
+		benchmark::DoNotOptimize(frame);
+	}
+}
+
+template<int cvType>
+void BM_CvFrameToImageFrame(benchmark::State& state) {
+
+	cv::Mat mat(state.range(0), state.range(1), cvType, cv::Scalar::all(42));
+
+	for (auto _ : state) {
+		ImageFrame frame = cvFrameToImageFrame(mat);
+		benchmark::DoNotOptimize(frame);
+	}
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_ImageFrameToQPixmap(benchmark::State& state) {
+
+	ImageFrame frame = syntheticFrame(type, state.range(0), state.range(1), c);
+
+	for (auto _ : state) {
+		QPixmap pixmap = imageFrameToQPixmap(frame);
+		benchmark::DoNotOptimize(pixmap);
+	}
+
+	setProcessedBytes(state, frame);
+}
+
+void BM_Yuyv2Rgb(benchmark::State& state) {
+
+	ImageFrame frame = syntheticFrame(ImageFrame::MULTICHANNEL_8, state.range(0), state.range(1), 2);
+
+	for (auto _ : state) {
+		Multidim::Array<uint8_t,3> rgb = StereoVision::ImageProcessing::yuyv2rgb<uint8_t,3>(*frame.multichannels8());
+		benchmark::DoNotOptimize(rgb);
+	}
+
+	setProcessedBytes(state, frame);
+}
+
+void BM_Yvyu2Rgb(benchmark::State& state) {
+
+	ImageFrame frame = syntheticFrame(ImageFrame::MULTICHANNEL_8, state.range(0), state.range(1), 2);
+
+	for (auto _ : state) {
+		Multidim::Array<uint8_t,3> rgb = StereoVision::ImageProcessing::yvyu2rgb<uint8_t,3>(*frame.multichannels8());
+		benchmark::DoNotOptimize(rgb);
+	}
+
+	setProcessedBytes(state, frame);
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void saveBenchmark(benchmark::State& state, QString const& extension) {
+
+	ImageFrame frame = syntheticFrame(type, state.range(0), state.range(1), c);
+	QString path = benchmarkFilePath("save" + extension);
+
+	for (auto _ : state) {
+		if (!frame.save(path, false)) {
+			state.SkipWithError("Failed to save the frame");
+			break;
+		}
+	}
+
+	setProcessedBytes(state, frame);
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void readBenchmark(benchmark::State& state, QString const& extension) {
+
+	ImageFrame frame = syntheticFrame(type, state.range(0), state.range(1), c);
+	QString path = benchmarkFilePath("read" + extension);
+
+	if (!frame.save(path, false)) {
+		state.SkipWithError("Failed to save the frame");
+		return;
+	}
+
+	for (auto _ : state) {
+		ImageFrame read(path);
+		if (!read.isValid()) {
+			state.SkipWithError("Failed to read the frame");
+			break;
+		}
+	}
+
+	setProcessedBytes(state, frame);
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_StevimgWrite(benchmark::State& state) {
+	saveBenchmark<type, c>(state, ".stevimg");
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_StevimgRead(benchmark::State& state) {
+	readBenchmark<type, c>(state, ".stevimg");
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_RawFrameWrite(benchmark::State& state) {
+	saveBenchmark<type, c>(state, ImageFrame::rawFrameExtension);
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_RawFrameRead(benchmark::State& state) {
+	readBenchmark<type, c>(state, ImageFrame::rawFrameExtension);
+}
+
+template<ImageFrame::ImgType type, int c = 3>
+void BM_PngExport(benchmark::State& state) {
+	saveBenchmark<type, c>(state, ".png");
+}
+
+/*!
+ * \brief BM_SpscQueue pass frame handles from a producer thread to the benchmark thread.
+ */
+template<QueueWaiter::Strategy strategy>
+void BM_SpscQueue(benchmark::State& state) {
+
+	ImageFrame frame = syntheticFrame(ImageFrame::GRAY_8, 480, 848);
+	SpscQueue<ImageFrame> queue(state.range(0), strategy);
+
+	std::thread producer([&queue, &frame] () {
+		while (queue.push(frame)) {
+		}
+	});
+
+	ImageFrame received;
+
+	for (auto _ : state) {
+		queue.pop(received);
+	}
+
+	queue.close();
+
+	while (queue.tryPop(received)) { //release the remaining frames
+	}
+
+	producer.join();
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+template<QueueWaiter::Strategy strategy>
+void BM_MpscQueue(benchmark::State& state) {
+
+	ImageFrame frame = syntheticFrame(ImageFrame::GRAY_8, 480, 848);
+	MpscQueue<ImageFrame> queue(16, strategy);
+
+	std::vector<std::thread> producers;
+
+	for (int i = 0; i < state.range(0); i++) {
+		producers.emplace_back([&queue, &frame] () {
+			while (queue.push(frame)) {
+			}
+		});
+	}
+
+	ImageFrame received;
+
+	for (auto _ : state) {
+		queue.pop(received);
+	}
+
+	queue.close();
+
+	while (queue.tryPop(received)) {
+	}
+
+	for (std::thread & producer : producers) {
+		producer.join();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_CopyConstruction, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_CopyConstruction, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_CopyConstruction, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+
+BENCHMARK_TEMPLATE(BM_DeepCopy, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_DeepCopy, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_DeepCopy, ImageFrame::GRAY_F32)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_DeepCopy, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+
+BENCHMARK_TEMPLATE(BM_PayloadCrc32c, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_PayloadCrc32c, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_PayloadCrc32c, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+
+BENCHMARK_TEMPLATE(BM_RealsenseFrameToImageFrame, RS2_FORMAT_Y8, 1)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_RealsenseFrameToImageFrame, RS2_FORMAT_Y16, 2)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_RealsenseFrameToImageFrame, RS2_FORMAT_RGB8, 3)->Apply(frameSizes);
+
+BENCHMARK_TEMPLATE(BM_CvFrameToImageFrame, CV_8UC3)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_CvFrameToImageFrame, CV_16UC1)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_CvFrameToImageFrame, CV_32FC1)->Apply(frameSizes);
+
+// GRAY_F32 frames are not displayed, imageFrameToQPixmap does not support them.
+BENCHMARK_TEMPLATE(BM_ImageFrameToQPixmap, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_ImageFrameToQPixmap, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_ImageFrameToQPixmap, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_ImageFrameToQPixmap, ImageFrame::MULTICHANNEL_8, 4)->Apply(frameSizes);
+
+BENCHMARK(BM_Yuyv2Rgb)->Apply(frameSizes);
+BENCHMARK(BM_Yvyu2Rgb)->Apply(frameSizes);
+
+BENCHMARK_TEMPLATE(BM_StevimgWrite, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_StevimgWrite, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_StevimgWrite, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_StevimgRead, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_StevimgRead, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_StevimgRead, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+
+BENCHMARK_TEMPLATE(BM_RawFrameWrite, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_RawFrameWrite, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_RawFrameWrite, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_RawFrameRead, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_RawFrameRead, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_RawFrameRead, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+
+BENCHMARK_TEMPLATE(BM_PngExport, ImageFrame::GRAY_8)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_PngExport, ImageFrame::GRAY_16)->Apply(frameSizes);
+BENCHMARK_TEMPLATE(BM_PngExport, ImageFrame::MULTICHANNEL_8, 3)->Apply(frameSizes);
+
+// spinning is only meaningful with a core per thread.
+BENCHMARK_TEMPLATE(BM_SpscQueue, QueueWaiter::Spin)->Arg(4)->Arg(64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SpscQueue, QueueWaiter::Yield)->Arg(4)->Arg(64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SpscQueue, QueueWaiter::Block)->Arg(4)->Arg(64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MpscQueue, QueueWaiter::Yield)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MpscQueue, QueueWaiter::Block)->Arg(2)->Arg(4)->UseRealTime();
+
+int main(int argc, char** argv) {
+
+	// QPixmap requires a gui application, but no display is needed.
+	if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+
+	QApplication app(argc, argv);
+
+	QTemporaryDir tmpDir;
+
+	if (!tmpDir.isValid()) {
+		return 1;
+	}
+
+	benchmarkDir = &tmpDir;
+
+	benchmark::Initialize(&argc, argv);
+
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+		return 1;
+	}
+
+	benchmark::RunSpecifiedBenchmarks();
+
+	return 0;
+}
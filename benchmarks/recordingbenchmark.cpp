@@ -0,0 +1,310 @@
+/*
+ * End to end benchmark of the recording pipeline.
+ *
+ * Synthetic framesets are produced by a SimulatedCamera, wrapped in ImageFrames the same way the camera
+ * drivers do (without copy), and fed to a FrameRecorder saving continuously, like CameraApplication does
+ * while recording. The saved frames are then exported with the FrameEncoders (png by default, see --export-format).
+ *
+ * Example: recordingbenchmark --width 1280 --height 720 --fps 90 --streams 3 --duration 20 --writer iouring
+ */
+
+#include "framerecorder.h"
+#include "frameencoders.h"
+#include "simulatedcamera.h"
+#include "framememory.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QDir>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+struct CpuTimes {
+	double user;
+	double system;
+};
+
+CpuTimes processCpuTimes() {
+
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	CpuTimes ret;
+	ret.user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec*1e-6;
+	ret.system = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec*1e-6;
+	return ret;
+}
+
+/*!
+ * \brief wrapFrame create a frame pointing to the pixels of source, as the camera drivers do with their buffers.
+ */
+ImageFrame wrapFrame(ImageFrame const& source) {
+
+	switch (source.imgType()) {
+	case ImageFrame::GRAY_8: {
+		Multidim::Array<uint8_t, 2>* img = source.grayscale8();
+		return ImageFrame(&img->atUnchecked(0,0), img->shape(), img->strides(), false);
+	}
+	case ImageFrame::GRAY_16: {
+		Multidim::Array<uint16_t, 2>* img = source.grayscale16();
+		return ImageFrame(&img->atUnchecked(0,0), img->shape(), img->strides(), false);
+	}
+	case ImageFrame::GRAY_F32: {
+		Multidim::Array<float, 2>* img = source.grayscalef32();
+		return ImageFrame(&img->atUnchecked(0,0), img->shape(), img->strides(), false);
+	}
+	case ImageFrame::MULTICHANNEL_8: {
+		Multidim::Array<uint8_t, 3>* img = source.multichannels8();
+		return ImageFrame(&img->atUnchecked(0,0,0), img->shape(), img->strides(), false);
+	}
+	default:
+		return ImageFrame();
+	}
+}
+
+double percentile(std::vector<double> const& sorted, double p) {
+
+	if (sorted.empty()) {
+		return 0;
+	}
+
+	size_t idx = static_cast<size_t>(p*(sorted.size()-1) + 0.5);
+	return sorted[std::min(idx, sorted.size()-1)];
+}
+
+qint64 folderBytes(QDir const& folder, QStringList const& filters) {
+
+	qint64 ret = 0;
+
+	for (QFileInfo const& info : folder.entryInfoList(filters, QDir::Files)) {
+		ret += info.size();
+	}
+
+	return ret;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("RealSenseNirFramesRecorderBenchmark");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmark the capture to disk path of the recorder with synthetic frames.");
+	parser.addHelpOption();
+
+	QCommandLineOption widthOption("width", "Width of the frames.", "pixels", "848");
+	QCommandLineOption heightOption("height", "Height of the frames.", "pixels", "480");
+	QCommandLineOption fpsOption("fps", "Rate of the simulated camera.", "fps", "30");
+	QCommandLineOption streamsOption("streams", "Number of streams: 1 (left), 2 (left and right) or 3 (left, right and rgb).", "n", "3");
+	QCommandLineOption nirFormatOption("nir-format", "Format of the infrared frames: y8 or y16.", "format", "y8");
+	QCommandLineOption durationOption("duration", "Duration of the recording, in seconds.", "seconds", "10");
+	QCommandLineOption writerOption("writer", "Writer backend: stevimg, pwrite or iouring.", "backend", "stevimg");
+	QCommandLineOption directIoOption("directio", "Use O_DIRECT with the pwrite and iouring backends.");
+	QCommandLineOption buffersOption("writer-buffers", "Number of buffers of the frame writer.", "n", "32");
+	QCommandLineOption hugePagesOption("hugepages", "Pages used for the frame buffers: none, thp or hugetlb.", "pages", "none");
+	QCommandLineOption numaOption("numa", "Allocate the frame buffers on the NUMA node of the threads using them.");
+	QCommandLineOption durabilityOption("durability", "Sync of the frames at each checkpoint: fdatasync, syncfs or none.", "mode", "fdatasync");
+	QCommandLineOption outputOption("output", "Folder to record in, a temporary folder by default.", "folder");
+	QCommandLineOption exportFormatOption("export-format", "Format of the exported frames: png, tiff, pnm or jpeg.", "format", "png");
+	QCommandLineOption pngLevelOption("png-level", "Zlib level of the exported png frames, 0 to 9.", "level", "1");
+	QCommandLineOption pngFilterOption("png-filter", "Row filter of the exported png frames: none, sub, up, avg, paeth or all.", "filter", "sub");
+	QCommandLineOption noExportOption("no-export", "Skip the export of the recorded frames.");
+	QCommandLineOption keepOption("keep", "Keep the recorded and exported files.");
+
+	parser.addOptions({widthOption, heightOption, fpsOption, streamsOption, nirFormatOption, durationOption,
+					   writerOption, directIoOption, buffersOption, hugePagesOption, numaOption, durabilityOption,
+					   outputOption, exportFormatOption, pngLevelOption, pngFilterOption, noExportOption, keepOption});
+
+	parser.process(app);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	SimulatedCamera::Config camConfig;
+	camConfig.width = parser.value(widthOption).toInt();
+	camConfig.height = parser.value(heightOption).toInt();
+	camConfig.fps = parser.value(fpsOption).toDouble();
+	camConfig.nirFormat = (parser.value(nirFormatOption) == "y16") ? SimulatedCamera::Y16 : SimulatedCamera::Y8;
+
+	int nStreams = std::max(1, std::min(3, parser.value(streamsOption).toInt()));
+	camConfig.withRgb = nStreams >= 3;
+
+	double duration = parser.value(durationOption).toDouble();
+
+	if (camConfig.width <= 0 or camConfig.height <= 0 or camConfig.fps <= 0 or duration <= 0) {
+		err << "Invalid resolution, fps or duration" << endl;
+		return 1;
+	}
+
+	QTemporaryDir tmpDir;
+	QDir outFolder;
+
+	if (parser.isSet(outputOption)) {
+		outFolder.setPath(parser.value(outputOption));
+		if (!outFolder.exists() and !outFolder.mkpath(".")) {
+			err << "Could not create the output folder " << outFolder.absolutePath() << endl;
+			return 1;
+		}
+	} else {
+		if (!tmpDir.isValid()) {
+			err << "Could not create a temporary folder" << endl;
+			return 1;
+		}
+		tmpDir.setAutoRemove(!parser.isSet(keepOption));
+		outFolder.setPath(tmpDir.path());
+	}
+
+	SimulatedCamera camera(camConfig);
+
+	if (!camera.start()) {
+		err << "Could not generate the synthetic frames" << endl;
+		return 1;
+	}
+
+	QString pages = parser.value(hugePagesOption);
+	FrameMemory::PagePolicy pagePolicy = FrameMemory::DefaultPages;
+
+	if (pages == "thp") {
+		pagePolicy = FrameMemory::TransparentHugePages;
+	} else if (pages == "hugetlb") {
+		pagePolicy = FrameMemory::HugeTlbPages;
+	}
+
+	FrameMemory::configure(pagePolicy, parser.isSet(numaOption));
+
+	FrameRecorder::Config recConfig;
+	recConfig.writerBackend = parser.value(writerOption);
+	recConfig.directIo = parser.isSet(directIoOption);
+	recConfig.writerBuffers = parser.value(buffersOption).toInt();
+	recConfig.durability = parser.value(durabilityOption);
+
+	FrameRecorder recorder;
+	recorder.setOutputFolder(outFolder);
+
+	qint64 frameSetIndex = 0;
+	recorder.setTimeSource([&frameSetIndex] () {
+		// one ms resolution timestamps would collide above 1000 fps, so use a synthetic clock.
+		return static_cast<qint64>(1600000000000) + frameSetIndex;
+	});
+
+	recorder.start(recConfig, static_cast<int>(camConfig.fps));
+	recorder.saveFramesContinuous();
+
+	const qint64 nFrameSets = static_cast<qint64>(duration*camConfig.fps);
+
+	std::vector<double> latenciesUs;
+	latenciesUs.reserve(nFrameSets);
+
+	qint64 payloadBytes = 0;
+
+	CpuTimes cpuStart = processCpuTimes();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (frameSetIndex = 0; frameSetIndex < nFrameSets; frameSetIndex++) {
+
+		camera.treatNextFrame([&] (ImageFrame const& left, ImageFrame const& right, ImageFrame const& rgb) {
+
+			std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+			ImageFrame frameLeft = wrapFrame(left);
+			ImageFrame frameRight = (nStreams >= 2) ? wrapFrame(right) : ImageFrame();
+			ImageFrame frameRGB = (nStreams >= 3) ? wrapFrame(rgb) : ImageFrame();
+
+			recorder.receiveFrames(frameLeft, frameRight, frameRGB, ImageFrame());
+
+			std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - frameStart;
+			latenciesUs.push_back(latency.count());
+
+			payloadBytes += frameLeft.payloadBytes() + frameRight.payloadBytes() + frameRGB.payloadBytes();
+		});
+	}
+
+	std::chrono::steady_clock::time_point acquisitionEnd = std::chrono::steady_clock::now();
+
+	recorder.stop(); //wait for the pending writes.
+
+	std::chrono::steady_clock::time_point recordEnd = std::chrono::steady_clock::now();
+	CpuTimes cpuRecord = processCpuTimes();
+
+	std::chrono::duration<double> acquisitionTime = acquisitionEnd - start;
+	std::chrono::duration<double> recordTime = recordEnd - start;
+	std::chrono::duration<double> drainTime = recordEnd - acquisitionEnd;
+
+	std::sort(latenciesUs.begin(), latenciesUs.end());
+
+	QStringList recordedFilters = {"*.stevimg", "*" + ImageFrame::rawFrameExtension};
+	qint64 writtenBytes = folderBytes(outFolder, recordedFilters);
+	QStringList recorded = outFolder.entryList(recordedFilters, QDir::Files, QDir::Name);
+
+	double cpuTime = (cpuRecord.user - cpuStart.user) + (cpuRecord.system - cpuStart.system);
+
+	out << "Recording (" << camConfig.width << "x" << camConfig.height << ", " << nStreams << " streams, "
+		<< camConfig.fps << " fps, writer " << recConfig.writerBackend << ((recConfig.directIo) ? ", O_DIRECT" : "")
+		<< ", pages " << FrameMemory::pagePolicyName(pagePolicy) << ((parser.isSet(numaOption)) ? ", NUMA" : "") << "):\n";
+	out << "\tframesets: " << nFrameSets << " (" << camera.lateFrames() << " late)\n";
+	out << "\tsustained rate: " << nFrameSets/recordTime.count() << " fps (" << drainTime.count() << " s to drain the writer)\n";
+	out << "\treceiveFrames latency: p50 " << percentile(latenciesUs, 0.5)
+		<< " us, p95 " << percentile(latenciesUs, 0.95)
+		<< " us, p99 " << percentile(latenciesUs, 0.99)
+		<< " us, max " << ((latenciesUs.empty()) ? 0. : latenciesUs.back()) << " us\n";
+	out << "\tcpu: " << cpuRecord.user - cpuStart.user << " s user, " << cpuRecord.system - cpuStart.system << " s system ("
+		<< 100*cpuTime/recordTime.count() << " % of one core)\n";
+	out << "\tpayload: " << payloadBytes/(1024.*1024.) << " MB, written: " << writtenBytes/(1024.*1024.) << " MB in "
+		<< recorded.size() << " files (" << writtenBytes/(1024.*1024.)/recordTime.count() << " MB/s)\n";
+	out << "\tacquisition loop: " << acquisitionTime.count() << " s" << endl;
+
+	if (parser.isSet(noExportOption)) {
+		return 0;
+	}
+
+	std::chrono::steady_clock::time_point exportStart = std::chrono::steady_clock::now();
+
+	FrameEncoders::Settings encoderSettings;
+	encoderSettings.format = parser.value(exportFormatOption);
+	encoderSettings.pngLevel = std::max(0, std::min(9, parser.value(pngLevelOption).toInt()));
+	encoderSettings.pngFilter = parser.value(pngFilterOption);
+
+	FrameEncoders::Config encodersConfig;
+
+	for (QString const& stream : FrameEncoders::streams()) {
+		encodersConfig.streams.insert(stream, encoderSettings);
+	}
+
+	FrameEncoders encoders(encodersConfig);
+
+	int nExported = 0;
+
+	for (QString const& file : recorded) {
+
+		ImageFrame frame(outFolder.filePath(file));
+		QString outPath;
+
+		if (frame.isValid() and encoders.encode(frame, FrameEncoders::streamOfFile(file), outFolder.filePath(QFileInfo(file).baseName()), outPath)) {
+			nExported++;
+		}
+	}
+
+	std::chrono::duration<double> exportTime = std::chrono::steady_clock::now() - exportStart;
+	CpuTimes cpuExport = processCpuTimes();
+
+	qint64 exportedBytes = folderBytes(outFolder, {"*.png", "*.tiff", "*.pgm", "*.ppm", "*.jpg"});
+
+	out << "Export (" << encoderSettings.format << "):\n";
+	out << "\tframes: " << nExported << "/" << recorded.size() << " in " << exportTime.count() << " s ("
+		<< nExported/exportTime.count() << " frames/s)\n";
+	out << "\tcpu: " << (cpuExport.user - cpuRecord.user) + (cpuExport.system - cpuRecord.system) << " s\n";
+	out << "\twritten: " << exportedBytes/(1024.*1024.) << " MB" << endl;
+
+	return (nExported == recorded.size()) ? 0 : 1;
+}
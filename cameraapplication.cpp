@@ -2,12 +2,24 @@
 
 #include "cameraslist.h"
 #include "cameragrabber.h"
+#include "framerecorder.h"
+#include "frameexporter.h"
 #include "mainwindow.h"
 #include "consolewatcher.h"
 #include "remotesyncserver.h"
 #include "remotesyncclient.h"
 #include "remoteconnectionlist.h"
 #include "v4l2camera.h"
+#include "threadtuning.h"
+#include "framememory.h"
+#include "streamprofiles.h"
+#include "sessioncatalog.h"
+#include "sessionjournal.h"
+#include "videoexporter.h"
+#include "logging.h"
+#include "metricsserver.h"
+#include "frameverifier.h"
+#include "frameinfostable.h"
 
 #include <QApplication>
 #include <QDateTime>
@@ -17,12 +29,14 @@
 #include <QTemporaryDir>
 #include <QUdpSocket>
 #include <QSettings>
+#include <QSet>
 
-#include <QDebug>
 
 #include <vlc/vlc.h>
 
-#include "LibStevi/imageProcessing/colorConversions.h"
+#include <cmath>
+#include <algorithm>
+#include <thread>
 
 CameraApplication* CameraApplication::CurrentApp = nullptr;
 
@@ -33,12 +47,17 @@ CameraApplication* CameraApplication::GetCameraApp() {
 CameraApplication::CameraApplication(int &argc, char **argv) :
 	QObject(nullptr),
 	_sessionTimingFile(nullptr),
-	_saving_imgs(false),
+	_previewQueue(2, QueueWaiter::Yield),
 	_rs(nullptr),
-	_time_server_address()
+	_time_server_address(),
+	_clockOffsetMs(0),
+	_captureQueueStats(std::make_shared<CaptureQueueStats>()),
+	_metricsThread(nullptr),
+	_metrics(nullptr)
 {
 
 	configureSettings();
+	AsyncLogSink::install(AsyncLogSink::Config::fromSettings());
 
 	_isHeadLess = false;
 	_isServer = false;
@@ -71,6 +90,22 @@ CameraApplication::CameraApplication(int &argc, char **argv) :
 	_imgFolder.setPath(settings.value("io/imagefolder", _imgFolder.absolutePath()).toString());
 	settings.setValue("io/imagefolder", _imgFolder.absolutePath());
 
+	_recorder = new FrameRecorder(this);
+	_recorder->setOutputFolder(_imgFolder);
+	_recorder->setTimeSource([this] () { return getTimeMs(); });
+
+	recoverInterruptedSessions();
+
+	_exporter = new FrameExporter(this);
+	_exporter->setYieldCondition([this] () {
+		// exporting competes with the recording for the disk, it waits while the recording cannot keep up.
+		return _recorder->isSaving() and !_recorder->monitor().estimate().sustainable;
+	});
+	_exporter->setFrameExportedCallback([this] (QString const& framePath) {
+		// the exported frames are gone, the session journal must not try to sync them.
+		_recorder->frameRemoved(framePath);
+	});
+
 	_prefferedCamera = 0;
 	_lst = new CamerasList(this);
 	_lst->refreshCamerasList();
@@ -78,7 +113,12 @@ CameraApplication::CameraApplication(int &argc, char **argv) :
 	_remoteConnections = new RemoteConnectionList(this);
 	_pingTimer = new QTimer(this);
 
-	_imgsToSave = 0;
+	_statusWatchTimer = new QTimer(this);
+	connect(_statusWatchTimer, &QTimer::timeout, this, &CameraApplication::printStatus);
+
+	_cameraFps = 30;
+	_acquisitionStartSaved = 0;
+	_acquisitionStartFailed = 0;
 
 	_QtApp = getAppPointer(argc, argv);
 	CurrentApp = this;
@@ -86,6 +126,7 @@ CameraApplication::CameraApplication(int &argc, char **argv) :
 	_mw = nullptr;
 
 	connect(this, &CameraApplication::triggerStopRecording, this, &CameraApplication::stopRecording, Qt::QueuedConnection);
+	connect(_recorder, &FrameRecorder::recordingWarningRaised, this, &CameraApplication::reportRecordingWarning, Qt::QueuedConnection);
 
 	_vlc = libvlc_new (0, NULL);
 
@@ -115,7 +156,14 @@ CameraApplication::~CameraApplication() {
 		delete _rs;
 	}
 
+	if (_metricsThread != nullptr) {
+		_metricsThread->quit();
+		_metricsThread->wait();
+	}
+
 	delete _QtApp;
+
+	AsyncLogSink::uninstall();
 }
 
 QCoreApplication* CameraApplication::getAppPointer(int &argc, char **argv) {
@@ -134,6 +182,7 @@ bool CameraApplication::isHeadLess() const
 
 
 int CameraApplication::exec() {
+	configureMetricsServer();
 	configureMainWindow();
 	configureConsoleWatcher();
 	configureApplicationServer();
@@ -146,6 +195,13 @@ void CameraApplication::setExportDir(QString const& outPath) {
 	QDir out(outPath);
 	QTextStream outstream(stdout);
 
+	// the catalog and journal of the running session stay in the current folder, and the recovery of a folder
+	// must never run on the live session.
+	if (isRecording()) {
+		reportRecordingWarning("Not changing the output folder while recording !");
+		return;
+	}
+
 	if (out.exists()) {
 
 		if (out.canonicalPath() == _imgFolder.canonicalPath()) {
@@ -154,6 +210,8 @@ void CameraApplication::setExportDir(QString const& outPath) {
 			}
 		} else {
 			_imgFolder = out;
+			_recorder->setOutputFolder(_imgFolder);
+			recoverInterruptedSessions();
 			Q_EMIT outFolderChanged(out.path());
 			if (_mw == nullptr) {
 				outstream << "Output folder set to " << out.path() << endl;
@@ -188,10 +246,22 @@ bool CameraApplication::useTcpTimeSync() const {
 	return settings.value("network/usetcptimesync", false).toBool();
 }
 
+void CameraApplication::setPreTriggerDuration(double seconds) {
+	QSettings settings;
+	settings.setValue("io/pretriggerseconds", std::max(0., seconds));
+
+	_recorder->setPreTriggerDuration(seconds);
+}
+double CameraApplication::preTriggerDuration() const {
+	QSettings settings;
+	return settings.value("io/pretriggerseconds", 0.).toDouble();
+}
+
 void CameraApplication::startRecordSession() {
 
 	if (_sessionTimingFile != nullptr) {
 		_sessionTimingFile->close();
+		delete _sessionTimingFile;
 		_sessionTimingFile = nullptr;
 	}
 
@@ -204,8 +274,9 @@ void CameraApplication::startRecordSession() {
 
 		_sessionTimingFile = new QFile(sessionTimingFileName);
 
-		if (!_sessionTimingFile->open(QIODevice::WriteOnly)) {
-			qDebug() << "Failed to create file" << sessionTimingFileName;
+		// each line is written as soon as it is received, so that a crash cannot leave more than a partial line.
+		if (!_sessionTimingFile->open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+			qCWarning(lcApp) << "Failed to create file" << sessionTimingFileName;
 			delete _sessionTimingFile;
 			_sessionTimingFile = nullptr;
 		} else {
@@ -222,6 +293,10 @@ void CameraApplication::startRecordSession() {
 		startRecording(-1);
 	}
 
+	if (_sessionTimingFile != nullptr and _recorder->isStarted()) {
+		_recorder->addSessionFile(sessionTimingFileName);
+	}
+
 	for (int i = 0; i < _remoteConnections->rowCount(); i++) {
 		_remoteConnections->getConnectionAtRow(i)->startRecording(-1);
 	}
@@ -255,13 +330,86 @@ void CameraApplication::startRecording(int prow) {
 	std::string sn = _lst->serialNumber(row);
 
 	_img_grab = new CameraGrabber(this);
+	_img_grab->setQueueStats(_captureQueueStats);
+
+	QSettings settings;
+
+	QString simulatedSource = _lst->simulatedSource(row);
+	QString playbackFile = _lst->playbackFile(row);
+
+	if (!simulatedSource.isEmpty()) {
 
-	if (isRealSense) {
+		SimulatedCamera::Config config;
+		config.source = (simulatedSource == "replay") ? SimulatedCamera::Replay : SimulatedCamera::Pattern;
+		config.replayFolder = settings.value("simulation/replayfolder", "").toString();
+
+		QString nirFormat = settings.value("simulation/nirformat", "y8").toString().toLower();
+		config.nirFormat = (nirFormat == "y16") ? SimulatedCamera::Y16 : ((nirFormat == "none") ? SimulatedCamera::NoNir : SimulatedCamera::Y8);
+		config.withRgb = settings.value("simulation/rgb", true).toBool();
+		config.width = settings.value("simulation/width", 848).toInt();
+		config.height = settings.value("simulation/height", 480).toInt();
+		config.fps = settings.value("simulation/fps", 30.).toDouble();
+
+		settings.setValue("simulation/nirformat", nirFormat);
+		settings.setValue("simulation/rgb", config.withRgb);
+		settings.setValue("simulation/width", config.width);
+		settings.setValue("simulation/height", config.height);
+		settings.setValue("simulation/fps", config.fps);
+
+		_img_grab->setSimulationConfig(config);
+
+		_cameraFps = static_cast<int>(std::ceil(config.fps));
+
+	} else if (!playbackFile.isEmpty()) {
+
+		int fps = CameraGrabber::playbackFps(playbackFile);
+
+		if (fps <= 0) {
+			delete _img_grab;
+			_img_grab = nullptr;
+			manageAcquisitionError(QString("Unable to play back %1").arg(playbackFile));
+			return;
+		}
+
+		CameraGrabber::PlaybackConfig config;
+		config.file = playbackFile;
+		config.realTime = settings.value("playback/realtime", config.realTime).toBool();
+		config.loop = settings.value("playback/loop", config.loop).toBool();
+
+		settings.setValue("playback/realtime", config.realTime);
+		settings.setValue("playback/loop", config.loop);
+
+		_img_grab->setPlaybackConfig(config);
+
+		_cameraFps = fps;
+
+	} else if (isRealSense) {
+
+		QString serial = QString::fromStdString(sn);
+		StreamProfiles::Config profiles = StreamProfiles::load(serial);
+		QString error;
+
+		if (!StreamProfiles::validate(serial, profiles, error)) {
+			delete _img_grab;
+			_img_grab = nullptr;
+			manageAcquisitionError(QString("Invalid stream profiles: %1").arg(error));
+			return;
+		}
 
 		rs2::config config;
 		config.enable_device(sn);
 
-		_img_grab->setConfig(config);
+		_img_grab->setConfig(config, profiles);
+
+		bool recordBag = settings.value("realsense/recordbag", false).toBool();
+		settings.setValue("realsense/recordbag", recordBag);
+
+		if (recordBag) {
+			QString timestamp = QDateTime::currentDateTime().toString("yyyy_MM_dd_hh_mm_ss_zzz");
+			_img_grab->setBagRecordingFile(_recorder->outputFolder().filePath("capture_" + timestamp + "_" + serial + ".bag"));
+		}
+
+		_cameraFps = StreamProfiles::maxFps(profiles);
 
 	} else {
 
@@ -270,10 +418,31 @@ void CameraApplication::startRecording(int prow) {
 
 		_img_grab->setV4l2descr(descr);
 		_img_grab->setV4L2Config(config);
+
+		_cameraFps = settings.value("v4l2/fps", 30).toInt();
+	}
+
+	FrameMemory::configureFromSettings();
+	configureIncrementalExport();
+	_recorder->setFrameSetParts(_img_grab->frameSetParts());
+
+	FrameRecorder::Config recorderConfig = FrameRecorder::Config::fromSettings();
+	recorderConfig.frameSetIdInNames = _img_grab->usePlayback();
+
+	_recorder->start(recorderConfig, _cameraFps);
+
+	_acquisitionStartSaved = 0;
+	_acquisitionStartFailed = 0;
+
+	for (FrameRecorder::StreamStats const& stream : _recorder->streamStats()) {
+		_acquisitionStartSaved += stream.saved;
+		_acquisitionStartFailed += stream.failed;
 	}
 
 	connect(_img_grab, &CameraGrabber::framesReady, this, &CameraApplication::receiveFrames, Qt::DirectConnection);
+	connect(_img_grab, &CameraGrabber::frameSetPartReady, this, &CameraApplication::receiveFrameSetPart, Qt::DirectConnection);
 	connect(_img_grab, &CameraGrabber::acquisitionEndedWithError, this, &CameraApplication::manageAcquisitionError);
+	connect(_img_grab, &CameraGrabber::acquisitionFinished, this, &CameraApplication::manageAcquisitionFinished);
 
 	_img_grab->start();
 }
@@ -336,32 +505,28 @@ void CameraApplication::saveInterval(int nFrames, int msec) {
 void CameraApplication::saveLocalFrames(int nFrames) {
 
 	if (isRecording()) {
-		if (nFrames > 0) {
-			_saveAcessControl.lock();
-			_imgsToSave += nFrames;
-			_saveAcessControl.unlock();
-		}
+		_recorder->saveFrames(nFrames);
 	}
 }
 void CameraApplication::saveLocalFrames() {
 	if (isRecording()) {
-		_saveAcessControl.lock();
-		_saving_imgs = true;
-		_saveAcessControl.unlock();
+		if (!admitContinuousSave()) {
+			return;
+		}
+
+		_recorder->saveFramesContinuous();
 	}
 }
 
 void CameraApplication::stopSaveLocalFrames() {
-	_saveAcessControl.lock();
-	_imgsToSave = 0;
-	_saving_imgs = false;
-	_saveAcessControl.unlock();
+	_recorder->stopSaveFrames();
 }
 
 void CameraApplication::stopRecordSession() {
 
 	if (_sessionTimingFile != nullptr) {
 		_sessionTimingFile->close();
+		delete _sessionTimingFile;
 		_sessionTimingFile = nullptr;
 	}
 
@@ -379,6 +544,10 @@ void CameraApplication::stopRecordSession() {
 }
 void CameraApplication::stopRecording() {
 
+	if (_img_grab == nullptr) {
+		return;
+	}
+
 	if (_mw == nullptr) {
 		QTextStream out(stdout);
 		out << "Acquisition terminated !" << endl;
@@ -386,11 +555,31 @@ void CameraApplication::stopRecording() {
 
 	_img_grab->finish();
 	disconnect(_img_grab, &CameraGrabber::framesReady, this, &CameraApplication::receiveFrames);
+	disconnect(_img_grab, &CameraGrabber::frameSetPartReady, this, &CameraApplication::receiveFrameSetPart);
 	disconnect(_img_grab, &CameraGrabber::acquisitionEndedWithError, this, &CameraApplication::manageAcquisitionError);
+	disconnect(_img_grab, &CameraGrabber::acquisitionFinished, this, &CameraApplication::manageAcquisitionFinished);
 	_img_grab->wait();
 	_img_grab->deleteLater();
 
 	_img_grab = nullptr;
+
+	_recorder->stop();
+}
+
+void CameraApplication::recoverInterruptedSessions() {
+
+	SessionJournal::RecoveryReport report = SessionJournal::recoverSessions(_imgFolder);
+
+	if (report.sessions == 0) {
+		return;
+	}
+
+	QTextStream out(stdout);
+	out << "Recovered " << report.sessions << " interrupted recording session(s) in " << _imgFolder.path() << ": "
+		<< report.keptFrames << " frames kept, "
+		<< report.recoveredFrames << " frames added to the catalogs, "
+		<< report.removedFrames << " partial frames removed, "
+		<< report.truncatedFiles << " files truncated" << endl;
 }
 
 void CameraApplication::exportRecording() {
@@ -408,60 +597,189 @@ void CameraApplication::exportRecorded() {
 	QTextStream out(stdout);
 
 	if (isRecording()) {
-		out << "Not exporting while recording !" << endl;
+		if (_exporter->config().incremental) {
+			out << "Frames are exported incrementally while recording" << endl;
+		} else {
+			out << "Not exporting while recording !" << endl;
+		}
 		return;
 	}
 
-	QList<QString> exported = _imgFolder.entryList({"*.stevimg"});
+	// the frames notified to the incremental exporter are not exported twice.
+	_exporter->waitUntilIdle();
+
+	FrameEncoders::Config encodersConfig = FrameEncoders::Config::fromSettings();
+
+	QStringList toExport;
+	QMap<QString, QVector<VideoExporter::Frame>> videos; //the frames of the streams exported as videos, by video base path.
+	QStringList catalogs = SessionCatalog::listCatalogs(_imgFolder);
+
+	QSet<QString> cataloged; //the frames listed by a catalog, the other frames of the folder are found by the scan.
+
+	for (QString const& catalogPath : catalogs) {
+
+		SessionCatalog::Index index;
+
+		if (!index.load(catalogPath)) {
+			out << "Could not read the session catalog " << catalogPath << ", its frames are exported as uncataloged frames" << endl;
+			continue;
+		}
+
+		QString sessionBasePath = _imgFolder.filePath(QFileInfo(catalogPath).completeBaseName());
+
+		for (SessionCatalog::Entry const& entry : index.entries()) {
+			QString framePath = index.framePath(entry);
+			cataloged.insert(QFileInfo(framePath).fileName());
+
+			if (!QFile::exists(framePath)) { //already exported
+				continue;
+			}
+
+			if (encodersConfig.settings(entry.stream).format == "video") {
+				videos[sessionBasePath + "_" + entry.stream].push_back({framePath, entry.timeMs});
+			} else {
+				toExport << framePath;
+			}
+		}
+	}
+
+	// sessions recorded without catalog (io/catalog=false) can share the folder with cataloged sessions.
+	for (QString const& file : _imgFolder.entryList({"*.stevimg", "*" + ImageFrame::rawFrameExtension}, QDir::Files, QDir::Name)) {
+
+		if (cataloged.contains(file)) {
+			continue;
+		}
+
+		QString stream = FrameEncoders::streamOfFile(file);
+
+		if (encodersConfig.settings(stream).format == "video") {
+			QDateTime time = QDateTime::fromString(QFileInfo(file).baseName().left(23), "yyyy_MM_dd_hh_mm_ss_zzz");
+			videos[_imgFolder.filePath("recording_" + stream)].push_back({_imgFolder.filePath(file), time.toMSecsSinceEpoch()});
+		} else {
+			toExport << _imgFolder.filePath(file);
+		}
+	}
 
 	out << "Exporting !" << endl;
-	for (QString& file : exported) {
-        QFileInfo info(_imgFolder.filePath(file));
-
-		if (info.exists()) {
-            ImageFrame frame(_imgFolder.filePath(file));
-
-			if (frame.isValid()) {
-
-				bool ok = false;
-				QString outPath = _imgFolder.filePath(info.baseName() + ".png");
-
-				if (frame.additionalInfos().contains(ImageFrame::colorSpaceKey)) {
-					QString colorSpace = frame.additionalInfos()[ImageFrame::colorSpaceKey];
-
-					if (colorSpace == "YUYV") {
-						Multidim::Array<uint8_t,3> rgb = StereoVision::ImageProcessing::yuyv2rgb<uint8_t,3>(*frame.multichannels8());
-						ImageFrame converted(&rgb.atUnchecked(0,0,0), rgb.shape(), rgb.strides(), false);
-						ok = converted.save(outPath);
-					} else if (colorSpace == "YVYU") {
-						Multidim::Array<uint8_t,3> rgb = StereoVision::ImageProcessing::yvyu2rgb<uint8_t,3>(*frame.multichannels8());
-						ImageFrame converted(&rgb.atUnchecked(0,0,0), rgb.shape(), rgb.strides(), false);
-						ok = converted.save(outPath);
-					} else if (colorSpace == "YUV") {
-						Multidim::Array<uint8_t,3> rgb = StereoVision::ImageProcessing::yuv2rgb<uint8_t,3>(*frame.multichannels8());
-						ImageFrame converted(&rgb.atUnchecked(0,0,0), rgb.shape(), rgb.strides(), false);
-						ok = converted.save(outPath);
-					}
-				}
 
-				if (!ok) {
-					ok = frame.save(outPath);
-				}
+	// the videos are encoded in parallel with the frame by frame export.
+	VideoExporter videoExporter(VideoExporter::Config::fromSettings());
+	QVector<VideoExporter::Result> videoResults;
 
-				if (ok) {
-					out << "Exported " << file << endl;
-					QFile f(_imgFolder.filePath(file));
-					f.remove();
-					QFile fi(_imgFolder.filePath(file+".infos"));
-					fi.remove();
-				} else {
-					out << "Could not export " << file << endl;
-				}
+	std::thread videoWorker([&videos, &videoExporter, &videoResults] () {
+		for (auto it = videos.begin(); it != videos.end(); ++it) {
+
+			std::stable_sort(it->begin(), it->end(), [] (VideoExporter::Frame const& f1, VideoExporter::Frame const& f2) {
+				return f1.timeMs < f2.timeMs;
+			});
+
+			VideoExporter::Result result;
+			videoExporter.exportVideo(*it, it.key(), result);
+			videoResults.push_back(result);
+		}
+	});
+
+	FrameEncoders encoders(encodersConfig);
+
+	for (QString const& framePath : toExport) {
+
+		QString file = QFileInfo(framePath).fileName();
+		QString outPath;
+
+		if (FrameExporter::exportFrame(framePath, encoders, outPath)) {
+			out << "Exported " << file << endl;
+		} else {
+			out << "Could not export " << file << endl;
+		}
+	}
+
+	videoWorker.join();
+
+	for (VideoExporter::Result const& result : videoResults) {
+		if (result.error.isEmpty()) {
+			out << "Exported " << result.written << " frames to " << QFileInfo(result.videoPath).fileName();
+			if (result.skipped > 0) {
+				out << " (" << result.skipped << " frames could not be read)";
 			}
+			out << endl;
+		} else {
+			out << "Could not export " << QFileInfo(result.videoPath).fileName() << ": " << result.error << endl;
 		}
 	}
+
+	// the exported frames are not looked up anymore, their infos are released.
+	FrameInfosTable::releaseIndex(_imgFolder.absolutePath());
+
 	out << "Exports done !" << endl;
 }
+
+void CameraApplication::verifyRecorded(QString folder) {
+
+	QDir dir = (folder.isEmpty()) ? _imgFolder : QDir(folder);
+	QTextStream out(stdout);
+
+	if (!dir.exists()) {
+		out << "No folder " << dir.absolutePath() << " to verify" << endl;
+		return;
+	}
+
+	FrameVerifier verifier(FrameVerifier::Config::fromSettings());
+
+	auto printReport = [&out] (QString const& name, FrameVerifier::Report const& report) {
+
+		double seconds = std::max<qint64>(1, report.elapsedMs)/1000.;
+
+		out << name << ": " << report.intact << " intact, " << report.corrupted << " corrupted, "
+			<< report.unchecked << " without checksum, " << report.missing << " missing or exported ("
+			<< report.bytes/(1024*1024) << " MB in " << seconds << " s, " << report.bytes/(1024*1024)/seconds << " MB/s)" << endl;
+
+		for (QString const& file : report.corruptedFiles) {
+			out << "\tcorrupted: " << file << endl;
+		}
+	};
+
+	QStringList catalogs = SessionCatalog::listCatalogs(dir);
+
+	if (catalogs.isEmpty()) { //folder recorded without catalog
+		printReport(dir.absolutePath(), verifier.verifyFolder(dir));
+		FrameInfosTable::releaseIndex(dir.absolutePath());
+		return;
+	}
+
+	for (QString const& catalogPath : catalogs) {
+
+		FrameVerifier::Report report;
+
+		if (!verifier.verifySession(catalogPath, report)) {
+			out << "Could not read the session catalog " << catalogPath << endl;
+			continue;
+		}
+
+		printReport(QFileInfo(catalogPath).completeBaseName(), report);
+	}
+
+	FrameInfosTable::releaseIndex(dir.absolutePath());
+}
+
+void CameraApplication::configureIncrementalExport() {
+
+	FrameExporter::Config config = FrameExporter::Config::fromSettings();
+	_exporter->configure(config);
+
+	if (!config.incremental) {
+		_recorder->setFrameSavedCallback(nullptr);
+		return;
+	}
+
+	if (!_exporter->isRunning()) {
+		_exporter->start();
+	}
+
+	_recorder->setFrameSavedCallback([this] (QString const& framePath, QMap<QString, QString> const& infos) {
+		_exporter->enqueue(framePath, infos);
+	});
+}
+
 void CameraApplication::setInfraRedPatternOnSession(bool on) {
 	setInfraRedPatternOn(on);
 }
@@ -485,6 +803,8 @@ void CameraApplication::connectToRemote(QString host) {
 	if (ok) {
 		connect(remote, &RemoteSyncClient::timingInfoReceived,
 				this, &CameraApplication::timingInfoReceived);
+		connect(remote, &RemoteSyncClient::statusReceived,
+				this, &CameraApplication::statusReceived);
 		_remoteConnections->addConnection(remote);
 	} else {
 		remote->deleteLater();
@@ -495,6 +815,8 @@ void CameraApplication::connectToRemote(QString host) {
 void CameraApplication::disconnectFromRemote(QString host) {
 	RemoteSyncClient* remote = _remoteConnections->getConnectionByHost(host);
 
+	_statusDashboard.forget(host);
+
 	if (remote != nullptr) {
 		remote->disconnectFromHost(); //remote connections should delete it, so not need to do it.
 	}
@@ -505,7 +827,269 @@ bool CameraApplication::isRecording() const {
 	return _img_grab != nullptr;
 }
 bool CameraApplication::isRecordingToDisk() const {
-	return isRecording() and (_imgsToSave > 0 or _saving_imgs);
+	return isRecording() and _recorder->isSaving();
+}
+
+RecordingMonitor::Estimate CameraApplication::recordingEstimate() const {
+	return _recorder->monitor().estimate();
+}
+
+SessionCatalog::Stats CameraApplication::sessionCatalogStats() const {
+	return _recorder->catalogStats();
+}
+
+void CameraApplication::printRecordingStatus() {
+
+	RecordingMonitor::Estimate estimate = _recorder->monitor().estimate();
+
+	QTextStream out(stdout);
+	out << "Local recorder:" << "\n\t";
+	out << "output folder: " << _imgFolder.absolutePath() << "\n\t";
+	out << "free space [MB]: " << estimate.freeBytes/(1024*1024) << "\n\t";
+	out << "incoming data [MB/s]: " << estimate.incomingBytesPerSecond/(1024*1024) << "\n\t";
+	out << "write throughput [MB/s]: " << ((estimate.writeBytesPerSecond > 0) ? QString::number(estimate.writeBytesPerSecond/(1024*1024)) : "unknown") << "\n\t";
+	out << "remaining recording time: " << formatDuration(estimate.remainingSeconds) << "\n\t";
+	out << "sustainable: " << ((estimate.sustainable) ? "yes" : "no") << endl;
+
+	SessionCatalog::Stats catalogStats = _recorder->catalogStats();
+	out << "\tsession catalog: " << catalogStats.frameSets << " framesets, " << catalogStats.frames << " frames ("
+		<< catalogStats.bytes/(1024*1024) << " MB)" << endl;
+
+	if (_exporter->config().incremental) {
+		FrameExporter::Progress progress = _exporter->progress();
+		out << "\tincremental export: " << progress.exported << " exported, " << progress.pending << " pending, " << progress.failed << " failed" << endl;
+	}
+
+	for (int i = 0; i < _remoteConnections->rowCount(); i++) {
+		_remoteConnections->getConnectionAtRow(i)->checkRecordingStatus();
+	}
+}
+
+StatusSnapshot CameraApplication::statusSnapshot() const {
+
+	StatusSnapshot snapshot;
+	snapshot.timeMs = QDateTime::currentMSecsSinceEpoch();
+	snapshot.saving = _recorder->isSaving();
+
+	QVector<FrameRecorder::StreamStats> streams = _recorder->streamStats();
+
+	for (int i = 0; i < streams.size(); i++) {
+		snapshot.streams.push_back({FrameRecorder::streams[i], streams[i].captured, streams[i].saved, streams[i].failed});
+	}
+
+	snapshot.droppedFramesets = _captureQueueStats->nirDropped.load() + _captureQueueStats->rgbDropped.load();
+	snapshot.captureQueued = _captureQueueStats->nirQueued.load() + _captureQueueStats->rgbQueued.load();
+	snapshot.writesInFlight = _recorder->writesInFlight();
+	snapshot.exportPending = _exporter->progress().pending;
+
+	RecordingMonitor::Estimate estimate = _recorder->monitor().estimate();
+	snapshot.writeBytesPerSecond = estimate.writeBytesPerSecond;
+	snapshot.freeBytes = estimate.freeBytes;
+	snapshot.remainingSeconds = estimate.remainingSeconds;
+	snapshot.sustainable = estimate.sustainable;
+
+	return snapshot;
+}
+
+void CameraApplication::printStatus() {
+
+	_statusDashboard.addSource("local", statusSnapshot());
+
+	for (int i = 0; i < _remoteConnections->rowCount(); i++) {
+
+		RemoteSyncClient* remote = _remoteConnections->getConnectionAtRow(i);
+
+		if (remote->isConnected()) {
+			remote->checkStatus(); //the answer is received before returning, see statusReceived.
+		} else {
+			_statusDashboard.addUnavailableSource(remote->getDescr(), "not connected");
+		}
+	}
+
+	QTextStream out(stdout);
+	_statusDashboard.print(out);
+}
+
+void CameraApplication::setStatusWatch(int msec) {
+
+	if (msec <= 0) {
+		_statusWatchTimer->stop();
+		return;
+	}
+
+	_statusWatchTimer->start(msec);
+	printStatus();
+}
+
+bool CameraApplication::setThreadCpus(QString role, QString cpus) {
+
+	ThreadTuning::Role threadRole;
+	ThreadTuning::Config config;
+
+	if (!ThreadTuning::roleFromName(role, threadRole)) {
+		manageAcquisitionError(QString("Unknown thread %1 (expected grabber, writer, network or exporter)").arg(role));
+		return false;
+	}
+
+	config = ThreadTuning::load(threadRole);
+
+	if (!ThreadTuning::parseCpuList(cpus, config.cpus)) {
+		manageAcquisitionError(QString("Invalid cpu list %1").arg(cpus));
+		return false;
+	}
+
+	ThreadTuning::store(threadRole, config);
+	return true;
+}
+
+bool CameraApplication::setThreadPolicy(QString role, QString policy, int priority) {
+
+	ThreadTuning::Role threadRole;
+	ThreadTuning::Config config;
+
+	if (!ThreadTuning::roleFromName(role, threadRole)) {
+		manageAcquisitionError(QString("Unknown thread %1 (expected grabber, writer, network or exporter)").arg(role));
+		return false;
+	}
+
+	if (!ThreadTuning::isValidPolicy(policy)) {
+		manageAcquisitionError(QString("Unknown scheduling policy %1 (expected other, fifo, rr or idle)").arg(policy));
+		return false;
+	}
+
+	config = ThreadTuning::load(threadRole);
+	config.policy = policy;
+	config.priority = priority;
+
+	ThreadTuning::store(threadRole, config);
+	return true;
+}
+
+void CameraApplication::printThreadsConfig() {
+
+	QTextStream out(stdout);
+	out << "Threads configuration (applied when the threads start):" << "\n";
+
+	for (ThreadTuning::Role role : {ThreadTuning::Grabber, ThreadTuning::Writer, ThreadTuning::Network, ThreadTuning::Exporter}) {
+		ThreadTuning::Config config = ThreadTuning::load(role);
+		out << "\t" << ThreadTuning::roleName(role) << ": cpus " << ThreadTuning::cpuListToString(config.cpus)
+			<< ", policy " << config.policy;
+		if (config.policy == "fifo" or config.policy == "rr") {
+			out << ", priority " << config.priority;
+		}
+		out << "\n";
+	}
+
+	out << flush;
+}
+
+bool CameraApplication::setStreamProfile(int row, QString stream, QString profile) {
+
+	StreamProfiles::Stream rsStream;
+	StreamProfiles::Profile rsProfile;
+
+	if (!StreamProfiles::streamFromName(stream, rsStream)) {
+		manageAcquisitionError(QString("Unknown stream %1 (expected left, right, rgb or depth)").arg(stream));
+		return false;
+	}
+
+	if (!StreamProfiles::parseProfile(profile, rsProfile)) {
+		manageAcquisitionError(QString("Invalid stream profile %1 (expected off or <format> <width>x<height>@<fps>)").arg(profile));
+		return false;
+	}
+
+	if (row < 0) {
+		row = _prefferedCamera;
+	}
+
+	if (row < 0 or row >= _lst->rowCount() or !_lst->isRs(row)) {
+		manageAcquisitionError(QString("Camera %1 is not a RealSense camera").arg(row));
+		return false;
+	}
+
+	QString serial = QString::fromStdString(_lst->serialNumber(row));
+	StreamProfiles::Config config = StreamProfiles::load(serial);
+	config[rsStream] = rsProfile;
+
+	return setStreamProfiles(row, config);
+}
+
+bool CameraApplication::setStreamProfiles(int row, StreamProfiles::Config const& config) {
+
+	if (row < 0 or row >= _lst->rowCount() or !_lst->isRs(row)) {
+		manageAcquisitionError(QString("Camera %1 is not a RealSense camera").arg(row));
+		return false;
+	}
+
+	QString serial = QString::fromStdString(_lst->serialNumber(row));
+	QString error;
+
+	if (!StreamProfiles::validate(serial, config, error)) {
+		manageAcquisitionError(QString("Invalid stream profiles: %1").arg(error));
+		return false;
+	}
+
+	StreamProfiles::store(serial, config);
+
+	if (_mw == nullptr) {
+		QTextStream out(stdout);
+		out << "Stream profiles of camera " << row << " set to " << StreamProfiles::configToString(config)
+			<< ((isRecording()) ? " (applied when the recording restarts)" : "") << endl;
+	}
+
+	return true;
+}
+
+void CameraApplication::setStreamProfileSession(int row, QString stream, QString profile) {
+
+	setStreamProfile(row, stream, profile);
+
+	for (int i = 0; i < _remoteConnections->rowCount(); i++) {
+		_remoteConnections->getConnectionAtRow(i)->setStreamProfile(row, stream, profile);
+	}
+}
+
+QString CameraApplication::streamProfilesDescr(int row) const {
+
+	if (row < 0) {
+		row = _prefferedCamera;
+	}
+
+	if (row < 0 or row >= _lst->rowCount() or !_lst->isRs(row)) {
+		return QString();
+	}
+
+	return StreamProfiles::configToString(StreamProfiles::load(QString::fromStdString(_lst->serialNumber(row))));
+}
+
+void CameraApplication::printStreamProfiles(int row) {
+
+	if (row < 0) {
+		row = _prefferedCamera;
+	}
+
+	QTextStream out(stdout);
+
+	if (row < 0 or row >= _lst->rowCount() or !_lst->isRs(row)) {
+		out << "Camera " << row << " is not a RealSense camera" << endl;
+	} else {
+
+		QString serial = QString::fromStdString(_lst->serialNumber(row));
+		StreamProfiles::Config config = StreamProfiles::load(serial);
+
+		out << "Stream profiles of camera " << row << " (" << serial << "):" << "\n";
+
+		for (StreamProfiles::Stream stream : StreamProfiles::streams()) {
+			out << "\t" << StreamProfiles::streamName(stream) << ": " << StreamProfiles::profileToString(config[stream]) << "\n";
+			out << "\t\tsupported: off, " << StreamProfiles::deviceProfiles(serial, stream).join(", ") << "\n";
+		}
+
+		out << flush;
+	}
+
+	for (int i = 0; i < _remoteConnections->rowCount(); i++) {
+		_remoteConnections->getConnectionAtRow(i)->checkStreamProfiles(row);
+	}
 }
 
 void CameraApplication::configureTimeSource(QString addr, quint16 port) {
@@ -551,32 +1135,110 @@ void CameraApplication::pingAll() {
 	}
 }
 
-void CameraApplication::receiveFrames(ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB) {
+void CameraApplication::receiveFrames(ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB, ImageFrame frameDepth) {
 
-	if (_imgsToSave > 0 or _saving_imgs) {
-		QDateTime date = QDateTime::fromMSecsSinceEpoch(getTimeMs());
-		QString timestamp =date.toString("yyyy_MM_dd_hh_mm_ss_zzz");
-		QString leftFramePath = _imgFolder.filePath(timestamp + "_left.stevimg");
-		QString rightFramePath = _imgFolder.filePath(timestamp + "_right.stevimg");
-		QString rgbFramePath = _imgFolder.filePath(timestamp + "_rgb.stevimg");
+	bool saved = _recorder->receiveFrames(frameLeft, frameRight, frameRGB, frameDepth);
 
-		frameLeft.save(leftFramePath);
-		frameRight.save(rightFramePath);
-		frameRGB.save(rgbFramePath);
+	if (!saved) {
+		pushPreviewFrames(frameLeft, frameRight);
+	}
+}
 
-		_saveAcessControl.lock();
-		if (_imgsToSave > 0) {
-			_imgsToSave--;
-		}
-		_saveAcessControl.unlock();
+void CameraApplication::receiveFrameSetPart(qint64 frameSetNumber, ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB, ImageFrame frameDepth) {
 
-	} else {
-		if (_mw != nullptr) {
-			_mw->setFrames(frameLeft, frameRight);
+	bool saved = _recorder->receiveFrameSetPart(frameSetNumber, frameLeft, frameRight, frameRGB, frameDepth);
+
+	// only the infrared part is previewed, which keeps a single producer for the preview queue.
+	if (!saved and (frameLeft.isValid() or frameRight.isValid())) {
+		pushPreviewFrames(frameLeft, frameRight);
+	}
+}
+
+void CameraApplication::pushPreviewFrames(ImageFrame const& frameLeft, ImageFrame const& frameRight) {
+
+	if (_mw == nullptr) {
+		return;
+	}
+
+	// the frames point to the camera buffers, only copy them if the gui can take them.
+	if (_previewQueue.isFull()) {
+		return;
+	}
+
+	PreviewFrames preview;
+	preview.frameLeft = frameLeft.deepCopy();
+	preview.frameRight = frameRight.deepCopy();
+
+	if (_previewQueue.tryPush(std::move(preview))) {
+		QMetaObject::invokeMethod(this, &CameraApplication::showPreviewFrames, Qt::QueuedConnection);
+	}
+
+}
+
+void CameraApplication::showPreviewFrames() {
+
+	PreviewFrames preview;
+	bool hasFrames = false;
+
+	while (_previewQueue.tryPop(preview)) {
+		hasFrames = true;
+	}
+
+	if (hasFrames and _mw != nullptr) {
+		_mw->setFrames(preview.frameLeft, preview.frameRight);
+	}
+}
+
+bool CameraApplication::admitContinuousSave() {
+
+	QSettings settings;
+	qint64 minFreeMb = settings.value("io/minfreemb", 1024).toLongLong();
+	bool refuseUnsustainable = settings.value("io/refuseunsustainable", false).toBool();
+
+	settings.setValue("io/minfreemb", minFreeMb);
+	settings.setValue("io/refuseunsustainable", refuseUnsustainable);
+
+	// the write throughput is probed once per output filesystem, in the background, it is unknown until the probe is done.
+	_recorder->monitor().probeWriteThroughputInBackground();
+	RecordingMonitor::Estimate estimate = _recorder->monitor().estimate();
+
+	if (estimate.freeBytes >= 0 and estimate.freeBytes < minFreeMb*1024*1024) {
+		reportRecordingWarning(QString("Not enough free space in %1 to start saving (%2 MB left) !")
+							   .arg(_imgFolder.absolutePath())
+							   .arg(estimate.freeBytes/(1024*1024)));
+		return false;
+	}
+
+	if (!estimate.sustainable) {
+		QString txt = QString("Write throughput (%1 MB/s) is too low to sustain the camera data rate (%2 MB/s) !")
+				.arg(estimate.writeCapacityBytesPerSecond/(1024*1024), 0, 'f', 1)
+				.arg(estimate.incomingBytesPerSecond/(1024*1024), 0, 'f', 1);
+
+		if (refuseUnsustainable) {
+			reportRecordingWarning(txt + " Saving refused.");
+			return false;
 		}
+
+		reportRecordingWarning(txt);
 	}
 
+	if (_mw == nullptr) {
+		QTextStream out(stdout);
+		out << "Start saving, estimated remaining recording time: " << formatDuration(estimate.remainingSeconds) << endl;
+	}
+
+	return true;
 }
+
+void CameraApplication::reportRecordingWarning(QString txt) {
+	if (_mw != nullptr) {
+		_mw->showStatusMessage(txt);
+	}
+
+	QTextStream err(stderr);
+	err << txt << endl;
+}
+
 void CameraApplication::configureSettings() {
 	QCoreApplication::setOrganizationName("paragon");
 	QCoreApplication::setOrganizationDomain("paragon.ch");
@@ -611,8 +1273,18 @@ void CameraApplication::configureConsoleWatcher() {
 		connect(_cw, &ConsoleWatcher::saveImgsIntervalTriggered, this, &CameraApplication::saveInterval);
 		connect (_cw, &ConsoleWatcher::stopRecordTriggered, this, &CameraApplication::stopRecordSession);
 		connect (_cw, &ConsoleWatcher::exportRecordTriggered, this, &CameraApplication::exportRecording);
+		connect (_cw, &ConsoleWatcher::verifyTriggered, this, &CameraApplication::verifyRecorded);
 		connect (_cw, &ConsoleWatcher::setIrPatternTriggered, this, &CameraApplication::setInfraRedPatternOnSession);
 		connect (_cw, &ConsoleWatcher::tcpTimingTriggered, this, &CameraApplication::setUseTcpTimeSync);
+		connect (_cw, &ConsoleWatcher::preTriggerTriggered, this, &CameraApplication::setPreTriggerDuration);
+		connect (_cw, &ConsoleWatcher::diskStatusTriggered, this, &CameraApplication::printRecordingStatus);
+		connect (_cw, &ConsoleWatcher::statusTriggered, this, &CameraApplication::printStatus);
+		connect (_cw, &ConsoleWatcher::watchTriggered, this, &CameraApplication::setStatusWatch);
+		connect (_cw, &ConsoleWatcher::threadsStatusTriggered, this, &CameraApplication::printThreadsConfig);
+		connect (_cw, &ConsoleWatcher::threadCpusTriggered, this, &CameraApplication::setThreadCpus);
+		connect (_cw, &ConsoleWatcher::threadPolicyTriggered, this, &CameraApplication::setThreadPolicy);
+		connect (_cw, &ConsoleWatcher::streamProfilesStatusTriggered, this, &CameraApplication::printStreamProfiles);
+		connect (_cw, &ConsoleWatcher::streamProfileTriggered, this, &CameraApplication::setStreamProfileSession);
 		connect (_cw, &ConsoleWatcher::sleepTrigger, this, [this] (uint ms) { sleepms(ms); });
 
 		connect (_cw, &ConsoleWatcher::listCamerasTriggered, this, [this] () {
@@ -635,7 +1307,7 @@ void CameraApplication::configureConsoleWatcher() {
 
 		connect(_cw, &ConsoleWatcher::remoteConnectionTriggered, this, &CameraApplication::connectToRemote);
 		connect(_cw, &ConsoleWatcher::remotePingTriggered, this, [this] (int row) {
-			qDebug() << "checking communication time for: " << row;
+			qCDebug(lcRemote) << "checking communication time for:" << row;
 			if (row >= 0 and row < _remoteConnections->rowCount()) {
 				_remoteConnections->getConnectionAtRow(row)->checkConnectionTime();
 			}
@@ -652,7 +1324,7 @@ void CameraApplication::configureConsoleWatcher() {
 			QDateTime now = QDateTime::currentDateTimeUtc();
 			qint64 msLocal = now.currentMSecsSinceEpoch();
 
-			qDebug() << "Application time: " << msApp << " Local time: " << msLocal;
+			qCInfo(lcApp) << "Application time:" << msApp << "Local time:" << msLocal;
 		});
 		connect(_cw, &ConsoleWatcher::configTimeTriggered, this,
 				static_cast<void(CameraApplication::*)(QString, quint16)>(&CameraApplication::configureTimeSource));
@@ -669,6 +1341,9 @@ void CameraApplication::configureApplicationServer() {
 
 	if (_isServer) {
 		_serverThread = new QThread(this);
+		connect(_serverThread, &QThread::started, _serverThread, [] () {
+			ThreadTuning::applyToCurrentThread(ThreadTuning::Network);
+		}, Qt::DirectConnection);
 		_serverThread->start();
 
 		_rs = new RemoteSyncServer(nullptr);
@@ -702,6 +1377,100 @@ void CameraApplication::configureApplicationServer() {
 
 }
 
+void CameraApplication::configureMetricsServer() {
+
+	MetricsServer::Config config = MetricsServer::Config::fromSettings();
+
+	if (!config.enabled) {
+		return;
+	}
+
+	_metricsThread = new QThread(this);
+	connect(_metricsThread, &QThread::started, _metricsThread, [] () {
+		ThreadTuning::applyToCurrentThread(ThreadTuning::Network);
+	}, Qt::DirectConnection);
+
+	_metrics = new MetricsServer([this] (PrometheusText & metrics) { collectMetrics(metrics); });
+	_metrics->moveToThread(_metricsThread);
+	connect(_metricsThread, &QThread::finished, _metrics, &QObject::deleteLater);
+
+	connect(_metricsThread, &QThread::started, _metrics, [this, config] () {
+		if (_metrics->start(config)) {
+			QTextStream out(stdout);
+			out << "Serving the metrics on " << config.address << ":" << _metrics->serverPort() << endl;
+		}
+	});
+
+	_metricsThread->start();
+}
+
+void CameraApplication::collectMetrics(PrometheusText & metrics) const {
+
+	QVector<FrameRecorder::StreamStats> streams = _recorder->streamStats();
+
+	// the samples of a metric family are grouped after its help and type lines, as the exposition format requires.
+	for (int i = 0; i < streams.size(); i++) {
+		metrics.sample("rsnir_frames_captured_total", "counter", "Valid frames received from the camera.", streams[i].captured,
+					   {{"stream", FrameRecorder::streams[i]}});
+	}
+	for (int i = 0; i < streams.size(); i++) {
+		metrics.sample("rsnir_frames_saved_total", "counter", "Frames written to disk.", streams[i].saved,
+					   {{"stream", FrameRecorder::streams[i]}});
+	}
+	for (int i = 0; i < streams.size(); i++) {
+		metrics.sample("rsnir_frames_failed_total", "counter", "Frames which could not be written.", streams[i].failed,
+					   {{"stream", FrameRecorder::streams[i]}});
+	}
+
+	metrics.sample("rsnir_capture_dropped_framesets_total", "counter", "Framesets dropped by the parallel capture because a queue was full.",
+				   _captureQueueStats->nirDropped.load(), {{"queue", "nir"}});
+	metrics.sample("rsnir_capture_dropped_framesets_total", "counter", "Framesets dropped by the parallel capture because a queue was full.",
+				   _captureQueueStats->rgbDropped.load(), {{"queue", "rgb"}});
+
+	FrameExporter::Progress exportProgress = _exporter->progress();
+
+	const QString queueHelp = "Items waiting in the queues of the recording pipeline.";
+	metrics.sample("rsnir_queue_depth", "gauge", queueHelp, _captureQueueStats->nirQueued.load(), {{"queue", "capture_nir"}});
+	metrics.sample("rsnir_queue_depth", "gauge", queueHelp, _captureQueueStats->rgbQueued.load(), {{"queue", "capture_rgb"}});
+	metrics.sample("rsnir_queue_depth", "gauge", queueHelp, _recorder->writesInFlight(), {{"queue", "writer"}});
+	metrics.sample("rsnir_queue_depth", "gauge", queueHelp, exportProgress.pending, {{"queue", "export"}});
+	metrics.sample("rsnir_queue_depth", "gauge", queueHelp, static_cast<double>(_previewQueue.sizeApprox()), {{"queue", "preview"}});
+
+	metrics.sample("rsnir_exported_frames_total", "counter", "Frames exported as images.", exportProgress.exported);
+	metrics.sample("rsnir_export_failed_frames_total", "counter", "Frames which could not be exported.", exportProgress.failed);
+
+	RecordingMonitor::Estimate estimate = _recorder->monitor().estimate();
+
+	metrics.sample("rsnir_saving", "gauge", "1 while frames are being saved.", (_recorder->isSaving()) ? 1 : 0);
+	metrics.sample("rsnir_incoming_bytes_per_second", "gauge", "Data rate produced by the camera.", estimate.incomingBytesPerSecond);
+	metrics.sample("rsnir_write_bytes_per_second", "gauge", "Write throughput achieved by the recorder, 0 if unknown.", estimate.writeBytesPerSecond);
+	metrics.sample("rsnir_disk_free_bytes", "gauge", "Free space on the output filesystem.", estimate.freeBytes);
+	metrics.sample("rsnir_recording_remaining_seconds", "gauge", "Estimated remaining recording time, -1 if unknown.",
+				   (estimate.remainingSeconds < 0) ? -1 : estimate.remainingSeconds);
+	metrics.sample("rsnir_recording_sustainable", "gauge", "1 if the output filesystem keeps up with the camera.", (estimate.sustainable) ? 1 : 0);
+
+	SessionCatalog::Stats catalog = _recorder->catalogStats();
+
+	metrics.sample("rsnir_session_framesets", "gauge", "Framesets in the catalog of the current session.", catalog.frameSets);
+	metrics.sample("rsnir_session_frames", "gauge", "Frames in the catalog of the current session.", catalog.frames);
+
+	metrics.sample("rsnir_clock_offset_milliseconds", "gauge", "Offset of the time source to the system clock, 0 when the system clock is used.",
+				   _clockOffsetMs.load(std::memory_order_relaxed));
+
+	metrics.addThreadsCpuTime();
+}
+
+void CameraApplication::statusReceived(QString peerName, qint64 server_ms, QString status) {
+
+	StatusSnapshot snapshot;
+
+	if (StatusSnapshot::fromLine(status, server_ms, snapshot)) {
+		_statusDashboard.addSource(peerName, snapshot);
+	} else {
+		_statusDashboard.addUnavailableSource(peerName, "status not supported by the server");
+	}
+}
+
 void CameraApplication::manageAcquisitionError(QString txt) {
 	if (_mw != nullptr) {
 		_mw->showErrorMessage(txt);
@@ -711,6 +1480,24 @@ void CameraApplication::manageAcquisitionError(QString txt) {
 	}
 }
 
+void CameraApplication::manageAcquisitionFinished(QString summary) {
+
+	_recorder->flush();
+
+	qint64 saved = -_acquisitionStartSaved;
+	qint64 failed = -_acquisitionStartFailed;
+
+	for (FrameRecorder::StreamStats const& stream : _recorder->streamStats()) {
+		saved += stream.saved;
+		failed += stream.failed;
+	}
+
+	QTextStream out(stdout);
+	out << summary << ", " << saved << " frames saved, " << failed << " failed" << endl;
+
+	Q_EMIT triggerStopRecording();
+}
+
 void CameraApplication::timingInfoReceived(QString peerName,
 						QString peerAddr,
 						qint64 sent_ms,
@@ -759,15 +1546,16 @@ qint64 CameraApplication::getTimeMs() const {
 						n_ms += data[sizeof (uint64_t)-i-1];
 					}
 
+					_clockOffsetMs.store(static_cast<qint64>(n_ms) - QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
 					return n_ms;
 				} else {
-					qDebug() << "Net time wrong size";
+					qCWarning(lcRemote) << "Net time wrong size";
 				}
 			} else {
-				qDebug() << "Net time timed out";
+				qCWarning(lcRemote) << "Net time timed out";
 			}
 		} else {
-			qDebug() << "Net time failed bind";
+			qCWarning(lcRemote) << "Net time failed bind";
 		}
 
 	}
@@ -775,6 +1563,10 @@ qint64 CameraApplication::getTimeMs() const {
 	QDateTime now = QDateTime::currentDateTimeUtc();
 	qint64 ms = now.currentMSecsSinceEpoch();
 
+	if (_time_server_address.isNull()) {
+		_clockOffsetMs.store(0, std::memory_order_relaxed);
+	}
+
 	return ms;
 }
 
@@ -7,7 +7,15 @@
 #include <QTemporaryDir>
 #include <QHostAddress>
 
+#include <atomic>
+#include <memory>
+
 #include "./imageframe.h"
+#include "./recordingmonitor.h"
+#include "./framequeue.h"
+#include "./streamprofiles.h"
+#include "./sessioncatalog.h"
+#include "./statusdashboard.h"
 
 class QCoreApplication;
 class QTimer;
@@ -16,8 +24,13 @@ class MainWindow;
 class ConsoleWatcher;
 class CamerasList;
 class CameraGrabber;
+class FrameRecorder;
+class FrameExporter;
 class RemoteSyncServer;
 class RemoteConnectionList;
+class MetricsServer;
+class PrometheusText;
+struct CaptureQueueStats;
 
 class libvlc_instance_t;
 class libvlc_media_player_t;
@@ -44,6 +57,13 @@ public:
 	void setUseTcpTimeSync(bool enable);
 	bool useTcpTimeSync() const;
 
+	/*!
+	 * \brief setPreTriggerDuration set how many seconds of frames are kept in memory and saved when a save is triggered.
+	 * \param seconds the duration, 0 to disable the pre-trigger buffer.
+	 */
+	void setPreTriggerDuration(double seconds);
+	double preTriggerDuration() const;
+
 	void startRecordSession();
 	void startRecording(int row);
 	void saveFrames(int nFrames);
@@ -66,6 +86,55 @@ public:
 	bool isRecording() const;
 	bool isRecordingToDisk() const;
 
+	/*!
+	 * \brief recordingEstimate give the current estimate of the recording throughput and remaining time.
+	 */
+	RecordingMonitor::Estimate recordingEstimate() const;
+	SessionCatalog::Stats sessionCatalogStats() const;
+	void printRecordingStatus();
+
+	/*!
+	 * \brief verifyRecorded check the recorded frames of all the sessions of a folder against their checksums.
+	 * \param folder the folder to check, the output folder if empty.
+	 */
+	void verifyRecorded(QString folder);
+
+	/*!
+	 * \brief statusSnapshot give the frame counters, queues and disk estimate of the application, can be called from any thread.
+	 */
+	StatusSnapshot statusSnapshot() const;
+	/*!
+	 * \brief printStatus print the status of the local recorder and of all the connected servers in a single table.
+	 */
+	void printStatus();
+	/*!
+	 * \brief setStatusWatch print the status every msec milliseconds, or stop if msec is 0.
+	 */
+	void setStatusWatch(int msec);
+
+	/*!
+	 * \brief setThreadCpus set the cpus a thread role is pinned to, applied the next time the thread starts.
+	 * \param cpus a list like "2,4-6", or "all".
+	 */
+	bool setThreadCpus(QString role, QString cpus);
+	/*!
+	 * \brief setThreadPolicy set the scheduling policy ("other", "fifo" or "rr") of a thread role, applied the next time the thread starts.
+	 */
+	bool setThreadPolicy(QString role, QString policy, int priority);
+	void printThreadsConfig();
+
+	/*!
+	 * \brief setStreamProfile set the profile of a stream of a RealSense camera, applied the next time the camera starts.
+	 * \param row the camera, or -1 for the preffered camera.
+	 * \param stream "left", "right" or "rgb".
+	 * \param profile "off" or "<format> <width>x<height>@<fps>", which has to be supported by the device.
+	 */
+	bool setStreamProfile(int row, QString stream, QString profile);
+	bool setStreamProfiles(int row, StreamProfiles::Config const& config);
+	void setStreamProfileSession(int row, QString stream, QString profile);
+	QString streamProfilesDescr(int row) const;
+	void printStreamProfiles(int row);
+
 	void configureTimeSource(QString addr,
 							 quint16 port = 5070);
 	void configureTimeSource(const QHostAddress &address,
@@ -107,20 +176,36 @@ protected:
 
 	void pingAll();
 
-	void receiveFrames(ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB);
+	void receiveFrames(ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB, ImageFrame frameDepth);
+	void receiveFrameSetPart(qint64 frameSetNumber, ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB, ImageFrame frameDepth);
+	void pushPreviewFrames(ImageFrame const& frameLeft, ImageFrame const& frameRight);
+	void showPreviewFrames();
+
+	bool admitContinuousSave();
+	void reportRecordingWarning(QString txt);
 
 	void configureSettings();
 	void configureMainWindow();
 	void configureConsoleWatcher();
 	void configureApplicationServer();
+	void configureIncrementalExport();
+	void recoverInterruptedSessions();
+	void configureMetricsServer();
+
+	/*!
+	 * \brief collectMetrics add the metrics of the application to a metrics page, called from the metrics server thread.
+	 */
+	void collectMetrics(PrometheusText & metrics) const;
 
 	void manageAcquisitionError(QString txt);
+	void manageAcquisitionFinished(QString summary);
 
 	void timingInfoReceived(QString peerName,
 							QString peerAddr,
 							qint64 sent_ms,
 							qint64 server_ms,
 							qint64 now_ms);
+	void statusReceived(QString peerName, qint64 server_ms, QString status);
 
 	static CameraApplication* CurrentApp;
 
@@ -136,18 +221,31 @@ protected:
 	int _prefferedCamera;
 	CamerasList* _lst;
 	CameraGrabber* _img_grab;
+	FrameRecorder* _recorder;
+	FrameExporter* _exporter;
 
 	RemoteConnectionList* _remoteConnections;
 	QFile* _sessionTimingFile;
 	QTimer* _pingTimer;
 
-	QMutex _saveAcessControl;
+	StatusDashboard _statusDashboard;
+	QTimer* _statusWatchTimer;
 
 	QDir _imgFolder;
-	int _imgsToSave;
-	bool _saving_imgs;
+	int _cameraFps;
+
+	qint64 _acquisitionStartSaved; //!< the frames saved by the recorder when the acquisition started.
+	qint64 _acquisitionStartFailed;
 
 	MainWindow* _mw;
+
+	struct PreviewFrames {
+		ImageFrame frameLeft;
+		ImageFrame frameRight;
+	};
+
+	SpscQueue<PreviewFrames> _previewQueue; //!< frames going from the acquisition thread to the gui thread.
+
 	ConsoleWatcher* _cw;
 	RemoteSyncServer* _rs;
 
@@ -161,6 +259,12 @@ protected:
 	QHostAddress _time_server_address;
 	quint16 _time_server_port;
 	QAbstractSocket::BindMode _time_server_bind_mode;
+	mutable std::atomic<qint64> _clockOffsetMs; //!< the offset of the time source to the system clock, measured by getTimeMs.
+
+	std::shared_ptr<CaptureQueueStats> _captureQueueStats;
+
+	QThread* _metricsThread;
+	MetricsServer* _metrics;
 
 };
 
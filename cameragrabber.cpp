@@ -1,18 +1,34 @@
 #include "cameragrabber.h"
 
+#include "threadtuning.h"
+#include "framequeue.h"
+#include "logging.h"
+
 #include <QCoreApplication>
 
 #include <opencv2/videoio.hpp>
 
-#include <QDebug>
+#include <QElapsedTimer>
 #include <QSettings>
+#include <QTextStream>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 CameraGrabber::CameraGrabber(QObject *parent) :
 	QThread(parent),
-	_pipeline_profile()
+	_pipeline_profile(),
+	_parallelStreams(false),
+	_nirQueueSize(2),
+	_rgbQueueSize(2),
+	_queueStats(std::make_shared<CaptureQueueStats>()),
+	_usePlayback(false),
+	_continue(false)
 {
 	_opencv_dev_id = -1;
 	_v4l2descr = {"", -1};
+	_useSimulation = false;
 }
 
 rs2::config &CameraGrabber::config()
@@ -25,24 +41,120 @@ rs2::config const& CameraGrabber::config() const
 	return _config;
 }
 
-void CameraGrabber::setConfig(const rs2::config &config)
+void CameraGrabber::setConfig(const rs2::config &config, StreamProfiles::Config const& profiles)
 {
 	_config = config;
+	_streamProfiles = profiles;
+
+	loadCaptureModeSettings();
+
+	StreamProfiles::enableStreams(_config, _streamProfiles);
+}
+
+void CameraGrabber::loadCaptureModeSettings() {
 
 	QSettings settings;
-	int fps = settings.value("realsense/fps", 30).toInt();
-	int width = settings.value("realsense/width", 848).toInt();
-	int height = settings.value("realsense/height", 480).toInt();
 
-	settings.setValue("realsense/fps", fps);
-	settings.setValue("realsense/width", width);
-	settings.setValue("realsense/height", height);
+	QString captureMode = settings.value("realsense/capturemode", "sync").toString().toLower();
+	_nirQueueSize = std::max(1, settings.value("realsense/nirqueuesize", _nirQueueSize).toInt());
+	_rgbQueueSize = std::max(1, settings.value("realsense/rgbqueuesize", _rgbQueueSize).toInt());
+
+	if (captureMode != "sync" and captureMode != "parallel") {
+		QTextStream err(stderr);
+		err << "Unknown realsense/capturemode value " << captureMode << " (expected sync or parallel), using sync" << endl;
+		captureMode = "sync";
+	}
+
+	_parallelStreams = (captureMode == "parallel");
+
+	settings.setValue("realsense/capturemode", captureMode);
+	settings.setValue("realsense/nirqueuesize", _nirQueueSize);
+	settings.setValue("realsense/rgbqueuesize", _rgbQueueSize);
+}
+
+StreamProfiles::Config const& CameraGrabber::streamProfiles() const {
+	return _streamProfiles;
+}
+
+void CameraGrabber::setPlaybackConfig(PlaybackConfig const& config) {
+
+	_playbackConfig = config;
+	_usePlayback = true;
+
+	_config = rs2::config();
+	_config.enable_device_from_file(config.file.toStdString(), config.loop);
+
+	// the streams are the ones recorded in the file, the parts of a frameset which are not in it are never received.
+	for (StreamProfiles::Stream stream : StreamProfiles::streams()) {
+		_streamProfiles[stream].enabled = true;
+	}
+
+	loadCaptureModeSettings();
+}
+bool CameraGrabber::usePlayback() const {
+	return _usePlayback;
+}
+CameraGrabber::PlaybackConfig const& CameraGrabber::playbackConfig() const {
+	return _playbackConfig;
+}
+
+void CameraGrabber::setBagRecordingFile(QString const& file) {
+	_bagRecordingFile = file;
+	_config.enable_record_to_file(file.toStdString());
+}
+
+int CameraGrabber::playbackFps(QString const& file) {
+
+	int fps = 0;
+
+	try {
+		rs2::context ctx;
+		rs2::playback playback = ctx.load_device(file.toStdString());
+
+		for (rs2::sensor const& sensor : playback.query_sensors()) {
+			for (rs2::stream_profile const& profile : sensor.get_stream_profiles()) {
+				fps = std::max(fps, profile.fps());
+			}
+		}
+
+		ctx.unload_device(file.toStdString());
+	} catch (rs2::error const& e) {
+		QTextStream err(stderr);
+		err << "Unable to read the bag file " << file << ": " << e.what() << endl;
+		return 0;
+	}
+
+	return fps;
+}
+
+void CameraGrabber::startPlayback(rs2::pipeline_profile const& profile) {
+
+	_playbackDevice = profile.get_device();
+
+	rs2::playback playback(_playbackDevice);
+	playback.set_real_time(_playbackConfig.realTime);
+}
+
+bool CameraGrabber::playbackEnded() const {
 
-	_config.enable_stream(rs2_stream::RS2_STREAM_INFRARED, 1, width, height, rs2_format::RS2_FORMAT_Y8, fps);
-	_config.enable_stream(rs2_stream::RS2_STREAM_INFRARED, 2, width, height, rs2_format::RS2_FORMAT_Y8, fps);
-	_config.enable_stream(rs2_stream::RS2_STREAM_COLOR, -1, width, height, rs2_format::RS2_FORMAT_RGB8, fps);
-	//_config.enable_all_streams();
+	if (!_usePlayback or !_playbackDevice) {
+		return false;
+	}
+
+	return rs2::playback(_playbackDevice).current_status() == RS2_PLAYBACK_STATUS_STOPPED;
+}
+
+void CameraGrabber::emitPlaybackSummary(qint64 nFrameSets, qint64 nDropped, qint64 elapsedMs) {
+
+	double rate = (elapsedMs > 0) ? 1000.*nFrameSets/elapsedMs : 0;
 
+	Q_EMIT acquisitionFinished(QString("Playback of %1 finished: %2 framesets processed in %3 s (%4 framesets/s, %5), %6 dropped")
+							   .arg(_playbackConfig.file)
+							   .arg(nFrameSets)
+							   .arg(elapsedMs/1000., 0, 'f', 2)
+							   .arg(rate, 0, 'f', 1)
+							   .arg((_playbackConfig.realTime) ? "real time" : "as fast as possible")
+							   .arg(nDropped));
 }
 
 V4L2Camera::Config& CameraGrabber::v4l2config() {
@@ -90,14 +202,64 @@ void CameraGrabber::setV4l2descr(const V4L2Camera::Descriptor &v4l2descr)
 	_v4l2descr = v4l2descr;
 }
 
+bool CameraGrabber::useSimulation() const {
+	return _useSimulation;
+}
+SimulatedCamera::Config const& CameraGrabber::simulationConfig() const {
+	return _simulationConfig;
+}
+void CameraGrabber::setSimulationConfig(const SimulatedCamera::Config &config) {
+	_simulationConfig = config;
+	_useSimulation = true;
+}
+
+void CameraGrabber::setQueueStats(std::shared_ptr<CaptureQueueStats> const& stats) {
+	_queueStats = stats;
+}
+
+int CameraGrabber::frameSetParts() const {
+
+	if (_useSimulation or _v4l2descr.index >= 0 or _opencv_dev_id >= 0) {
+		return 1;
+	}
+
+	if (!_parallelStreams) {
+		return 1;
+	}
+
+	// the depth frames come from the stereo sensor, with the infrared frames.
+	bool withNir = _streamProfiles[StreamProfiles::Left].enabled or _streamProfiles[StreamProfiles::Right].enabled or _streamProfiles[StreamProfiles::Depth].enabled;
+	bool withRgb = _streamProfiles[StreamProfiles::Rgb].enabled;
+
+	return std::max(1, ((withNir) ? 1 : 0) + ((withRgb) ? 1 : 0));
+}
 
 void CameraGrabber::run () {
 
+	ThreadTuning::applyToCurrentThread(ThreadTuning::Grabber);
+
 	_interruptionMutex.lock();
 	_continue = true;
 	_interruptionMutex.unlock();
 
-	if (_v4l2descr.index >= 0) {
+	if (_useSimulation) {
+
+		SimulatedCamera cam(_simulationConfig);
+
+		if (!cam.start()) {
+			emit acquisitionEndedWithError("Unable to start the simulated camera (is the replay folder empty ?)");
+			return;
+		}
+
+		while (_continue) {
+			cam.treatNextFrame([this] (ImageFrame const& left, ImageFrame const& right, ImageFrame const& rgb) {
+				Q_EMIT framesReady(left, right, rgb, ImageFrame());
+			});
+		}
+
+		cam.stop();
+
+	} else if (_v4l2descr.index >= 0) {
 
 		V4L2Camera cam(_v4l2descr);
 
@@ -124,7 +286,7 @@ void CameraGrabber::run () {
 					rgb.additionalInfos()[ImageFrame::colorSpaceKey] = cam.colorSpace();
 				}
 
-				Q_EMIT framesReady(left, right, rgb);
+				Q_EMIT framesReady(left, right, rgb, ImageFrame());
 			});
 
 			if (!ok) {
@@ -159,37 +321,234 @@ void CameraGrabber::run () {
 
 			ImageFrame frameRGB = cvFrameToImageFrame(frame);
 
-			Q_EMIT framesReady(frameLeft, frameRight, frameRGB);
+			Q_EMIT framesReady(frameLeft, frameRight, frameRGB, ImageFrame());
 		}
 
+	} else if (_parallelStreams) {
+
+		runRealSenseStreams();
+
 	} else {
 
 		rs2::pipeline pipe;
-		_pipeline_profile = pipe.start(_config);
+
+		try {
+			_pipeline_profile = pipe.start(_config);
+		} catch (std::runtime_error & e) {
+			emit acquisitionEndedWithError(e.what());
+			return;
+		}
+
+		if (_usePlayback) {
+			startPlayback(_pipeline_profile);
+		}
+
 		rs2::frameset frames;
+		qint64 nFrameSets = 0;
+		QElapsedTimer timer;
+		timer.start();
 
 		while (_continue) {
 			try {
-				frames = pipe.wait_for_frames();
+				if (_usePlayback) {
+					if (!pipe.try_wait_for_frames(&frames, 100)) {
+						if (playbackEnded()) {
+							emitPlaybackSummary(nFrameSets, 0, timer.elapsed());
+							break;
+						}
+						continue;
+					}
+				} else {
+					frames = pipe.wait_for_frames();
+				}
 			} catch (std::runtime_error & e) {
 				emit acquisitionEndedWithError(e.what());
 				break;
 			}
 
+			nFrameSets++;
+
 			rs2::frame fl = frames.get_infrared_frame(1);
 			rs2::frame fr = frames.get_infrared_frame(2);
 
 			rs2::frame frgb = frames.get_color_frame();
+			rs2::frame fdepth = frames.get_depth_frame();
 
 			ImageFrame frameLeft = realsenseFrameToImageFrame(fl);
 			ImageFrame frameRight = realsenseFrameToImageFrame(fr);
 
 			ImageFrame frameRGB = realsenseFrameToImageFrame(frgb);
+			ImageFrame frameDepth = realsenseFrameToImageFrame(fdepth);
+
+			Q_EMIT framesReady(frameLeft, frameRight, frameRGB, frameDepth);
+		}
+	}
+}
+void CameraGrabber::runRealSenseStreams() {
+
+	struct StreamPart {
+		qint64 frameSetNumber;
+		rs2::frameset frames;
+	};
+
+	// one queue per stream, so that a slow consumer on one stream only drops frames of its own stream.
+	SpscQueue<StreamPart> nirQueue(_nirQueueSize);
+	SpscQueue<StreamPart> rgbQueue(_rgbQueueSize);
+
+	std::atomic<qint64> nirDropped(0);
+	std::atomic<qint64> rgbDropped(0);
+	qint64 droppedFrameSets = 0; //only used by the librealsense thread, then read once it is stopped.
+
+	// when playing back as fast as possible, the playback waits for the workers instead of dropping framesets,
+	// so that the playback rate is the rate at which the framesets are processed.
+	bool throttle = _usePlayback and !_playbackConfig.realTime;
+
+	auto enqueue = [throttle] (SpscQueue<StreamPart> & queue, StreamPart const& part) {
+		return (throttle) ? queue.push(part) : queue.tryPush(part);
+	};
+
+	CaptureQueueStats & stats = *_queueStats;
+	qint64 frameSetNumber = 0;
+
+	QMutex errorMutex;
+	QString error;
+
+	auto reportError = [&errorMutex, &error] (QString const& txt) {
+		QMutexLocker locker(&errorMutex);
+		if (error.isEmpty()) {
+			error = txt;
+		}
+	};
+
+	auto hasError = [&errorMutex, &error] () {
+		QMutexLocker locker(&errorMutex);
+		return !error.isEmpty();
+	};
+
+	// called by the librealsense thread, which is the only producer of both queues.
+	auto dispatch = [&] (rs2::frame const& frame) {
+
+		rs2::frameset frames = frame.as<rs2::frameset>();
+
+		if (!frames) {
+			return;
+		}
+
+		StreamPart part = {frameSetNumber++, frames};
+		bool dropped = false;
+
+		if (frames.get_infrared_frame(1) or frames.get_infrared_frame(2) or frames.get_depth_frame()) {
+			if (!enqueue(nirQueue, part)) {
+				dropped = true;
+				nirDropped++;
+				stats.nirDropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			stats.nirQueued.store(static_cast<int>(nirQueue.sizeApprox()), std::memory_order_relaxed);
+		}
+
+		if (frames.get_color_frame()) {
+			if (!enqueue(rgbQueue, part)) {
+				dropped = true;
+				rgbDropped++;
+				stats.rgbDropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			stats.rgbQueued.store(static_cast<int>(rgbQueue.sizeApprox()), std::memory_order_relaxed);
+		}
+
+		if (dropped) {
+			droppedFrameSets++;
+		}
+	};
+
+	std::thread nirWorker([&] () {
+
+		ThreadTuning::applyToCurrentThread(ThreadTuning::Grabber);
+
+		StreamPart part;
+
+		while (nirQueue.pop(part)) {
+			try {
+				ImageFrame frameLeft = realsenseFrameToImageFrame(part.frames.get_infrared_frame(1));
+				ImageFrame frameRight = realsenseFrameToImageFrame(part.frames.get_infrared_frame(2));
+				ImageFrame frameDepth = realsenseFrameToImageFrame(part.frames.get_depth_frame());
+
+				Q_EMIT frameSetPartReady(part.frameSetNumber, frameLeft, frameRight, ImageFrame(), frameDepth);
+			} catch (std::runtime_error & e) {
+				reportError(e.what());
+				nirQueue.close(); //a throttled playback must not wait for this worker anymore.
+				return;
+			}
+		}
+	});
+
+	std::thread rgbWorker([&] () {
+
+		ThreadTuning::applyToCurrentThread(ThreadTuning::Grabber);
+
+		StreamPart part;
+
+		while (rgbQueue.pop(part)) {
+			try {
+				ImageFrame frameRGB = realsenseFrameToImageFrame(part.frames.get_color_frame());
+
+				Q_EMIT frameSetPartReady(part.frameSetNumber, ImageFrame(), ImageFrame(), frameRGB, ImageFrame());
+			} catch (std::runtime_error & e) {
+				reportError(e.what());
+				rgbQueue.close();
+				return;
+			}
+		}
+	});
+
+	rs2::pipeline pipe;
+	bool started = false;
+
+	QElapsedTimer timer;
+	timer.start();
 
-			Q_EMIT framesReady(frameLeft, frameRight, frameRGB);
+	try {
+		_pipeline_profile = pipe.start(_config, dispatch);
+		started = true;
+
+		if (_usePlayback) {
+			startPlayback(_pipeline_profile);
 		}
+	} catch (std::runtime_error & e) {
+		reportError(e.what());
+	}
+
+	bool finished = false;
+
+	while (_continue and !hasError() and !finished) {
+		msleep(10);
+		finished = started and playbackEnded();
+	}
+
+	if (started) {
+		pipe.stop();
+	}
+
+	nirQueue.close();
+	rgbQueue.close();
+
+	stats.nirQueued = 0;
+	stats.rgbQueued = 0;
+
+	nirWorker.join();
+	rgbWorker.join();
+
+	if (nirDropped > 0 or rgbDropped > 0) {
+		QTextStream out(stdout);
+		out << "Parallel capture dropped " << nirDropped.load() << " infrared and " << rgbDropped.load() << " color framesets (queues full)" << endl;
+	}
+
+	if (hasError()) {
+		emit acquisitionEndedWithError(error);
+	} else if (finished) {
+		emitPlaybackSummary(frameSetNumber - droppedFrameSets, droppedFrameSets, timer.elapsed());
 	}
 }
+
 void CameraGrabber::finish() {
 	_interruptionMutex.lock();
 	_continue = false;
@@ -199,7 +558,7 @@ void CameraGrabber::finish() {
 
 void CameraGrabber::setInfraRedPatternOn(bool on) {
 	_interruptionMutex.lock();
-	if (_pipeline_profile) {
+	if (_pipeline_profile and !_usePlayback) { //a played back device has no emitter to control.
 		rs2::device dev = _pipeline_profile.get_device();
 
 		auto depth_sensor = dev.first<rs2::depth_sensor>();
@@ -208,7 +567,7 @@ void CameraGrabber::setInfraRedPatternOn(bool on) {
 
 			float value = (on) ? 1.f : 0.f;
 
-			qDebug() << "discrete value: " << value;
+			qCDebug(lcCamera) << "Emitter enabled:" << value;
 			depth_sensor.set_option(RS2_OPTION_EMITTER_ENABLED, value);
 		}
 
@@ -218,7 +577,7 @@ void CameraGrabber::setInfraRedPatternOn(bool on) {
 			auto range = depth_sensor.get_option_range(RS2_OPTION_LASER_POWER);
 			float value = (on) ? range.max : 0.f;
 
-			qDebug() << "continuous value: " << value;
+			qCDebug(lcCamera) << "Laser power:" << value;
 			depth_sensor.set_option(RS2_OPTION_LASER_POWER, value);
 		}
 	}
@@ -229,6 +588,10 @@ ImageFrame realsenseFrameToImageFrame(const rs2::frame &f) {
 
 	using namespace rs2;
 
+	if (!f) {
+		return ImageFrame();
+	}
+
 	auto vf = f.as<video_frame>();
 	const int w = vf.get_width();
 	const int h = vf.get_height();
@@ -259,6 +622,20 @@ ImageFrame realsenseFrameToImageFrame(const rs2::frame &f) {
 					   false);
 		return ret;
 	}
+	else if (format == RS2_FORMAT_Z16)
+	{
+		ImageFrame ret((uint16_t*) f.get_data(),
+					   Multidim::Array<uint16_t,2>::ShapeBlock{h,w},
+					   Multidim::Array<uint16_t,2>::ShapeBlock{w,1},
+					   false);
+
+		std::shared_ptr<sensor> s = sensor_from_frame(f);
+		if (s and s->is<depth_sensor>()) {
+			ret.additionalInfos()[ImageFrame::depthScaleKey] = QString::number(s->as<depth_sensor>().get_depth_scale(), 'g', 9);
+		}
+
+		return ret;
+	}
 
 	throw std::runtime_error("Unsupported frame format !");
 }
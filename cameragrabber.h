@@ -6,23 +6,90 @@
 
 #include <librealsense2/rs.hpp>
 
+#include <atomic>
+#include <memory>
+
 #include "./imageframe.h"
 
 #include "./v4l2camera.h"
+#include "./simulatedcamera.h"
+#include "./streamprofiles.h"
 
 namespace cv{
 	class Mat;
 }
 
+/*!
+ * \brief The CaptureQueueStats struct expose the state of the parallel capture queues, it can be read from any thread.
+ *
+ * It is shared with the grabber instead of owned by it, so that it outlives the capture and accumulates over the captures.
+ */
+struct CaptureQueueStats {
+
+	CaptureQueueStats() :
+		nirDropped(0),
+		rgbDropped(0),
+		nirQueued(0),
+		rgbQueued(0)
+	{
+
+	}
+
+	std::atomic<qint64> nirDropped; //!< the framesets dropped because the queue was full.
+	std::atomic<qint64> rgbDropped;
+	std::atomic<int> nirQueued; //!< the framesets waiting in the queue.
+	std::atomic<int> rgbQueued;
+};
+
 class CameraGrabber : public QThread
 {
 	Q_OBJECT
 public:
+
+	/*!
+	 * \brief The PlaybackConfig struct describe how a RealSense .bag file is played back.
+	 */
+	struct PlaybackConfig {
+
+		PlaybackConfig() :
+			file(),
+			realTime(true),
+			loop(false)
+		{
+
+		}
+
+		QString file;
+		bool realTime; //!< if false, the frames are read as fast as they are processed.
+		bool loop;
+	};
+
 	explicit CameraGrabber(QObject *parent = nullptr);
 
 	rs2::config& config();
 	rs2::config const& config() const;
-	void setConfig(const rs2::config &config);
+	/*!
+	 * \brief setConfig set the realsense configuration, and enable the streams of the given profiles.
+	 */
+	void setConfig(const rs2::config &config, StreamProfiles::Config const& profiles);
+	StreamProfiles::Config const& streamProfiles() const;
+
+	/*!
+	 * \brief setPlaybackConfig use a RealSense .bag file instead of a device, all the streams of the file are captured.
+	 */
+	void setPlaybackConfig(PlaybackConfig const& config);
+	bool usePlayback() const;
+	PlaybackConfig const& playbackConfig() const;
+
+	/*!
+	 * \brief setBagRecordingFile record the live RealSense streams to a .bag file, must be called after setConfig.
+	 */
+	void setBagRecordingFile(QString const& file);
+
+	/*!
+	 * \brief playbackFps give the highest frame rate of the streams in a .bag file, or 0 if the file cannot be read.
+	 */
+	static int playbackFps(QString const& file);
 
 	V4L2Camera::Config& v4l2config();
 	V4L2Camera::Config const& v4l2config() const;
@@ -34,6 +101,20 @@ public:
 	V4L2Camera::Descriptor v4l2descr() const;
 	void setV4l2descr(const V4L2Camera::Descriptor &v4l2descr);
 
+	bool useSimulation() const;
+	SimulatedCamera::Config const& simulationConfig() const;
+	void setSimulationConfig(const SimulatedCamera::Config &config);
+
+	/*!
+	 * \brief frameSetParts give the number of parts each frameset is emitted in (see frameSetPartReady), or 1 if framesets are emitted whole.
+	 */
+	int frameSetParts() const;
+
+	/*!
+	 * \brief setQueueStats set the statistics updated by the parallel capture, must be called before the grabber starts.
+	 */
+	void setQueueStats(std::shared_ptr<CaptureQueueStats> const& stats);
+
 	virtual void run();
 	void finish();
 
@@ -41,24 +122,63 @@ public:
 
 Q_SIGNALS:
 
-	void framesReady(ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB);
+	void framesReady(ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB, ImageFrame frameDepth);
+	/*!
+	 * \brief frameSetPartReady is emitted instead of framesReady in the parallel capture mode, once with the infrared and depth frames and once with the color frame.
+	 *
+	 * The two parts are emitted from different threads, and the frames of the other part are invalid.
+	 */
+	void frameSetPartReady(qint64 frameSetNumber, ImageFrame frameLeft, ImageFrame frameRight, ImageFrame frameRGB, ImageFrame frameDepth);
 	void acquisitionEndedWithError(QString error);
+	/*!
+	 * \brief acquisitionFinished is emitted when the acquisition ends by itself, at the end of a played back file.
+	 */
+	void acquisitionFinished(QString summary);
 
 protected:
 
+	void loadCaptureModeSettings();
+	void startPlayback(rs2::pipeline_profile const& profile);
+	bool playbackEnded() const;
+	/*!
+	 * \brief emitPlaybackSummary emit acquisitionFinished with the rate of the framesets processed during the playback.
+	 * \param nFrameSets the framesets given to the consumers.
+	 * \param nDropped the framesets not processed (or only partly) because a queue was full, not counted in nFrameSets.
+	 */
+	void emitPlaybackSummary(qint64 nFrameSets, qint64 nDropped, qint64 elapsedMs);
+
+	void runRealSenseStreams();
+
 	rs2::config _config;
 	rs2::pipeline_profile _pipeline_profile;
+	StreamProfiles::Config _streamProfiles;
+
+	bool _parallelStreams;
+	int _nirQueueSize;
+	int _rgbQueueSize;
+	std::shared_ptr<CaptureQueueStats> _queueStats;
+
+	bool _usePlayback;
+	PlaybackConfig _playbackConfig;
+	rs2::device _playbackDevice;
+	QString _bagRecordingFile;
 
 	int _opencv_dev_id;
 
 	V4L2Camera::Config _v4l2config;
 	V4L2Camera::Descriptor _v4l2descr;
 
+	bool _useSimulation;
+	SimulatedCamera::Config _simulationConfig;
+
 	QMutex _interruptionMutex;
-	bool _continue;
+	std::atomic<bool> _continue; //!< written under _interruptionMutex, read without it by the capture loops.
 
 };
 
+/*!
+ * \brief realsenseFrameToImageFrame wrap the data of a realsense frame, or give an invalid frame if f is empty.
+ */
 ImageFrame realsenseFrameToImageFrame(const rs2::frame &f);
 ImageFrame cvFrameToImageFrame(const cv::Mat &frame);
 
@@ -4,6 +4,8 @@
 #include <opencv2/videoio.hpp>
 
 #include <QVector>
+#include <QSettings>
+#include <QFileInfo>
 #include <QDebug>
 
 #include "v4l2camera.h"
@@ -57,6 +59,14 @@ int CamerasList::v4l2DeviceId(int row) {
 	return _cams[row].v4l2DeviceId;
 }
 
+QString CamerasList::simulatedSource(int row) {
+	return _cams[row].simulatedSource;
+}
+
+QString CamerasList::playbackFile(int row) {
+	return _cams[row].playbackFile;
+}
+
 QVector<int> CamerasList::openCvDevicesIds() {
 	bool hasCam = true;
 	int device_id = 0;
@@ -78,13 +88,19 @@ QVector<int> CamerasList::openCvDevicesIds() {
 
 
 CamerasList::camInfos CamerasList::buildRsCamInfos(std::string serialNumber, QString name) {
-	return {serialNumber, name, true, -1, -1};
+	return {serialNumber, name, true, -1, -1, QString(), QString()};
 }
 CamerasList::camInfos CamerasList::buildOpenCvCamInfos(int device_id) {
-	return {QString("cv%1").arg(device_id).toStdString(), QString("OpenCV cam %1").arg(device_id), false, device_id, -1};
+	return {QString("cv%1").arg(device_id).toStdString(), QString("OpenCV cam %1").arg(device_id), false, device_id, -1, QString(), QString()};
 }
 CamerasList::camInfos CamerasList::buildV4L2CamInfos(int id, QString name) {
-	return {QString("v4l2_%1").arg(id).toStdString(), name, false, -1, id};
+	return {QString("v4l2_%1").arg(id).toStdString(), name, false, -1, id, QString(), QString()};
+}
+CamerasList::camInfos CamerasList::buildSimulatedCamInfos(QString source, QString name) {
+	return {QString("sim_%1").arg(source).toStdString(), name, false, -1, -1, source, QString()};
+}
+CamerasList::camInfos CamerasList::buildPlaybackCamInfos(QString file) {
+	return {QString("bag_%1").arg(QFileInfo(file).completeBaseName()).toStdString(), QFileInfo(file).fileName(), false, -1, -1, QString(), file};
 }
 
 void CamerasList::refreshCamerasList() {
@@ -117,5 +133,28 @@ void CamerasList::refreshCamerasList() {
 		_cams.push_back(info);
 	}
 
+	QSettings settings;
+	bool simulationEnabled = settings.value("simulation/enabled", false).toBool();
+	QString replayFolder = settings.value("simulation/replayfolder", "").toString();
+
+	settings.setValue("simulation/enabled", simulationEnabled);
+	settings.setValue("simulation/replayfolder", replayFolder);
+
+	if (simulationEnabled) {
+		_cams.push_back(buildSimulatedCamInfos("pattern", "Synthetic pattern"));
+
+		if (!replayFolder.isEmpty()) {
+			_cams.push_back(buildSimulatedCamInfos("replay", QString("Replay %1").arg(replayFolder)));
+		}
+	}
+
+	// a RealSense .bag recording, played back as if it was a connected device.
+	QString playbackFile = settings.value("playback/file", "").toString();
+	settings.setValue("playback/file", playbackFile);
+
+	if (!playbackFile.isEmpty() and QFileInfo(playbackFile).isFile()) {
+		_cams.push_back(buildPlaybackCamInfos(playbackFile));
+	}
+
 	endResetModel();
 }
@@ -16,6 +16,8 @@ public:
 	bool isRs(int row);
 	int openCvDeviceId(int row);
 	int v4l2DeviceId(int row);
+	QString simulatedSource(int row);
+	QString playbackFile(int row);
 
 	void refreshCamerasList();
 
@@ -29,8 +31,16 @@ protected:
 		bool isRs;
 		int openCvDeviceId;
 		int v4l2DeviceId;
+		QString simulatedSource;
+		QString playbackFile;
 
 		inline QString getDescr() const {
+			if (!simulatedSource.isEmpty()) {
+				return QString("%1 (Simulated)").arg(name);
+			}
+			if (!playbackFile.isEmpty()) {
+				return QString("%1 (Playback)").arg(name);
+			}
 			if (!isRs) {
 				if (v4l2DeviceId >= 0) {
 					return QString("%1 (V4L2 %2)").arg(name).arg(v4l2DeviceId);
@@ -47,6 +57,8 @@ protected:
 	camInfos buildRsCamInfos(std::string serialNumber, QString name);
 	camInfos buildOpenCvCamInfos(int id);
 	camInfos buildV4L2CamInfos(int id, QString name);
+	camInfos buildSimulatedCamInfos(QString source, QString name);
+	camInfos buildPlaybackCamInfos(QString file);
 
 	QList<camInfos> _cams;
 };
@@ -4,6 +4,7 @@
 #include <QFile>
 #include <QDebug>
 #include <QThread>
+#include <QStringList>
 
 const QString ConsoleWatcher::exit_cmd = "exit";
 const QString ConsoleWatcher::set_folder_cmd = "output";
@@ -14,6 +15,7 @@ const QString ConsoleWatcher::stop_save_cmd = "stopsave";
 const QString ConsoleWatcher::record_interval_cmd = "saveinterval";
 const QString ConsoleWatcher::stop_record_cmd = "stop";
 const QString ConsoleWatcher::export_record_cmd = "export";
+const QString ConsoleWatcher::verify_cmd = "verify";
 const QString ConsoleWatcher::ir_toggle_cmd = "irpattern";
 const QString ConsoleWatcher::list_cams_cmd = "list";
 const QString ConsoleWatcher::list_connections_cmd = "remotes";
@@ -24,6 +26,15 @@ const QString ConsoleWatcher::time_cmd = "time";
 const QString ConsoleWatcher::config_time_cmd = "cfgtime";
 const QString ConsoleWatcher::batch_cmd = "batch";
 const QString ConsoleWatcher::tcp_timing_cmd = "tcptime";
+const QString ConsoleWatcher::pretrigger_cmd = "pretrigger";
+const QString ConsoleWatcher::disk_status_cmd = "diskstatus";
+const QString ConsoleWatcher::status_cmd = "status";
+const QString ConsoleWatcher::watch_cmd = "watch";
+const QString ConsoleWatcher::threads_cmd = "threads";
+const QString ConsoleWatcher::thread_cpus_cmd = "threadcpus";
+const QString ConsoleWatcher::thread_policy_cmd = "threadpolicy";
+const QString ConsoleWatcher::stream_profiles_cmd = "profiles";
+const QString ConsoleWatcher::stream_profile_cmd = "profile";
 const QString ConsoleWatcher::wait_cmd = "wait";
 const QString ConsoleWatcher::help_cmd = "help";
 
@@ -196,6 +207,15 @@ void ConsoleWatcher::runCommand(QString line) {
 			emit exportRecordTriggered();
 		}
 
+	} else if (cmd == verify_cmd) {
+
+		// verify, or verify <folder>
+		if (values.size() != 1 and values.size() != 2) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			emit verifyTriggered((values.size() == 2) ? values[1].toString() : QString());
+		}
+
 	} else if (cmd == ir_toggle_cmd) {
 
 		if (values.size() != 2) {
@@ -298,6 +318,122 @@ void ConsoleWatcher::runCommand(QString line) {
 			tcpTimingTriggered(values[1].toString().toLower() == "enabled");
 		}
 
+	} else if (cmd == pretrigger_cmd) {
+
+		if (values.size() != 2) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			bool ok;
+			double seconds = values[1].toDouble(&ok);
+
+			if (!ok or seconds < 0) {
+				Q_EMIT InvalidTriggered(line);
+			} else {
+				emit preTriggerTriggered(seconds);
+			}
+		}
+
+	} else if (cmd == disk_status_cmd) {
+
+		if (values.size() != 1) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			emit diskStatusTriggered();
+		}
+
+	} else if (cmd == status_cmd) {
+
+		if (values.size() != 1) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			emit statusTriggered();
+		}
+
+	} else if (cmd == watch_cmd) {
+
+		// watch <seconds>, or watch off
+		if (values.size() != 2) {
+			Q_EMIT InvalidTriggered(line);
+		} else if (values[1].toString().toLower() == "off") {
+			emit watchTriggered(0);
+		} else {
+			bool ok;
+			double seconds = values[1].toDouble(&ok);
+
+			if (!ok or seconds < 0.1) {
+				Q_EMIT InvalidTriggered(line);
+			} else {
+				emit watchTriggered(static_cast<int>(seconds*1000));
+			}
+		}
+
+	} else if (cmd == threads_cmd) {
+
+		if (values.size() != 1) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			emit threadsStatusTriggered();
+		}
+
+	} else if (cmd == thread_cpus_cmd) {
+
+		if (values.size() != 3) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			emit threadCpusTriggered(values[1].toString(), values[2].toString());
+		}
+
+	} else if (cmd == thread_policy_cmd) {
+
+		if (values.size() != 3 and values.size() != 4) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			bool ok = true;
+			int priority = (values.size() == 4) ? values[3].toInt(&ok) : 0;
+
+			if (!ok or priority < 0) {
+				Q_EMIT InvalidTriggered(line);
+			} else {
+				emit threadPolicyTriggered(values[1].toString(), values[2].toString().toLower(), priority);
+			}
+		}
+
+	} else if (cmd == stream_profiles_cmd) {
+
+		if (values.size() != 2) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			bool ok;
+			int cam = values[1].toInt(&ok);
+
+			if (!ok) {
+				Q_EMIT InvalidTriggered(line);
+			} else {
+				emit streamProfilesStatusTriggered(cam);
+			}
+		}
+
+	} else if (cmd == stream_profile_cmd) {
+
+		// profile <camera> <stream> off, or profile <camera> <stream> <format> <width>x<height>@<fps>
+		if (values.size() != 4 and values.size() != 5) {
+			Q_EMIT InvalidTriggered(line);
+		} else {
+			bool ok;
+			int cam = values[1].toInt(&ok);
+
+			QStringList profile;
+			for (int i = 3; i < values.size(); i++) {
+				profile << values[i].toString();
+			}
+
+			if (!ok) {
+				Q_EMIT InvalidTriggered(line);
+			} else {
+				emit streamProfileTriggered(cam, values[2].toString().toLower(), profile.join(' '));
+			}
+		}
+
 	} else if (cmd == wait_cmd) {
 
 		if (values.size() != 2) {
@@ -20,6 +20,7 @@ public:
 	static const QString record_interval_cmd;
 	static const QString stop_record_cmd;
 	static const QString export_record_cmd;
+	static const QString verify_cmd;
 	static const QString ir_toggle_cmd;
 	static const QString list_cams_cmd;
 	static const QString list_connections_cmd;
@@ -30,6 +31,15 @@ public:
 	static const QString config_time_cmd;
 	static const QString batch_cmd;
 	static const QString tcp_timing_cmd;
+	static const QString pretrigger_cmd;
+	static const QString disk_status_cmd;
+	static const QString status_cmd;
+	static const QString watch_cmd;
+	static const QString threads_cmd;
+	static const QString thread_cpus_cmd;
+	static const QString thread_policy_cmd;
+	static const QString stream_profiles_cmd;
+	static const QString stream_profile_cmd;
 	static const QString wait_cmd;
 	static const QString help_cmd;
 
@@ -53,6 +63,7 @@ Q_SIGNALS:
 	void saveImgsIntervalTriggered(int nImgs, int msec);
 	void stopRecordTriggered();
 	void exportRecordTriggered();
+	void verifyTriggered(QString folder); //!< empty for the output folder.
 	void setIrPatternTriggered(bool on);
 	void listCamerasTriggered();
 	void listConnectionsTriggered();
@@ -62,6 +73,15 @@ Q_SIGNALS:
 	void timeTriggered();
 	void configTimeTriggered(QString timeServerAddr, quint16 port);
 	void tcpTimingTriggered(bool enabled);
+	void preTriggerTriggered(double seconds);
+	void diskStatusTriggered();
+	void statusTriggered();
+	void watchTriggered(int msec); //!< 0 stop watching.
+	void threadsStatusTriggered();
+	void threadCpusTriggered(QString role, QString cpus);
+	void threadPolicyTriggered(QString role, QString policy, int priority);
+	void streamProfilesStatusTriggered(int camRow);
+	void streamProfileTriggered(int camRow, QString stream, QString profile);
 	void sleepTrigger(uint ms);
 	void helpTriggered();
 	void InvalidTriggered(QString cmd);
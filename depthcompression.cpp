@@ -0,0 +1,205 @@
+#include "depthcompression.h"
+
+namespace {
+
+class NibbleWriter
+{
+public:
+
+	NibbleWriter(uint8_t* out, size_t capacity) :
+		_out(out),
+		_capacity(capacity),
+		_written(0),
+		_word(0),
+		_nibbles(0),
+		_overflow(false)
+	{
+
+	}
+
+	inline void writeVle(uint32_t value) {
+		do {
+			uint32_t nibble = value & 0x7;
+			value >>= 3;
+			if (value != 0) {
+				nibble |= 0x8;
+			}
+			_word = (_word << 4) | nibble;
+			if (++_nibbles == 8) {
+				flushWord();
+			}
+		} while (value != 0);
+	}
+
+	int64_t finish() {
+		if (_nibbles > 0) {
+			_word <<= 4*(8 - _nibbles);
+			flushWord();
+		}
+		return (_overflow) ? -1 : static_cast<int64_t>(_written);
+	}
+
+protected:
+
+	inline void flushWord() {
+		if (_written + 4 > _capacity) {
+			_overflow = true;
+		} else {
+			_out[_written] = static_cast<uint8_t>(_word);
+			_out[_written+1] = static_cast<uint8_t>(_word >> 8);
+			_out[_written+2] = static_cast<uint8_t>(_word >> 16);
+			_out[_written+3] = static_cast<uint8_t>(_word >> 24);
+			_written += 4;
+		}
+		_word = 0;
+		_nibbles = 0;
+	}
+
+	uint8_t* _out;
+	size_t _capacity;
+	size_t _written;
+	uint32_t _word;
+	int _nibbles;
+	bool _overflow;
+};
+
+class NibbleReader
+{
+public:
+
+	NibbleReader(uint8_t const* data, size_t dataBytes) :
+		_data(data),
+		_dataBytes(dataBytes),
+		_read(0),
+		_word(0),
+		_nibbles(0)
+	{
+
+	}
+
+	inline bool readVle(uint32_t & value) {
+
+		value = 0;
+		int shift = 0;
+		uint32_t nibble;
+
+		do {
+			if (_nibbles == 0) {
+				if (_read + 4 > _dataBytes) {
+					return false;
+				}
+				_word = static_cast<uint32_t>(_data[_read]) |
+						(static_cast<uint32_t>(_data[_read+1]) << 8) |
+						(static_cast<uint32_t>(_data[_read+2]) << 16) |
+						(static_cast<uint32_t>(_data[_read+3]) << 24);
+				_read += 4;
+				_nibbles = 8;
+			}
+
+			if (shift > 30) { //more nibbles than any 32 bits value needs.
+				return false;
+			}
+
+			nibble = _word >> 28;
+			_word <<= 4;
+			_nibbles--;
+
+			value |= (nibble & 0x7) << shift;
+			shift += 3;
+		} while (nibble & 0x8);
+
+		return true;
+	}
+
+protected:
+
+	uint8_t const* _data;
+	size_t _dataBytes;
+	size_t _read;
+	uint32_t _word;
+	int _nibbles;
+};
+
+} // namespace
+
+size_t DepthCompression::rvlMaxBytes(size_t nPixels) {
+	// a non zero pixel takes at most 6 nibbles (a 17 bits zigzag delta), and each pixel starts at most 2 runs of 1 nibble.
+	return 4*nPixels + 16;
+}
+
+int64_t DepthCompression::rvlEncode(uint16_t const* pixels, size_t nPixels, uint8_t* out, size_t capacity) {
+
+	NibbleWriter writer(out, capacity);
+
+	uint16_t const* input = pixels;
+	uint16_t const* end = pixels + nPixels;
+	int32_t previous = 0;
+
+	while (input != end) {
+
+		uint32_t zeros = 0;
+		for (; input != end and *input == 0; input++) {
+			zeros++;
+		}
+		writer.writeVle(zeros);
+
+		uint32_t nonzeros = 0;
+		for (uint16_t const* p = input; p != end and *p != 0; p++) {
+			nonzeros++;
+		}
+		writer.writeVle(nonzeros);
+
+		for (uint32_t i = 0; i < nonzeros; i++) {
+			int32_t current = *input++;
+			int32_t delta = current - previous;
+			writer.writeVle((static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31));
+			previous = current;
+		}
+	}
+
+	return writer.finish();
+}
+
+bool DepthCompression::rvlDecode(uint8_t const* data, size_t dataBytes, uint16_t* pixels, size_t nPixels) {
+
+	NibbleReader reader(data, dataBytes);
+
+	uint16_t* output = pixels;
+	uint16_t* end = pixels + nPixels;
+	int32_t previous = 0;
+
+	while (output != end) {
+
+		uint32_t zeros;
+		uint32_t nonzeros;
+
+		if (!reader.readVle(zeros) or zeros > static_cast<size_t>(end - output)) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < zeros; i++) {
+			*output++ = 0;
+		}
+
+		if (!reader.readVle(nonzeros) or nonzeros > static_cast<size_t>(end - output)) {
+			return false;
+		}
+
+		if (zeros == 0 and nonzeros == 0) { //would never end.
+			return false;
+		}
+
+		for (uint32_t i = 0; i < nonzeros; i++) {
+			uint32_t positive;
+			if (!reader.readVle(positive)) {
+				return false;
+			}
+			int32_t delta = static_cast<int32_t>(positive >> 1) ^ -static_cast<int32_t>(positive & 1);
+			int32_t current = previous + delta;
+			*output++ = static_cast<uint16_t>(current);
+			previous = current;
+		}
+	}
+
+	return true;
+}
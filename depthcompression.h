@@ -0,0 +1,37 @@
+#ifndef DEPTHCOMPRESSION_H
+#define DEPTHCOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * \brief The DepthCompression class implement the RVL lossless compression of 16 bits depth images.
+ *
+ * RVL (A. D. Wilson, "Fast Lossless Depth Image Compression", 2017) encodes the image as alternating runs of zero
+ * and non zero pixels, the non zero pixels being stored as the zigzag encoded difference with the previous non zero pixel.
+ * All the integers are written with a variable length code made of 4 bits nibbles (3 bits of payload and a continuation bit),
+ * packed by 8 in 32 bits little endian words. It runs in a single pass, with no table, at several hundred MB/s.
+ */
+class DepthCompression
+{
+public:
+
+	/*!
+	 * \brief rvlMaxBytes give an upper bound of the compressed size of an image of nPixels pixels.
+	 */
+	static size_t rvlMaxBytes(size_t nPixels);
+
+	/*!
+	 * \brief rvlEncode compress nPixels depth values.
+	 * \return the number of bytes written in out (a multiple of 4, 0 for an empty image), or -1 if capacity is too small.
+	 */
+	static int64_t rvlEncode(uint16_t const* pixels, size_t nPixels, uint8_t* out, size_t capacity);
+
+	/*!
+	 * \brief rvlDecode decompress exactly nPixels depth values.
+	 * \return false if the data is truncated or corrupted.
+	 */
+	static bool rvlDecode(uint8_t const* data, size_t dataBytes, uint16_t* pixels, size_t nPixels);
+};
+
+#endif // DEPTHCOMPRESSION_H
@@ -0,0 +1,147 @@
+#include "framechecksum.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+const uint32_t castagnoliPolynomial = 0x82F63B78; //reflected
+
+struct SlicingTables {
+
+	SlicingTables() {
+
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; bit++) {
+				crc = (crc & 1) ? (crc >> 1) ^ castagnoliPolynomial : crc >> 1;
+			}
+			table[0][i] = crc;
+		}
+
+		for (int k = 1; k < 8; k++) {
+			for (int i = 0; i < 256; i++) {
+				table[k][i] = (table[k-1][i] >> 8) ^ table[0][table[k-1][i] & 0xFF];
+			}
+		}
+	}
+
+	uint32_t table[8][256];
+};
+
+uint32_t crc32cSoftware(uint8_t const* data, size_t bytes, uint32_t crc) {
+
+	static const SlicingTables tables;
+	auto const& t = tables.table;
+
+	while (bytes >= 8) {
+		uint32_t low;
+		uint32_t high;
+		std::memcpy(&low, data, 4);
+		std::memcpy(&high, data + 4, 4);
+		low ^= crc;
+
+		crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+			  t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+
+		data += 8;
+		bytes -= 8;
+	}
+
+	while (bytes > 0) {
+		crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+		data++;
+		bytes--;
+	}
+
+	return crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+uint32_t crc32cHardware(uint8_t const* data, size_t bytes, uint32_t crc) {
+
+	uint64_t crc64 = crc;
+
+	while (bytes >= 8) {
+		uint64_t word;
+		std::memcpy(&word, data, 8);
+		crc64 = _mm_crc32_u64(crc64, word);
+		data += 8;
+		bytes -= 8;
+	}
+
+	crc = static_cast<uint32_t>(crc64);
+
+	while (bytes > 0) {
+		crc = _mm_crc32_u8(crc, *data);
+		data++;
+		bytes--;
+	}
+
+	return crc;
+}
+
+bool hasHardwareCrc() {
+	static const bool supported = __builtin_cpu_supports("sse4.2");
+	return supported;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+
+uint32_t crc32cHardware(uint8_t const* data, size_t bytes, uint32_t crc) {
+
+	while (bytes >= 8) {
+		uint64_t word;
+		std::memcpy(&word, data, 8);
+		crc = __crc32cd(crc, word);
+		data += 8;
+		bytes -= 8;
+	}
+
+	while (bytes > 0) {
+		crc = __crc32cb(crc, *data);
+		data++;
+		bytes--;
+	}
+
+	return crc;
+}
+
+bool hasHardwareCrc() {
+	return true;
+}
+
+#else
+
+uint32_t crc32cHardware(uint8_t const* data, size_t bytes, uint32_t crc) {
+	return crc32cSoftware(data, bytes, crc);
+}
+
+bool hasHardwareCrc() {
+	return false;
+}
+
+#endif
+
+} // namespace
+
+uint32_t FrameChecksum::crc32c(void const* data, size_t bytes, uint32_t crc) {
+
+	uint8_t const* bytesData = static_cast<uint8_t const*>(data);
+
+	crc = ~crc;
+	crc = (hasHardwareCrc()) ? crc32cHardware(bytesData, bytes, crc) : crc32cSoftware(bytesData, bytes, crc);
+
+	return ~crc;
+}
+
+bool FrameChecksum::isHardwareAccelerated() {
+	return hasHardwareCrc();
+}
@@ -0,0 +1,26 @@
+#ifndef FRAMECHECKSUM_H
+#define FRAMECHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * \brief The FrameChecksum class compute the CRC32C (Castagnoli) checksums used to verify the integrity of the recorded frames.
+ *
+ * The checksum uses the crc32 instructions of SSE 4.2 (x86) or ARMv8 when the cpu has them, selected at runtime on x86,
+ * and a slicing by 8 table implementation otherwise. The hardware path runs at several GB/s per core.
+ */
+class FrameChecksum
+{
+public:
+
+	/*!
+	 * \brief crc32c compute the checksum of a buffer.
+	 * \param crc the checksum of the preceding data, to checksum data split in several buffers, 0 for the first buffer.
+	 */
+	static uint32_t crc32c(void const* data, size_t bytes, uint32_t crc = 0);
+
+	static bool isHardwareAccelerated();
+};
+
+#endif // FRAMECHECKSUM_H
@@ -0,0 +1,671 @@
+#include "frameencoders.h"
+
+#include "imageframe.h"
+
+#include "LibStevi/imageProcessing/colorConversions.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QSysInfo>
+#include <QtEndian>
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstring>
+#include <functional>
+
+#include <sys/mman.h>
+
+#include <png.h>
+#include <zlib.h>
+#include <tiffio.h>
+
+extern "C" {
+#include <jpeglib.h>
+}
+
+namespace {
+
+const size_t fileBufferBytes = 1 << 20;
+const int conversionBlockRows = 8; //!< the rows converted at once when streaming a yuv frame.
+
+template<typename T>
+void collectImageRows(Multidim::Array<T, 2>* img, std::vector<uint8_t> & packed, std::vector<uint8_t*> & rows) {
+
+	const int h = img->shape()[0];
+	const int w = img->shape()[1];
+
+	rows.resize(h);
+
+	if (img->strides()[1] == 1) {
+		for (int i = 0; i < h; i++) {
+			rows[i] = reinterpret_cast<uint8_t*>(&img->atUnchecked(i,0));
+		}
+		return;
+	}
+
+	packed.resize(h*w*sizeof (T));
+	T* dst = reinterpret_cast<T*>(packed.data());
+
+	for (int i = 0; i < h; i++) {
+		for (int j = 0; j < w; j++) {
+			dst[i*w + j] = img->atUnchecked(i,j);
+		}
+		rows[i] = packed.data() + i*w*sizeof (T);
+	}
+}
+
+template<typename T>
+void collectImageRows(Multidim::Array<T, 3>* img, std::vector<uint8_t> & packed, std::vector<uint8_t*> & rows) {
+
+	const int h = img->shape()[0];
+	const int w = img->shape()[1];
+	const int c = img->shape()[2];
+
+	rows.resize(h);
+
+	if (img->strides()[2] == 1 and img->strides()[1] == c) {
+		for (int i = 0; i < h; i++) {
+			rows[i] = reinterpret_cast<uint8_t*>(&img->atUnchecked(i,0,0));
+		}
+		return;
+	}
+
+	packed.resize(h*w*c*sizeof (T));
+	T* dst = reinterpret_cast<T*>(packed.data());
+
+	for (int i = 0; i < h; i++) {
+		for (int j = 0; j < w; j++) {
+			for (int k = 0; k < c; k++) {
+				dst[(i*w + j)*c + k] = img->atUnchecked(i,j,k);
+			}
+		}
+		rows[i] = packed.data() + i*w*c*sizeof (T);
+	}
+}
+
+int elementBytes(ImageFrame::ImgType type) {
+
+	int bytes = 0;
+
+	ImageFrame::visitFormat(type, [&bytes] (auto format) {
+		bytes = sizeof (typename decltype(format)::Element);
+	});
+
+	return bytes;
+}
+
+bool closeFile(FILE* file) {
+	bool ok = std::fflush(file) == 0;
+	return (std::fclose(file) == 0) and ok;
+}
+
+int pngColorType(int channels) {
+	switch (channels) {
+	case 2:
+		return PNG_COLOR_TYPE_GRAY_ALPHA;
+	case 3:
+		return PNG_COLOR_TYPE_RGB;
+	case 4:
+		return PNG_COLOR_TYPE_RGB_ALPHA;
+	default:
+		return PNG_COLOR_TYPE_GRAY;
+	}
+}
+
+int pngFilters(QString const& filter) {
+	if (filter == "none") {
+		return PNG_FILTER_NONE;
+	}
+	if (filter == "up") {
+		return PNG_FILTER_UP;
+	}
+	if (filter == "avg") {
+		return PNG_FILTER_AVG;
+	}
+	if (filter == "paeth") {
+		return PNG_FILTER_PAETH;
+	}
+	if (filter == "all") {
+		return PNG_ALL_FILTERS;
+	}
+	return PNG_FILTER_SUB;
+}
+
+int zlibStrategy(QString const& strategy) {
+	if (strategy == "filtered") {
+		return Z_FILTERED;
+	}
+	if (strategy == "rle") {
+		return Z_RLE;
+	}
+	if (strategy == "huffman") {
+		return Z_HUFFMAN_ONLY;
+	}
+	return Z_DEFAULT_STRATEGY;
+}
+
+} // namespace
+
+struct FrameEncoders::Rows {
+
+	inline size_t rowBytes() const { return static_cast<size_t>(width)*channels*elementBytes(type); }
+
+	ImageFrame::ImgType type;
+	int height;
+	int width;
+	int channels;
+	std::function<uint8_t const*(int)> row; //!< called with increasing row indices, the row stays valid until the next call.
+};
+
+struct FrameEncoders::JpegState {
+
+	struct ErrorManager {
+		jpeg_error_mgr pub;
+		std::jmp_buf jump;
+	};
+
+	static void onError(j_common_ptr cinfo) {
+		(*cinfo->err->output_message)(cinfo);
+		std::longjmp(reinterpret_cast<ErrorManager*>(cinfo->err)->jump, 1);
+	}
+
+	JpegState() {
+		cinfo.err = jpeg_std_error(&error.pub);
+		error.pub.error_exit = &JpegState::onError;
+		jpeg_create_compress(&cinfo);
+	}
+
+	~JpegState() {
+		jpeg_destroy_compress(&cinfo);
+	}
+
+	jpeg_compress_struct cinfo;
+	ErrorManager error;
+};
+
+FrameEncoders::Config FrameEncoders::Config::fromSettings() {
+
+	Config config;
+	QSettings settings;
+
+	for (QString const& stream : streams()) {
+
+		Settings defaults;
+		Settings s;
+		QString prefix = "export/" + stream + "/";
+
+		s.format = settings.value(prefix + "format", defaults.format).toString().toLower();
+		s.pngLevel = std::max(0, std::min(9, settings.value(prefix + "pnglevel", defaults.pngLevel).toInt()));
+		s.pngFilter = settings.value(prefix + "pngfilter", defaults.pngFilter).toString().toLower();
+		s.pngStrategy = settings.value(prefix + "pngstrategy", defaults.pngStrategy).toString().toLower();
+		s.tiffCompression = settings.value(prefix + "tiffcompression", defaults.tiffCompression).toString().toLower();
+		s.jpegQuality = std::max(1, std::min(100, settings.value(prefix + "jpegquality", defaults.jpegQuality).toInt()));
+
+		if (!formats().contains(s.format) or (s.format == "video" and stream != "rgb")) {
+			s.format = defaults.format;
+		}
+		if (!QStringList({"none", "sub", "up", "avg", "paeth", "all"}).contains(s.pngFilter)) {
+			s.pngFilter = defaults.pngFilter;
+		}
+		if (!QStringList({"default", "filtered", "rle", "huffman"}).contains(s.pngStrategy)) {
+			s.pngStrategy = defaults.pngStrategy;
+		}
+		if (s.tiffCompression != "lzw" and s.tiffCompression != "none") {
+			s.tiffCompression = defaults.tiffCompression;
+		}
+
+		settings.setValue(prefix + "format", s.format);
+		settings.setValue(prefix + "pnglevel", s.pngLevel);
+		settings.setValue(prefix + "pngfilter", s.pngFilter);
+		settings.setValue(prefix + "pngstrategy", s.pngStrategy);
+		settings.setValue(prefix + "tiffcompression", s.tiffCompression);
+		settings.setValue(prefix + "jpegquality", s.jpegQuality);
+
+		config.streams.insert(stream, s);
+	}
+
+	return config;
+}
+
+FrameEncoders::Settings FrameEncoders::Config::settings(QString const& stream) const {
+	return streams.value(stream, Settings());
+}
+
+FrameEncoders::ColorConversion FrameEncoders::colorConversion(QString const& colorSpace) {
+	if (colorSpace == "YUYV") {
+		return [] (Multidim::Array<uint8_t, 3> const& img) { return StereoVision::ImageProcessing::yuyv2rgb<uint8_t,3>(img); };
+	}
+	if (colorSpace == "YVYU") {
+		return [] (Multidim::Array<uint8_t, 3> const& img) { return StereoVision::ImageProcessing::yvyu2rgb<uint8_t,3>(img); };
+	}
+	if (colorSpace == "YUV") {
+		return [] (Multidim::Array<uint8_t, 3> const& img) { return StereoVision::ImageProcessing::yuv2rgb<uint8_t,3>(img); };
+	}
+	return ColorConversion();
+}
+
+QStringList FrameEncoders::streams() {
+	return {"left", "right", "rgb", "depth"};
+}
+
+QStringList FrameEncoders::formats() {
+	return {"png", "tiff", "pnm", "jpeg", "video"};
+}
+
+QString FrameEncoders::streamOfFile(QString const& framePath) {
+	QString baseName = QFileInfo(framePath).baseName();
+	return baseName.mid(baseName.lastIndexOf('_') + 1);
+}
+
+FrameEncoders::FrameEncoders(Config const& config) :
+	_config(config)
+{
+
+}
+
+FrameEncoders::~FrameEncoders() = default;
+
+void FrameEncoders::configure(Config const& config) {
+	_config = config;
+}
+
+FrameEncoders::Config const& FrameEncoders::config() const {
+	return _config;
+}
+
+bool FrameEncoders::encode(ImageFrame const& frame, QString const& stream, QString const& basePath, QString & outPath) {
+
+	if (!frame.isValid() or !collectRows(frame)) {
+		return false;
+	}
+
+	Rows rows;
+	rows.type = frame.imgType();
+	rows.height = frame.height();
+	rows.width = frame.width();
+	rows.channels = frame.channels();
+	rows.row = [this] (int i) -> uint8_t const* { return _rows[i]; };
+
+	return writeRows(rows, stream, basePath, outPath);
+}
+
+bool FrameEncoders::encodeRawFile(QString const& rawFramePath, QString const& stream, QString const& colorSpace, QString const& basePath, QString & outPath) {
+
+	QFile file(rawFramePath);
+
+	if (!file.open(QIODevice::ReadOnly) or file.size() < static_cast<qint64>(ImageFrame::rawHeaderBytes)) {
+		return false;
+	}
+
+	uchar* map = file.map(0, file.size());
+
+	if (map == nullptr) {
+		return false;
+	}
+
+	ImageFrame::RawLayout layout;
+
+	if (!ImageFrame::readRawLayout(map, layout) or layout.encoding != ImageFrame::RawPlain or layout.height <= 0 or layout.width <= 0) {
+		file.unmap(map);
+		return false;
+	}
+
+	Rows rows;
+	rows.type = layout.type;
+	rows.height = layout.height;
+	rows.width = layout.width;
+	rows.channels = layout.channels;
+
+	const size_t srcRowBytes = rows.rowBytes();
+
+	if (ImageFrame::rawHeaderBytes + srcRowBytes*rows.height > static_cast<size_t>(file.size())) {
+		file.unmap(map);
+		return false;
+	}
+
+	posix_madvise(map, file.size(), POSIX_MADV_SEQUENTIAL);
+
+	uint8_t const* pixels = map + ImageFrame::rawHeaderBytes;
+	ColorConversion convert = (layout.type == ImageFrame::MULTICHANNEL_8) ? colorConversion(colorSpace) : ColorConversion();
+
+	Multidim::Array<uint8_t, 3> block;
+	int blockStart = 0;
+
+	auto convertBlock = [&] (int start) {
+
+		const int n = std::min(conversionBlockRows, layout.height - start);
+		const int w = layout.width;
+		const int c = layout.channels;
+
+		Multidim::Array<uint8_t, 3> src(const_cast<uint8_t*>(pixels + start*srcRowBytes),
+										Multidim::Array<uint8_t, 3>::ShapeBlock{n,w,c},
+										Multidim::Array<uint8_t, 3>::ShapeBlock{w*c,c,1},
+										false);
+		block = convert(src);
+		blockStart = start;
+
+		return !block.empty() and block.shape()[0] == n;
+	};
+
+	if (!convert) {
+		rows.row = [pixels, srcRowBytes] (int i) -> uint8_t const* { return pixels + i*srcRowBytes; };
+	} else {
+
+		if (!convertBlock(0)) {
+			file.unmap(map);
+			return false;
+		}
+
+		rows.width = block.shape()[1];
+		rows.channels = block.shape()[2];
+
+		rows.row = [&] (int i) -> uint8_t const* {
+
+			if (i >= blockStart + block.shape()[0]) {
+				convertBlock(i); //a failed conversion leaves an empty block, the encoder then gets an empty row.
+			}
+
+			if (block.empty()) {
+				_convertedLine.assign(rows.rowBytes(), 0);
+				return _convertedLine.data();
+			}
+
+			if (block.strides()[2] == 1 and block.strides()[1] == rows.channels) {
+				return &block.atUnchecked(i - blockStart, 0, 0);
+			}
+
+			_convertedLine.resize(rows.rowBytes());
+
+			for (int j = 0; j < rows.width; j++) {
+				for (int k = 0; k < rows.channels; k++) {
+					_convertedLine[j*rows.channels + k] = block.atUnchecked(i - blockStart, j, k);
+				}
+			}
+
+			return _convertedLine.data();
+		};
+	}
+
+	bool ok = writeRows(rows, stream, basePath, outPath);
+
+	file.unmap(map);
+
+	return ok;
+}
+
+bool FrameEncoders::writeRows(Rows const& rows, QString const& stream, QString const& basePath, QString & outPath) {
+
+	Settings settings = _config.settings(stream);
+	QString format = settings.format;
+
+	if (!supports(format, rows)) {
+		format = "png";
+	}
+	if (!supports(format, rows)) { //floating point frames
+		format = "tiff";
+	}
+
+	if (format == "tiff") {
+		outPath = basePath + ".tiff";
+		return writeTiff(rows, settings, outPath);
+	}
+
+	if (format == "pnm") {
+		outPath = basePath + ((rows.channels == 3) ? ".ppm" : ".pgm");
+		return writePnm(rows, outPath);
+	}
+
+	if (format == "jpeg") {
+		outPath = basePath + ".jpg";
+		return writeJpeg(rows, settings, outPath);
+	}
+
+	outPath = basePath + ".png";
+	return writePng(rows, settings, outPath);
+}
+
+bool FrameEncoders::supports(QString const& format, Rows const& rows) {
+
+	ImageFrame::ImgType type = rows.type;
+	int channels = rows.channels;
+
+	if (format == "tiff") {
+		return type != ImageFrame::INVALID;
+	}
+
+	if (format == "png") {
+		return type == ImageFrame::GRAY_8 or type == ImageFrame::GRAY_16 or (type == ImageFrame::MULTICHANNEL_8 and channels <= 4);
+	}
+
+	if (format == "pnm") {
+		return type == ImageFrame::GRAY_8 or type == ImageFrame::GRAY_16 or (type == ImageFrame::MULTICHANNEL_8 and (channels == 1 or channels == 3));
+	}
+
+	if (format == "jpeg") {
+		return type == ImageFrame::GRAY_8 or (type == ImageFrame::MULTICHANNEL_8 and (channels == 1 or channels == 3));
+	}
+
+	return false;
+}
+
+FILE* FrameEncoders::openFile(QString const& path) {
+
+	FILE* file = std::fopen(QFile::encodeName(path).constData(), "wb");
+
+	if (file == nullptr) {
+		return nullptr;
+	}
+
+	_fileBuffer.resize(fileBufferBytes);
+	std::setvbuf(file, _fileBuffer.data(), _IOFBF, _fileBuffer.size());
+
+	return file;
+}
+
+bool FrameEncoders::collectRows(ImageFrame const& frame) {
+
+	bool ok = false;
+
+	frame.visit([this, &ok] (auto* img, auto) {
+		collectImageRows(img, _packed, _rows);
+		ok = true;
+	});
+
+	return ok;
+}
+
+bool FrameEncoders::writePng(Rows const& rows, Settings const& settings, QString const& path) {
+
+	FILE* file = openFile(path);
+
+	if (file == nullptr) {
+		return false;
+	}
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info = (png != nullptr) ? png_create_info_struct(png) : nullptr;
+
+	if (info == nullptr) {
+		png_destroy_write_struct(&png, nullptr);
+		std::fclose(file);
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, &info);
+		std::fclose(file);
+		QFile::remove(path);
+		return false;
+	}
+
+	const int bitDepth = (rows.type == ImageFrame::GRAY_16) ? 16 : 8;
+
+	png_init_io(png, file);
+	png_set_IHDR(png, info, rows.width, rows.height, bitDepth, pngColorType(rows.channels),
+				 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+
+	png_set_compression_level(png, settings.pngLevel);
+	png_set_compression_strategy(png, zlibStrategy(settings.pngStrategy));
+	png_set_filter(png, PNG_FILTER_TYPE_BASE, pngFilters(settings.pngFilter));
+
+	png_write_info(png, info);
+
+	if (bitDepth == 16 and QSysInfo::ByteOrder == QSysInfo::LittleEndian) {
+		png_set_swap(png); //libpng swaps its copy of the rows, the source is left untouched.
+	}
+
+	// libpng only keeps the previous row for the filters, the rows are compressed as they come.
+	for (int i = 0; i < rows.height; i++) {
+		png_write_row(png, rows.row(i));
+	}
+
+	png_write_end(png, nullptr);
+	png_destroy_write_struct(&png, &info);
+
+	return closeFile(file);
+}
+
+bool FrameEncoders::writeTiff(Rows const& rows, Settings const& settings, QString const& path) {
+
+	TIFF* tif = TIFFOpen(QFile::encodeName(path).constData(), "w");
+
+	if (tif == nullptr) {
+		return false;
+	}
+
+	const int channels = rows.channels;
+	const bool isFloat = rows.type == ImageFrame::GRAY_F32;
+	const bool lzw = settings.tiffCompression == "lzw";
+	const size_t rowBytes = rows.rowBytes();
+
+	TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(rows.width));
+	TIFFSetField(tif, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(rows.height));
+	TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, static_cast<uint16_t>(8*elementBytes(rows.type)));
+	TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, static_cast<uint16_t>(channels));
+	TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, (isFloat) ? SAMPLEFORMAT_IEEEFP : SAMPLEFORMAT_UINT);
+	TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, (channels >= 3) ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK);
+	TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	TIFFSetField(tif, TIFFTAG_COMPRESSION, (lzw) ? COMPRESSION_LZW : COMPRESSION_NONE);
+
+	if (lzw) {
+		TIFFSetField(tif, TIFFTAG_PREDICTOR, (isFloat) ? PREDICTOR_FLOATINGPOINT : PREDICTOR_HORIZONTAL);
+	}
+
+	int nExtraSamples = channels - ((channels >= 3) ? 3 : 1);
+
+	if (nExtraSamples > 0) {
+		std::vector<uint16_t> extraSamples(nExtraSamples, EXTRASAMPLE_UNSPECIFIED);
+		TIFFSetField(tif, TIFFTAG_EXTRASAMPLES, static_cast<uint16_t>(nExtraSamples), extraSamples.data());
+	}
+
+	TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tif, 0));
+
+	_line.resize(rowBytes);
+	bool ok = true;
+
+	for (int i = 0; ok and i < rows.height; i++) {
+		std::memcpy(_line.data(), rows.row(i), rowBytes); //the predictor works in place on the scanline.
+		ok = TIFFWriteScanline(tif, _line.data(), static_cast<uint32_t>(i), 0) >= 0;
+	}
+
+	TIFFClose(tif);
+
+	if (!ok) {
+		QFile::remove(path);
+	}
+
+	return ok;
+}
+
+bool FrameEncoders::writePnm(Rows const& rows, QString const& path) {
+
+	FILE* file = openFile(path);
+
+	if (file == nullptr) {
+		return false;
+	}
+
+	const bool wide = rows.type == ImageFrame::GRAY_16;
+	const size_t rowBytes = rows.rowBytes();
+
+	bool ok = std::fprintf(file, "P%d\n%d %d\n%d\n", (rows.channels == 3) ? 6 : 5, rows.width, rows.height, (wide) ? 65535 : 255) > 0;
+
+	// 16 bits samples are stored most significant byte first.
+	const bool swap = wide and QSysInfo::ByteOrder == QSysInfo::LittleEndian;
+
+	if (swap) {
+		_line.resize(rowBytes);
+	}
+
+	for (int i = 0; ok and i < rows.height; i++) {
+
+		uint8_t const* row = rows.row(i);
+
+		if (swap) {
+			uint16_t const* src = reinterpret_cast<uint16_t const*>(row);
+			uint16_t* dst = reinterpret_cast<uint16_t*>(_line.data());
+
+			for (int j = 0; j < rows.width; j++) {
+				dst[j] = qToBigEndian(src[j]);
+			}
+
+			row = _line.data();
+		}
+
+		ok = std::fwrite(row, 1, rowBytes, file) == rowBytes;
+	}
+
+	ok = closeFile(file) and ok;
+
+	if (!ok) {
+		QFile::remove(path);
+	}
+
+	return ok;
+}
+
+bool FrameEncoders::writeJpeg(Rows const& rows, Settings const& settings, QString const& path) {
+
+	if (_jpeg == nullptr) {
+		_jpeg.reset(new JpegState());
+	}
+
+	FILE* file = openFile(path);
+
+	if (file == nullptr) {
+		return false;
+	}
+
+	jpeg_compress_struct & cinfo = _jpeg->cinfo;
+
+	if (setjmp(_jpeg->error.jump)) {
+		jpeg_abort_compress(&cinfo); //the compressor can be reused for the next frame.
+		std::fclose(file);
+		QFile::remove(path);
+		return false;
+	}
+
+	jpeg_stdio_dest(&cinfo, file);
+
+	cinfo.image_width = rows.width;
+	cinfo.image_height = rows.height;
+	cinfo.input_components = rows.channels;
+	cinfo.in_color_space = (rows.channels == 3) ? JCS_RGB : JCS_GRAYSCALE;
+
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, settings.jpegQuality, TRUE);
+	cinfo.dct_method = JDCT_IFAST;
+
+	jpeg_start_compress(&cinfo, TRUE);
+
+	while (cinfo.next_scanline < cinfo.image_height) {
+		JSAMPROW row = const_cast<JSAMPROW>(rows.row(cinfo.next_scanline));
+		jpeg_write_scanlines(&cinfo, &row, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+
+	return closeFile(file);
+}
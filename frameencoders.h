@@ -0,0 +1,139 @@
+#ifndef FRAMEENCODERS_H
+#define FRAMEENCODERS_H
+
+#include <MultidimArrays/MultidimArrays.h>
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class ImageFrame;
+
+/*!
+ * \brief The FrameEncoders class write the exported frames with libpng, libtiff or libjpeg directly, with per stream settings.
+ *
+ * Each stream (left, right, rgb, depth) can be exported as png (with a selectable zlib level, row filter and strategy),
+ * tiff (lzw or uncompressed), pgm/ppm (no compression at all) or jpeg (8 bits frames only, for preview copies).
+ * Frames a format cannot hold (e.g. 16 bits frames as jpeg) are written as png instead.
+ * The rgb stream can also use the video format, its frames are then encoded in a single video per session by the
+ * VideoExporter, they are only written as png when exported one by one.
+ *
+ * The encoders consume the frames row by row, so raw frame files can be streamed from a mapping (see encodeRawFile).
+ * An instance keeps its buffers (and the jpeg compressor) between frames, it is meant to be owned by a single thread.
+ */
+class FrameEncoders
+{
+public:
+
+	struct Settings {
+
+		Settings() :
+			format("png"),
+			pngLevel(1),
+			pngFilter("sub"),
+			pngStrategy("default"),
+			tiffCompression("lzw"),
+			jpegQuality(90)
+		{
+
+		}
+
+		QString format; //!< png, tiff, pnm, jpeg or video (rgb stream only).
+		int pngLevel; //!< the zlib level, 0 (store) to 9 (smallest).
+		QString pngFilter; //!< none, sub, up, avg, paeth or all (let libpng pick for each row).
+		QString pngStrategy; //!< default, filtered, rle or huffman.
+		QString tiffCompression; //!< lzw or none.
+		int jpegQuality; //!< 1 to 100.
+	};
+
+	struct Config {
+
+		/*!
+		 * \brief fromSettings load the encoders of each stream from the export/<stream>/ settings (and write back the defaults).
+		 */
+		static Config fromSettings();
+
+		Settings settings(QString const& stream) const;
+
+		QMap<QString, Settings> streams; //!< streams without settings use the defaults.
+	};
+
+	/*!
+	 * \brief ColorConversion convert a frame recorded in a yuv color space to rgb.
+	 */
+	using ColorConversion = std::function<Multidim::Array<uint8_t, 3>(Multidim::Array<uint8_t, 3> const&)>;
+
+	/*!
+	 * \brief colorConversion give the conversion to rgb of a color space, empty if the frames do not need to be converted.
+	 */
+	static ColorConversion colorConversion(QString const& colorSpace);
+
+	/*!
+	 * \brief streams list the streams saved by the recorder, which can be configured separately.
+	 */
+	static QStringList streams();
+	static QStringList formats();
+
+	/*!
+	 * \brief streamOfFile give the stream of a recorded frame, from its <timestamp>_<stream> file name.
+	 */
+	static QString streamOfFile(QString const& framePath);
+
+	explicit FrameEncoders(Config const& config = Config());
+	~FrameEncoders();
+
+	void configure(Config const& config);
+	Config const& config() const;
+
+	/*!
+	 * \brief encode write a frame with the encoder of its stream.
+	 * \param basePath the path of the output file, without extension (the extension depends on the format).
+	 * \param outPath set to the path of the written file.
+	 * \return true on success.
+	 */
+	bool encode(ImageFrame const& frame, QString const& stream, QString const& basePath, QString & outPath);
+	/*!
+	 * \brief encodeRawFile write a raw frame file with the encoder of its stream, streaming the rows from a mapping of the file.
+	 *
+	 * The frame is never loaded as a whole: yuv frames are converted to rgb a few rows at a time, other frames are encoded
+	 * straight from the mapping, so the memory used does not depend on the frame size.
+	 *
+	 * \param colorSpace the color space of the frame, from its additional infos.
+	 * \return false if the frame could not be written, or cannot be streamed (e.g. rvl encoded depth frames),
+	 * it should then be loaded and written with encode.
+	 */
+	bool encodeRawFile(QString const& rawFramePath, QString const& stream, QString const& colorSpace, QString const& basePath, QString & outPath);
+
+protected:
+
+	struct JpegState;
+	struct Rows;
+
+	static bool supports(QString const& format, Rows const& rows);
+
+	FILE* openFile(QString const& path);
+	bool collectRows(ImageFrame const& frame);
+
+	bool writeRows(Rows const& rows, QString const& stream, QString const& basePath, QString & outPath);
+	bool writePng(Rows const& rows, Settings const& settings, QString const& path);
+	bool writeTiff(Rows const& rows, Settings const& settings, QString const& path);
+	bool writePnm(Rows const& rows, QString const& path);
+	bool writeJpeg(Rows const& rows, Settings const& settings, QString const& path);
+
+	Config _config;
+
+	std::vector<uint8_t> _packed; //!< the pixels of frames whose rows are not contiguous.
+	std::vector<uint8_t*> _rows;
+	std::vector<uint8_t> _line; //!< a scanline scratch buffer, for the encoders which modify or byte swap the rows.
+	std::vector<uint8_t> _convertedLine; //!< a converted row, when the conversion does not give contiguous rows.
+	std::vector<char> _fileBuffer;
+
+	std::unique_ptr<JpegState> _jpeg;
+};
+
+#endif // FRAMEENCODERS_H
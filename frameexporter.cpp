@@ -0,0 +1,317 @@
+#include "frameexporter.h"
+
+#include "imageframe.h"
+#include "threadtuning.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+
+#include <algorithm>
+
+const QString FrameExporter::journalFileName = "exported_frames.txt";
+
+namespace {
+
+const unsigned long yieldPollMs = 100;
+
+} // namespace
+
+FrameExporter::Config FrameExporter::Config::fromSettings() {
+
+	Config config;
+
+	QSettings settings;
+	config.incremental = settings.value("export/incremental", config.incremental).toBool();
+	config.maxFramesPerSecond = std::max(0., settings.value("export/maxfps", config.maxFramesPerSecond).toDouble());
+	config.encoders = FrameEncoders::Config::fromSettings();
+
+	settings.setValue("export/incremental", config.incremental);
+	settings.setValue("export/maxfps", config.maxFramesPerSecond);
+
+	return config;
+}
+
+bool FrameExporter::exportFrame(QString const& framePath, FrameEncoders & encoders, QString & outPath) {
+
+	QFile infosFile(framePath + ".infos");
+
+	// the recorded frame is removed with its infos, if they cannot be read the frame is kept so that they are not lost.
+	if (infosFile.exists() and !infosFile.open(QIODevice::ReadOnly)) {
+		QTextStream err(stderr);
+		err << "Could not read the infos of " << framePath << endl;
+		return false;
+	}
+
+	infosFile.close();
+
+	return exportFrame(framePath, ImageFrame::loadInfos(framePath), encoders, outPath);
+}
+
+bool FrameExporter::exportFrame(QString const& framePath, QMap<QString, QString> const& infos, FrameEncoders & encoders, QString & outPath) {
+
+	QFileInfo info(framePath);
+
+	if (!info.exists()) {
+		return false;
+	}
+
+	// the infos file of a frame written while recording may not be there yet, it is only removed if it exists now.
+	bool hasInfosFile = QFile::exists(framePath + ".infos");
+
+	bool ok = false;
+	QString basePath = info.dir().filePath(info.baseName());
+	QString stream = FrameEncoders::streamOfFile(framePath);
+
+	if (framePath.endsWith(ImageFrame::rawFrameExtension)) {
+		ok = exportRawFrame(framePath, infos, stream, basePath, encoders, outPath);
+	}
+
+	if (!ok) {
+		ok = exportLoadedFrame(framePath, infos, stream, basePath, encoders, outPath);
+	}
+
+	if (!ok) {
+		return false;
+	}
+
+	QFile::remove(framePath);
+
+	if (hasInfosFile) {
+		QFile::remove(framePath + ".infos");
+	}
+
+	return true;
+}
+
+bool FrameExporter::exportRawFrame(QString const& framePath, QMap<QString, QString> const& infos, QString const& stream, QString const& basePath, FrameEncoders & encoders, QString & outPath) {
+
+	QString colorSpace = infos.value(ImageFrame::colorSpaceKey);
+
+	if (!encoders.encodeRawFile(framePath, stream, colorSpace, basePath, outPath)) {
+		return false;
+	}
+
+	// like for loaded frames, the infos are kept unless the frame has been converted to rgb.
+	if (!colorConverted(colorSpace)) {
+		ImageFrame::saveInfos(outPath, infos);
+	}
+
+	return true;
+}
+
+bool FrameExporter::exportLoadedFrame(QString const& framePath, QMap<QString, QString> const& infos, QString const& stream, QString const& basePath, FrameEncoders & encoders, QString & outPath) {
+
+	ImageFrame frame(framePath);
+
+	if (!frame.isValid()) {
+		return false;
+	}
+
+	frame.additionalInfos() = infos;
+
+	bool ok = false;
+	FrameEncoders::ColorConversion convert = FrameEncoders::colorConversion(frame.additionalInfos().value(ImageFrame::colorSpaceKey));
+
+	if (convert and frame.multichannels8() != nullptr) {
+		Multidim::Array<uint8_t,3> rgb = convert(*frame.multichannels8());
+		ImageFrame converted(&rgb.atUnchecked(0,0,0), rgb.shape(), rgb.strides(), false);
+		ok = encoders.encode(converted, stream, basePath, outPath);
+	}
+
+	if (!ok) {
+		ok = encoders.encode(frame, stream, basePath, outPath);
+
+		if (ok) {
+			frame.saveInfos(outPath);
+		}
+	}
+
+	return ok;
+}
+
+bool FrameExporter::colorConverted(QString const& colorSpace) {
+	return static_cast<bool>(FrameEncoders::colorConversion(colorSpace));
+}
+
+FrameExporter::FrameExporter(QObject *parent) :
+	QThread(parent),
+	_busy(false),
+	_continue(true),
+	_exported(0),
+	_failed(0)
+{
+
+}
+
+FrameExporter::~FrameExporter() {
+	finish();
+	wait();
+}
+
+void FrameExporter::configure(Config const& config) {
+	QMutexLocker locker(&_queueMutex);
+	_config = config;
+}
+FrameExporter::Config const& FrameExporter::config() const {
+	return _config;
+}
+
+void FrameExporter::setYieldCondition(YieldCondition const& condition) {
+	QMutexLocker locker(&_queueMutex);
+	_yieldCondition = condition;
+}
+
+void FrameExporter::setFrameExportedCallback(FrameExportedCallback const& callback) {
+	QMutexLocker locker(&_queueMutex);
+	_frameExportedCallback = callback;
+}
+
+void FrameExporter::enqueue(QString const& framePath, QMap<QString, QString> const& infos) {
+	QMutexLocker locker(&_queueMutex);
+	_pending.enqueue({framePath, infos});
+	_workAvailable.wakeOne();
+}
+
+void FrameExporter::waitUntilIdle() {
+
+	QMutexLocker locker(&_queueMutex);
+
+	while (isRunning() and _continue and (_busy or !_pending.isEmpty())) {
+		_idle.wait(&_queueMutex);
+	}
+}
+
+FrameExporter::Progress FrameExporter::progress() const {
+	QMutexLocker locker(&_queueMutex);
+	return {_pending.size() + ((_busy) ? 1 : 0), _exported, _failed};
+}
+
+void FrameExporter::run() {
+
+	ThreadTuning::applyToCurrentThread(ThreadTuning::Exporter);
+
+	QElapsedTimer clock;
+	clock.start();
+	qint64 lastExportNs = -1;
+
+	while (true) {
+
+		_queueMutex.lock();
+		_busy = false;
+
+		while (_pending.isEmpty() and _continue) {
+			if (_journal.isOpen()) {
+				_journal.flush();
+			}
+			_idle.wakeAll();
+			_workAvailable.wait(&_queueMutex);
+		}
+
+		if (!_continue) { //the frames left are kept as recorded, they can still be exported later.
+			_idle.wakeAll();
+			_queueMutex.unlock();
+			break;
+		}
+
+		PendingFrame frame = _pending.dequeue();
+		QString const& framePath = frame.framePath;
+		_busy = true;
+
+		Config config = _config;
+		YieldCondition yieldCondition = _yieldCondition;
+		FrameExportedCallback frameExportedCallback = _frameExportedCallback;
+		_queueMutex.unlock();
+
+		if (config.encoders.settings(FrameEncoders::streamOfFile(framePath)).format == "video") {
+			continue; //encoded with the rest of its session by the export job, once the recording is over.
+		}
+
+		while (yieldCondition and yieldCondition()) {
+
+			QMutexLocker locker(&_queueMutex);
+
+			if (!_continue) {
+				break;
+			}
+
+			_workAvailable.wait(&_queueMutex, yieldPollMs);
+		}
+
+		if (config.maxFramesPerSecond > 0 and lastExportNs >= 0) {
+			qint64 periodNs = static_cast<qint64>(1e9/config.maxFramesPerSecond);
+			qint64 waitNs = lastExportNs + periodNs - clock.nsecsElapsed();
+
+			if (waitNs > 0) {
+				usleep(static_cast<unsigned long>(waitNs/1000));
+			}
+		}
+
+		lastExportNs = clock.nsecsElapsed();
+
+		_encoders.configure(config.encoders);
+
+		QString outPath;
+		bool ok = exportFrame(framePath, frame.infos, _encoders, outPath);
+
+		if (ok) {
+			appendToJournal(framePath, outPath);
+
+			if (frameExportedCallback) {
+				frameExportedCallback(framePath);
+			}
+		} else {
+			QTextStream err(stderr);
+			err << "Could not export " << framePath << endl;
+		}
+
+		QMutexLocker locker(&_queueMutex);
+
+		if (ok) {
+			_exported++;
+		} else {
+			_failed++;
+		}
+	}
+
+	closeJournal();
+}
+
+void FrameExporter::finish() {
+	QMutexLocker locker(&_queueMutex);
+	_continue = false;
+	_workAvailable.wakeAll();
+}
+
+void FrameExporter::appendToJournal(QString const& framePath, QString const& outPath) {
+
+	QFileInfo frameInfo(framePath);
+	QString journalPath = frameInfo.dir().filePath(journalFileName);
+
+	if (_journal.fileName() != journalPath) {
+
+		closeJournal();
+		_journal.setFileName(journalPath);
+
+		if (!_journal.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+			QTextStream err(stderr);
+			err << "Could not open the export journal " << journalPath << endl;
+			return;
+		}
+	}
+
+	if (!_journal.isOpen()) {
+		return;
+	}
+
+	QTextStream(&_journal) << frameInfo.fileName() << '\t' << QFileInfo(outPath).fileName() << '\n';
+}
+
+void FrameExporter::closeJournal() {
+
+	if (_journal.isOpen()) {
+		_journal.close();
+	}
+}
@@ -0,0 +1,138 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include "frameencoders.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QFile>
+
+#include <functional>
+
+/*!
+ * \brief The FrameExporter class convert the recorded frames to images from a background thread, while the recording goes on.
+ *
+ * The recorder notifies each frame as soon as it is written, so the folder is never rescanned. The thread runs with the
+ * exporter scheduling settings (idle by default), can be limited to a maximal rate, and pauses while the yield condition
+ * holds (e.g. when the recording is not sustainable), so that the capture keeps its headroom.
+ * The exported frames are appended to an exported_frames.txt journal in their folder.
+ */
+class FrameExporter : public QThread
+{
+	Q_OBJECT
+public:
+
+	struct Config {
+
+		Config() :
+			incremental(false),
+			maxFramesPerSecond(0)
+		{
+
+		}
+
+		/*!
+		 * \brief fromSettings load the configuration from the application settings (and write back the defaults).
+		 */
+		static Config fromSettings();
+
+		bool incremental;
+		double maxFramesPerSecond; //!< 0 means no limit.
+		FrameEncoders::Config encoders;
+	};
+
+	struct Progress {
+		qint64 pending;
+		qint64 exported;
+		qint64 failed;
+	};
+
+	/*!
+	 * \brief YieldCondition is polled before each export, the exporter waits while it returns true.
+	 */
+	using YieldCondition = std::function<bool()>;
+	/*!
+	 * \brief FrameExportedCallback is called from the export thread with the path of each recorded frame exported (and removed).
+	 */
+	using FrameExportedCallback = std::function<void(QString const& framePath)>;
+
+	static const QString journalFileName;
+
+	/*!
+	 * \brief exportFrame convert a recorded frame to an image next to it, then remove the recorded frame.
+	 *
+	 * Plain raw frames are streamed from a mapping of their file, other frames are loaded before being encoded.
+	 * The infos of the frame are loaded from its infos file or infos table.
+	 * \param encoders the encoders to use, chosen by the stream of the frame.
+	 * \param outPath set to the path of the exported image.
+	 * \return true on success, false if the frame or its infos could not be read, or if the image could not be written
+	 * (the recorded frame is then kept).
+	 */
+	static bool exportFrame(QString const& framePath, FrameEncoders & encoders, QString & outPath);
+	/*!
+	 * \brief exportFrame convert a recorded frame to an image, using the given infos instead of the ones stored on disk.
+	 */
+	static bool exportFrame(QString const& framePath, QMap<QString, QString> const& infos, FrameEncoders & encoders, QString & outPath);
+
+	explicit FrameExporter(QObject *parent = nullptr);
+	~FrameExporter();
+
+	void configure(Config const& config);
+	Config const& config() const;
+
+	void setYieldCondition(YieldCondition const& condition);
+	void setFrameExportedCallback(FrameExportedCallback const& callback);
+
+	/*!
+	 * \brief enqueue schedule a written frame for export, can be called from any thread.
+	 * \param infos the infos of the frame, which may not be on disk yet.
+	 */
+	void enqueue(QString const& framePath, QMap<QString, QString> const& infos);
+
+	/*!
+	 * \brief waitUntilIdle block until all the scheduled frames have been exported.
+	 */
+	void waitUntilIdle();
+
+	Progress progress() const;
+
+	virtual void run();
+	void finish();
+
+protected:
+
+	struct PendingFrame {
+		QString framePath;
+		QMap<QString, QString> infos;
+	};
+
+	static bool exportRawFrame(QString const& framePath, QMap<QString, QString> const& infos, QString const& stream, QString const& basePath, FrameEncoders & encoders, QString & outPath);
+	static bool exportLoadedFrame(QString const& framePath, QMap<QString, QString> const& infos, QString const& stream, QString const& basePath, FrameEncoders & encoders, QString & outPath);
+	static bool colorConverted(QString const& colorSpace);
+
+	void appendToJournal(QString const& framePath, QString const& outPath);
+	void closeJournal();
+
+	Config _config;
+	YieldCondition _yieldCondition;
+	FrameExportedCallback _frameExportedCallback;
+
+	FrameEncoders _encoders; //!< only used from the export thread.
+
+	mutable QMutex _queueMutex;
+	QWaitCondition _workAvailable;
+	QWaitCondition _idle;
+
+	QQueue<PendingFrame> _pending;
+	bool _busy;
+	bool _continue;
+
+	qint64 _exported;
+	qint64 _failed;
+
+	QFile _journal;
+};
+
+#endif // FRAMEEXPORTER_H
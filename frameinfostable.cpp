@@ -0,0 +1,272 @@
+#include "frameinfostable.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QStringList>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+const QString FrameInfosTable::tableExtension = ".infostable";
+
+static const qint64 tablesListRefreshMs = 2000;
+static const int maxIndexedFolders = 4;
+
+namespace {
+
+struct TableIndex {
+
+	TableIndex() :
+		readBytes(0)
+	{
+
+	}
+
+	qint64 readBytes; //!< the size of the lines already indexed, the table is only appended to.
+	QStringList frames;
+};
+
+struct FolderIndex {
+
+	FolderIndex() :
+		lastUse(0)
+	{
+
+	}
+
+	QHash<QString, TableIndex> tables;
+	QHash<QString, QMap<QString, QString>> infos;
+	QElapsedTimer lastListing;
+	quint64 lastUse; //!< the lookup count at the last lookup in the folder.
+};
+
+QMutex foldersIndexesMutex;
+QHash<QString, FolderIndex> foldersIndexes;
+quint64 nLookups = 0;
+
+/*!
+ * \brief evictLeastRecentFolder forget the index of the folder whose tables have been looked up the longest ago.
+ */
+void evictLeastRecentFolder() {
+
+	auto oldest = foldersIndexes.begin();
+
+	for (auto it = foldersIndexes.begin(); it != foldersIndexes.end(); ++it) {
+		if (it->lastUse < oldest->lastUse) {
+			oldest = it;
+		}
+	}
+
+	if (oldest != foldersIndexes.end()) {
+		foldersIndexes.erase(oldest);
+	}
+}
+
+QMap<QString, qint64> listTables(QDir const& dir) {
+
+	QMap<QString, qint64> ret;
+	QFileInfoList tables = dir.entryInfoList({"*" + FrameInfosTable::tableExtension}, QDir::Files);
+
+	for (QFileInfo const& table : tables) {
+		ret.insert(table.absoluteFilePath(), table.size());
+	}
+
+	return ret;
+}
+
+void unloadTable(FolderIndex & index, QString const& tablePath) {
+
+	for (QString const& frame : index.tables.value(tablePath).frames) {
+		index.infos.remove(frame);
+	}
+
+	index.tables.remove(tablePath);
+}
+
+/*!
+ * \brief loadNewLines index the lines appended to a table since it was last read.
+ *
+ * Only complete lines are read, a line being written is indexed with the next lines.
+ */
+void loadNewLines(FolderIndex & index, QString const& tablePath) {
+
+	TableIndex & table = index.tables[tablePath];
+	QFile file(tablePath);
+
+	if (!file.open(QIODevice::ReadOnly) or !file.seek(table.readBytes)) {
+		return;
+	}
+
+	QByteArray line = file.readLine();
+
+	while (line.endsWith('\n')) {
+
+		QString frameFileName;
+		QMap<QString, QString> infos;
+
+		if (FrameInfosTable::decodeLine(line, frameFileName, infos)) {
+			index.infos.insert(frameFileName, infos);
+			table.frames.push_back(frameFileName);
+		}
+
+		table.readBytes += line.size();
+		line = file.readLine();
+	}
+}
+
+/*!
+ * \brief updateIndex index the tables created or grown since the last update, and forget the removed ones.
+ */
+void updateIndex(FolderIndex & index, QDir const& dir) {
+
+	QMap<QString, qint64> tables = listTables(dir);
+
+	for (QString const& tablePath : index.tables.keys()) {
+		if (!tables.contains(tablePath) or tables.value(tablePath) < index.tables.value(tablePath).readBytes) {
+			unloadTable(index, tablePath); //removed, or rewritten.
+		}
+	}
+
+	for (auto it = tables.constBegin(); it != tables.constEnd(); ++it) {
+
+		auto table = index.tables.constFind(it.key());
+
+		if (table == index.tables.constEnd() or table->readBytes < it.value()) {
+			loadNewLines(index, it.key());
+		}
+	}
+}
+
+} // namespace
+
+FrameInfosTable::FrameInfosTable(QString const& tablePath, int batchSize) :
+	_file(tablePath),
+	_nPending(0),
+	_batchSize(std::max(1, batchSize))
+{
+
+}
+
+FrameInfosTable::~FrameInfosTable() {
+	flush();
+}
+
+QString FrameInfosTable::tablePath() const {
+	return _file.fileName();
+}
+
+void FrameInfosTable::append(QString const& frameFilePath, QMap<QString, QString> const& infos) {
+
+	QMutexLocker locker(&_mutex);
+
+	_pending += encodeLine(QFileInfo(frameFilePath).fileName(), infos);
+	_nPending++;
+
+	if (_nPending >= _batchSize) {
+		locker.unlock();
+		flush();
+	}
+}
+
+bool FrameInfosTable::flush() {
+
+	QMutexLocker locker(&_mutex);
+
+	if (_pending.isEmpty()) {
+		return true;
+	}
+
+	if (!_file.isOpen()) {
+		if (!_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+			return false;
+		}
+	}
+
+	bool ok = _file.write(_pending) == _pending.size();
+	ok = ok and _file.flush();
+
+	_pending.clear();
+	_nPending = 0;
+
+	return ok;
+}
+
+QMap<QString, QString> FrameInfosTable::lookup(QString const& frameFilePath) {
+
+	QFileInfo frameInfo(frameFilePath);
+	QString folder = frameInfo.absolutePath();
+
+	QMutexLocker locker(&foldersIndexesMutex);
+
+	auto indexIt = foldersIndexes.find(folder);
+
+	// the index of a folder holds the infos of all its frames, only the folders in use are kept.
+	if (indexIt == foldersIndexes.end()) {
+
+		if (foldersIndexes.size() >= maxIndexedFolders) {
+			evictLeastRecentFolder();
+		}
+
+		indexIt = foldersIndexes.insert(folder, FolderIndex());
+	}
+
+	FolderIndex & index = *indexIt;
+	index.lastUse = ++nLookups;
+
+	if (!index.lastListing.isValid() or index.lastListing.hasExpired(tablesListRefreshMs)) {
+
+		updateIndex(index, QDir(folder));
+		index.lastListing.start();
+	}
+
+	return index.infos.value(frameInfo.fileName());
+}
+
+void FrameInfosTable::releaseIndex(QString const& folder) {
+
+	QMutexLocker locker(&foldersIndexesMutex);
+	foldersIndexes.remove(QDir(folder).absolutePath());
+}
+
+QByteArray FrameInfosTable::encodeLine(QString const& frameFileName, QMap<QString, QString> const& infos) {
+
+	QByteArray line = frameFileName.toUtf8().toPercentEncoding();
+
+	for (auto it = infos.constBegin(); it != infos.constEnd(); ++it) {
+		line += '\t';
+		line += it.key().toUtf8().toPercentEncoding();
+		line += '=';
+		line += it.value().toUtf8().toPercentEncoding();
+	}
+
+	line += '\n';
+
+	return line;
+}
+
+bool FrameInfosTable::decodeLine(QByteArray const& line, QString & frameFileName, QMap<QString, QString> & infos) {
+
+	QList<QByteArray> fields = line.trimmed().split('\t');
+
+	if (fields.isEmpty() or fields[0].isEmpty()) {
+		return false;
+	}
+
+	frameFileName = QString::fromUtf8(QByteArray::fromPercentEncoding(fields[0]));
+
+	for (int i = 1; i < fields.size(); i++) {
+
+		int sep = fields[i].indexOf('=');
+
+		if (sep < 0) {
+			return false;
+		}
+
+		infos.insert(QString::fromUtf8(QByteArray::fromPercentEncoding(fields[i].left(sep))),
+					 QString::fromUtf8(QByteArray::fromPercentEncoding(fields[i].mid(sep+1))));
+	}
+
+	return true;
+}
@@ -0,0 +1,67 @@
+#ifndef FRAMEINFOSTABLE_H
+#define FRAMEINFOSTABLE_H
+
+#include <QString>
+#include <QMap>
+#include <QFile>
+#include <QMutex>
+
+/*!
+ * \brief The FrameInfosTable class store the additional infos of many frames in a single file.
+ *
+ * The table is a text file, with one line per frame:
+ * the frame file name, followed by tab separated key=value pairs (keys and values are percent encoded).
+ * Lines are accumulated in memory and appended to the file in batches.
+ */
+class FrameInfosTable
+{
+public:
+
+	static const QString tableExtension;
+
+	FrameInfosTable(QString const& tablePath, int batchSize = 64);
+	~FrameInfosTable();
+
+	QString tablePath() const;
+
+	/*!
+	 * \brief append register the infos of a frame, they are written to disk with the next batch.
+	 * \param frameFilePath the path of the frame file (only the file name is stored).
+	 * \param infos the infos of the frame.
+	 */
+	void append(QString const& frameFilePath, QMap<QString, QString> const& infos);
+
+	/*!
+	 * \brief flush write the pending lines to disk.
+	 * \return false if the table could not be written.
+	 */
+	bool flush();
+
+	/*!
+	 * \brief lookup find the infos of a frame in the tables stored in the same folder.
+	 * \param frameFilePath the path of the frame file.
+	 * \return the infos of the frame, or an empty map if the frame is in no table.
+	 *
+	 * The tables of a folder are indexed on the first lookup, then only the lines appended since are read when the tables grow.
+	 * The indexes of the few folders looked up most recently are kept.
+	 */
+	static QMap<QString, QString> lookup(QString const& frameFilePath);
+	/*!
+	 * \brief releaseIndex forget the index of the tables of a folder, e.g. once its frames have been exported.
+	 */
+	static void releaseIndex(QString const& folder);
+
+	static QByteArray encodeLine(QString const& frameFileName, QMap<QString, QString> const& infos);
+	static bool decodeLine(QByteArray const& line, QString & frameFileName, QMap<QString, QString> & infos);
+
+protected:
+
+	QMutex _mutex;
+
+	QFile _file;
+	QByteArray _pending;
+	int _nPending;
+	int _batchSize;
+};
+
+#endif // FRAMEINFOSTABLE_H
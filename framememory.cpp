@@ -0,0 +1,194 @@
+#include "framememory.h"
+
+#include <QDir>
+#include <QSettings>
+#include <QTextStream>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+const int FrameMemory::CurrentNode = -1;
+const int FrameMemory::AnyNode = -2;
+
+const size_t FrameMemory::minPagedBytes = 256*1024;
+const size_t FrameMemory::hugePageBytes = 2*1024*1024;
+
+std::atomic<int> FrameMemory::_pagePolicy(FrameMemory::DefaultPages);
+std::atomic<bool> FrameMemory::_numa(false);
+
+namespace {
+
+const size_t pageAlignment = 4096;
+const int mpolPreferred = 1; //MPOL_PREFERRED, from numaif.h (libnuma is not required for the mbind syscall).
+const int maxNodes = 1024;
+
+std::atomic<bool> hugeTlbFailureReported(false);
+
+size_t roundUp(size_t size, size_t alignment) {
+	return ((size + alignment - 1)/alignment)*alignment;
+}
+
+void* mapPages(size_t bytes, bool hugeTlb) {
+
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+	if (hugeTlb) {
+		flags |= MAP_HUGETLB | MAP_HUGE_2MB;
+	}
+
+	void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+	return (data == MAP_FAILED) ? nullptr : data;
+}
+
+bool preferNode(void* data, size_t bytes, int node) {
+
+	if (node < 0 or node >= maxNodes) {
+		return false;
+	}
+
+	const int bitsPerWord = 8*sizeof (unsigned long);
+	unsigned long nodeMask[maxNodes/bitsPerWord] = {};
+	nodeMask[node/bitsPerWord] |= 1UL << (node%bitsPerWord);
+
+	// the policy is set before the first touch, so the pages get allocated on the node when the frame is written.
+	return syscall(SYS_mbind, data, bytes, mpolPreferred, nodeMask, maxNodes, 0) == 0;
+}
+
+} // namespace
+
+void FrameMemory::configureFromSettings() {
+
+	QSettings settings;
+	QString pages = settings.value("memory/hugepages", "none").toString().toLower();
+	bool numa = settings.value("memory/numa", false).toBool();
+
+	PagePolicy policy = DefaultPages;
+
+	if (pages == "thp") {
+		policy = TransparentHugePages;
+	} else if (pages == "hugetlb") {
+		policy = HugeTlbPages;
+	} else if (pages != "none") {
+		QTextStream err(stderr);
+		err << "Unknown memory/hugepages value " << pages << " (expected none, thp or hugetlb), using none" << endl;
+	}
+
+	settings.setValue("memory/hugepages", pagePolicyName(policy));
+	settings.setValue("memory/numa", numa);
+
+	configure(policy, numa);
+}
+
+void FrameMemory::configure(PagePolicy pages, bool numa) {
+	_pagePolicy.store(pages);
+	_numa.store(numa);
+}
+
+FrameMemory::PagePolicy FrameMemory::pagePolicy() {
+	return static_cast<PagePolicy>(_pagePolicy.load());
+}
+bool FrameMemory::numaEnabled() {
+	return _numa.load();
+}
+
+std::shared_ptr<uint8_t> FrameMemory::allocate(size_t bytes, int node) {
+
+	if (bytes == 0) {
+		return nullptr;
+	}
+
+	PagePolicy policy = pagePolicy();
+	bool numa = numaEnabled();
+
+	if (bytes < minPagedBytes or (policy == DefaultPages and !numa)) {
+
+		void* data = nullptr;
+
+		if (posix_memalign(&data, pageAlignment, bytes) != 0) {
+			return nullptr;
+		}
+
+		return std::shared_ptr<uint8_t>(static_cast<uint8_t*>(data), [] (uint8_t* ptr) { free(ptr); });
+	}
+
+	size_t mappedBytes = roundUp(bytes, (policy == DefaultPages) ? pageAlignment : hugePageBytes);
+	void* data = nullptr;
+
+	if (policy == HugeTlbPages) {
+		data = mapPages(mappedBytes, true);
+
+		if (data == nullptr and !hugeTlbFailureReported.exchange(true)) {
+			QTextStream err(stderr);
+			err << "Could not map hugetlb pages (are hugepages reserved in /proc/sys/vm/nr_hugepages ?), using transparent hugepages" << endl;
+		}
+	}
+
+	if (data == nullptr) {
+
+		data = mapPages(mappedBytes, false);
+
+		if (data == nullptr) {
+			return nullptr;
+		}
+
+		if (policy != DefaultPages) {
+			madvise(data, mappedBytes, MADV_HUGEPAGE);
+		}
+	}
+
+	if (numa and node != AnyNode) {
+		preferNode(data, mappedBytes, (node == CurrentNode) ? currentNode() : node);
+	}
+
+	return std::shared_ptr<uint8_t>(static_cast<uint8_t*>(data), [mappedBytes] (uint8_t* ptr) { munmap(ptr, mappedBytes); });
+}
+
+int FrameMemory::currentNode() {
+
+	unsigned int cpu;
+	unsigned int node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+		return -1;
+	}
+
+	return static_cast<int>(node);
+}
+
+int FrameMemory::nodeOfCpu(int cpu) {
+
+	QDir cpuDir(QString("/sys/devices/system/cpu/cpu%1").arg(cpu));
+	QStringList nodes = cpuDir.entryList({"node*"}, QDir::Dirs | QDir::NoDotAndDotDot);
+
+	for (QString const& node : nodes) {
+		bool ok;
+		int id = node.mid(4).toInt(&ok);
+		if (ok) {
+			return id;
+		}
+	}
+
+	return -1;
+}
+
+QString FrameMemory::pagePolicyName(PagePolicy policy) {
+	switch (policy) {
+	case TransparentHugePages:
+		return "thp";
+	case HugeTlbPages:
+		return "hugetlb";
+	default:
+		return "none";
+	}
+}
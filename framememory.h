@@ -0,0 +1,69 @@
+#ifndef FRAMEMEMORY_H
+#define FRAMEMEMORY_H
+
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * \brief The FrameMemory class allocate the large buffers holding frame pixels.
+ *
+ * By default buffers come from the regular heap. The memory/hugepages setting can request
+ * explicit 2 MB hugepages ("hugetlb", falling back to "thp" if none are reserved) or transparent hugepages ("thp"),
+ * and memory/numa prefers the NUMA node the allocating thread runs on (or the node given to allocate).
+ * Buffers smaller than minPagedBytes always come from the heap.
+ */
+class FrameMemory
+{
+public:
+
+	enum PagePolicy {
+		DefaultPages,
+		TransparentHugePages,
+		HugeTlbPages
+	};
+
+	static const int CurrentNode;
+	static const int AnyNode;
+
+	static const size_t minPagedBytes;
+	static const size_t hugePageBytes;
+
+	/*!
+	 * \brief configureFromSettings read memory/hugepages and memory/numa (and write back the defaults).
+	 */
+	static void configureFromSettings();
+	static void configure(PagePolicy pages, bool numa);
+
+	static PagePolicy pagePolicy();
+	static bool numaEnabled();
+
+	/*!
+	 * \brief allocate a buffer of at least bytes bytes, aligned on 4096 bytes.
+	 * \param node the preferred NUMA node, CurrentNode for the node of the calling thread, or AnyNode.
+	 * \return the buffer, released when the last copy of the pointer is destroyed, or nullptr on failure.
+	 */
+	static std::shared_ptr<uint8_t> allocate(size_t bytes, int node = CurrentNode);
+
+	/*!
+	 * \brief currentNode give the NUMA node of the cpu the calling thread runs on, or -1 if unknown.
+	 */
+	static int currentNode();
+	/*!
+	 * \brief nodeOfCpu give the NUMA node of a cpu, or -1 if unknown.
+	 */
+	static int nodeOfCpu(int cpu);
+
+	static QString pagePolicyName(PagePolicy policy);
+
+protected:
+
+	static std::atomic<int> _pagePolicy;
+	static std::atomic<bool> _numa;
+};
+
+#endif // FRAMEMEMORY_H
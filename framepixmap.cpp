@@ -0,0 +1,49 @@
+#include "framepixmap.h"
+
+#include <QImage>
+
+#include <stdexcept>
+
+QPixmap imageFrameToQPixmap(const ImageFrame &f)
+{
+
+	int w = f.width();
+	int h = f.height();
+
+	if (f.imgType() == ImageFrame::GRAY_8) {
+		QImage ret((uchar*) &f.grayscale8()->atUnchecked(0,0), w, h, w, QImage::Format_Grayscale8);
+		return QPixmap::fromImage(ret);
+	}
+
+	if (f.imgType() == ImageFrame::GRAY_16) {
+		Multidim::Array<uint16_t, 2>* original = f.grayscale16();
+		Multidim::Array<uint8_t, 2> grayMap(original->shape(), original->strides());
+
+		qint64 mean = 0;
+		for (int i = 0; i < original->shape()[0]; i++) {
+			for (int j = 0; j < original->shape()[1]; j++) {
+				grayMap.atUnchecked(i,j) = static_cast<uint8_t>(original->valueUnchecked(i,j)/256);
+				mean += grayMap.atUnchecked(i,j);
+			}
+		}
+
+		QImage ret((uchar*) &grayMap.atUnchecked(0,0), w, h, w, QImage::Format_Grayscale8);
+		QPixmap px = QPixmap::fromImage(ret.copy());
+		return px.scaled(w/2,h/2);
+	}
+
+	if (f.imgType() == ImageFrame::MULTICHANNEL_8) {
+
+		if (f.multichannels8()->shape()[2] == 3) { //RGB
+			QImage ret((uchar*) &f.multichannels8()->atUnchecked(0,0,0), w, h, w*3, QImage::Format_RGB888);
+			return QPixmap::fromImage(ret);
+		}
+
+		if (f.multichannels8()->shape()[2] == 4) { //RGBA
+			QImage ret((uchar*) &f.multichannels8()->atUnchecked(0,0,0), w, h, w*4, QImage::Format_RGBA8888);
+			return QPixmap::fromImage(ret);
+		}
+	}
+
+	throw std::runtime_error("Unsupported frame format !");
+}
@@ -0,0 +1,15 @@
+#ifndef FRAMEPIXMAP_H
+#define FRAMEPIXMAP_H
+
+#include <QPixmap>
+
+#include "./imageframe.h"
+
+/*!
+ * \brief imageFrameToQPixmap convert a frame to a pixmap that can be displayed in the gui.
+ *
+ * 16 bits frames are reduced to 8 bits and downscaled by a factor two.
+ */
+QPixmap imageFrameToQPixmap(const ImageFrame &f);
+
+#endif // FRAMEPIXMAP_H
@@ -0,0 +1,110 @@
+#include "framequeue.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <climits>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) and std::atomic<uint32_t>::is_always_lock_free,
+			  "futexes require lock free 32 bits atomics");
+
+namespace {
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield" ::: "memory");
+#endif
+}
+
+int futexWait(std::atomic<uint32_t>* addr, uint32_t expected, timespec const* timeout) {
+	return syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+}
+
+int futexWakeAll(std::atomic<uint32_t>* addr) {
+	return syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+QueueWaiter::QueueWaiter(Strategy strategy) :
+	_strategy(strategy),
+	_epoch(0),
+	_nBlocked(0)
+{
+
+}
+
+bool QueueWaiter::wait(uint32_t observedEpoch, Deadline const& deadline, bool withDeadline) const {
+
+	if (_strategy == Block) {
+
+		while (_epoch.load(std::memory_order_seq_cst) == observedEpoch) {
+
+			timespec timeout;
+			timespec* timeoutPtr = nullptr;
+
+			if (withDeadline) {
+				std::chrono::nanoseconds remaining = deadline - std::chrono::steady_clock::now();
+
+				if (remaining.count() <= 0) {
+					return false;
+				}
+
+				timeout.tv_sec = remaining.count()/1000000000;
+				timeout.tv_nsec = remaining.count()%1000000000;
+				timeoutPtr = &timeout;
+			}
+
+			// the epoch is checked again by the kernel after _nBlocked is increased, so a notify cannot be missed.
+			_nBlocked.fetch_add(1, std::memory_order_seq_cst);
+			futexWait(&_epoch, observedEpoch, timeoutPtr);
+			_nBlocked.fetch_sub(1, std::memory_order_seq_cst);
+		}
+
+		return true;
+	}
+
+	int nPolls = 0;
+
+	while (_epoch.load(std::memory_order_acquire) == observedEpoch) {
+
+		if (withDeadline and (++nPolls & 0xFF) == 0 and std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+
+		if (_strategy == Yield) {
+			std::this_thread::yield();
+		} else {
+			cpuRelax();
+		}
+	}
+
+	return true;
+}
+
+void QueueWaiter::notify() {
+
+	_epoch.fetch_add(1, std::memory_order_seq_cst);
+
+	if (_strategy == Block and _nBlocked.load(std::memory_order_seq_cst) > 0) {
+		futexWakeAll(&_epoch);
+	}
+}
+
+QueueWaiter::Deadline QueueWaiter::deadlineFromTimeout(int timeoutMs) {
+
+	if (timeoutMs < 0) {
+		return Deadline::max();
+	}
+
+	return std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+}
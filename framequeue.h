@@ -0,0 +1,410 @@
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * \brief The QueueWaiter class let a thread wait for a change signaled by another thread.
+ *
+ * Waiting threads observe an epoch counter, which is increased by notify.
+ * With the Spin and Yield strategies the waiting thread polls the epoch (busy or yielding its time slice),
+ * with Block it sleeps on a futex. notify is a single atomic increment when no thread is blocked.
+ * Spin is only worth it when the two threads run on dedicated cores.
+ */
+class QueueWaiter
+{
+public:
+
+	enum Strategy {
+		Spin,
+		Yield,
+		Block
+	};
+
+	using Deadline = std::chrono::steady_clock::time_point;
+
+	explicit QueueWaiter(Strategy strategy = Block);
+
+	inline Strategy strategy() const { return _strategy; }
+
+	inline uint32_t epoch() const { return _epoch.load(std::memory_order_seq_cst); }
+
+	/*!
+	 * \brief wait until the epoch differs from observedEpoch.
+	 * \param deadline the time at which the wait is abandonned.
+	 * \param withDeadline if false, wait without time limit.
+	 * \return false if the deadline has been reached.
+	 */
+	bool wait(uint32_t observedEpoch, Deadline const& deadline, bool withDeadline) const;
+	void notify();
+
+	static Deadline deadlineFromTimeout(int timeoutMs);
+
+protected:
+
+	Strategy _strategy;
+
+	mutable std::atomic<uint32_t> _epoch;
+	mutable std::atomic<int> _nBlocked;
+};
+
+/*!
+ * \brief The SpscQueue class is a bounded lock-free queue with a single producer and a single consumer.
+ *
+ * The producer and consumer indices live on different cache lines, and each side caches the index of the other side,
+ * so that the shared cache lines are only read when the queue looks full (producer) or empty (consumer).
+ * Items are moved in and out of the queue, popped slots are reset so that frame handles are released immediately.
+ */
+template<typename T>
+class SpscQueue
+{
+public:
+
+	explicit SpscQueue(size_t capacity, QueueWaiter::Strategy strategy = QueueWaiter::Block) :
+		_items(roundCapacity(capacity)),
+		_mask(_items.size()-1),
+		_closed(false),
+		_head(0),
+		_cachedTail(0),
+		_tail(0),
+		_cachedHead(0),
+		_notEmpty(strategy),
+		_notFull(strategy)
+	{
+
+	}
+
+	SpscQueue(SpscQueue const&) = delete;
+	SpscQueue& operator=(SpscQueue const&) = delete;
+
+	inline size_t capacity() const { return _items.size(); }
+	/*!
+	 * \brief sizeApprox give the number of items in the queue, from any thread, in [0, capacity()].
+	 */
+	inline size_t sizeApprox() const {
+		// the head is loaded first, so the tail read after it cannot be behind it.
+		size_t head = _head.load(std::memory_order_acquire);
+		size_t tail = _tail.load(std::memory_order_acquire);
+		return (tail > head) ? std::min<size_t>(tail - head, _items.size()) : 0;
+	}
+
+	/*!
+	 * \brief isFull indicate if the next push will fail, to be called by the producer only.
+	 */
+	inline bool isFull() {
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _cachedHead < _items.size()) {
+			return false;
+		}
+		_cachedHead = _head.load(std::memory_order_acquire);
+		return tail - _cachedHead >= _items.size();
+	}
+
+	/*!
+	 * \brief tryPush push an item, without waiting. item is only moved from if the push succeed.
+	 */
+	template<typename U>
+	bool tryPush(U&& item) {
+
+		if (isFull()) {
+			return false;
+		}
+
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		_items[tail & _mask] = std::forward<U>(item);
+		_tail.store(tail+1, std::memory_order_release);
+
+		_notEmpty.notify();
+		return true;
+	}
+
+	bool tryPop(T & item) {
+
+		size_t head = _head.load(std::memory_order_relaxed);
+
+		if (head == _cachedTail) {
+			_cachedTail = _tail.load(std::memory_order_acquire);
+			if (head == _cachedTail) {
+				return false;
+			}
+		}
+
+		item = std::move(_items[head & _mask]);
+		_items[head & _mask] = T();
+		_head.store(head+1, std::memory_order_release);
+
+		_notFull.notify();
+		return true;
+	}
+
+	/*!
+	 * \brief push an item, waiting for a free slot.
+	 * \param timeoutMs the maximal wait, or a negative value to wait without limit.
+	 * \return false on timeout or if the queue has been closed.
+	 */
+	template<typename U>
+	bool push(U&& item, int timeoutMs = -1) {
+
+		QueueWaiter::Deadline deadline = QueueWaiter::deadlineFromTimeout(timeoutMs);
+
+		while (!_closed.load(std::memory_order_acquire)) {
+
+			uint32_t epoch = _notFull.epoch();
+
+			if (tryPush(std::forward<U>(item))) {
+				return true;
+			}
+
+			if (!_notFull.wait(epoch, deadline, timeoutMs >= 0)) {
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	/*!
+	 * \brief pop an item, waiting for one to be available.
+	 * \param timeoutMs the maximal wait, or a negative value to wait without limit.
+	 * \return false on timeout or if the queue has been closed and is empty.
+	 */
+	bool pop(T & item, int timeoutMs = -1) {
+
+		QueueWaiter::Deadline deadline = QueueWaiter::deadlineFromTimeout(timeoutMs);
+
+		for (;;) {
+
+			uint32_t epoch = _notEmpty.epoch();
+
+			if (tryPop(item)) {
+				return true;
+			}
+
+			if (_closed.load(std::memory_order_acquire)) {
+				return tryPop(item);
+			}
+
+			if (!_notEmpty.wait(epoch, deadline, timeoutMs >= 0)) {
+				return false;
+			}
+		}
+	}
+
+	/*!
+	 * \brief close the queue, waking up the waiting threads. The remaining items can still be popped.
+	 */
+	void close() {
+		_closed.store(true, std::memory_order_release);
+		_notEmpty.notify();
+		_notFull.notify();
+	}
+
+	inline bool isClosed() const { return _closed.load(std::memory_order_acquire); }
+
+protected:
+
+	static size_t roundCapacity(size_t capacity) {
+		size_t ret = 1;
+		while (ret < capacity) {
+			ret <<= 1;
+		}
+		return ret;
+	}
+
+	std::vector<T> _items;
+	const size_t _mask;
+	std::atomic<bool> _closed;
+
+	// consumer side
+	alignas(64) std::atomic<size_t> _head;
+	size_t _cachedTail;
+
+	// producer side
+	alignas(64) std::atomic<size_t> _tail;
+	size_t _cachedHead;
+
+	alignas(64) QueueWaiter _notEmpty;
+	alignas(64) QueueWaiter _notFull;
+};
+
+/*!
+ * \brief The MpscQueue class is a bounded lock-free queue with multiple producers and a single consumer.
+ *
+ * Each slot carries a sequence number telling whether it is free or holds an item for the current lap,
+ * so producers only contend on the tail index. Slots are padded to a cache line so that
+ * producers writing neighbour slots do not share cache lines.
+ */
+template<typename T>
+class MpscQueue
+{
+public:
+
+	explicit MpscQueue(size_t capacity, QueueWaiter::Strategy strategy = QueueWaiter::Block) :
+		_capacity(roundCapacity(capacity)),
+		_mask(_capacity-1),
+		_cells(new Cell[_capacity]),
+		_closed(false),
+		_head(0),
+		_tail(0),
+		_notEmpty(strategy),
+		_notFull(strategy)
+	{
+		for (size_t i = 0; i < _capacity; i++) {
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpscQueue(MpscQueue const&) = delete;
+	MpscQueue& operator=(MpscQueue const&) = delete;
+
+	inline size_t capacity() const { return _capacity; }
+	/*!
+	 * \brief sizeApprox give the number of items in the queue, from any thread, in [0, capacity()].
+	 */
+	inline size_t sizeApprox() const {
+		// the head is loaded first, so the tail read after it cannot be behind it.
+		size_t head = _head.load(std::memory_order_acquire);
+		size_t tail = _tail.load(std::memory_order_acquire);
+		return (tail > head) ? std::min<size_t>(tail - head, _capacity) : 0;
+	}
+
+	/*!
+	 * \brief tryPush push an item, without waiting. item is only moved from if the push succeed.
+	 */
+	template<typename U>
+	bool tryPush(U&& item) {
+
+		size_t pos = _tail.load(std::memory_order_relaxed);
+		Cell* cell;
+
+		for (;;) {
+			cell = &_cells[pos & _mask];
+			size_t seq = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+			if (diff == 0) {
+				if (_tail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) { //full
+				return false;
+			} else {
+				pos = _tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->item = std::forward<U>(item);
+		cell->sequence.store(pos+1, std::memory_order_release);
+
+		_notEmpty.notify();
+		return true;
+	}
+
+	/*!
+	 * \brief tryPop pop an item, without waiting. Must only be called by the consumer thread.
+	 */
+	bool tryPop(T & item) {
+
+		size_t pos = _head.load(std::memory_order_relaxed);
+		Cell* cell = &_cells[pos & _mask];
+
+		if (cell->sequence.load(std::memory_order_acquire) != pos+1) {
+			return false;
+		}
+
+		item = std::move(cell->item);
+		cell->item = T();
+		cell->sequence.store(pos + _capacity, std::memory_order_release);
+		_head.store(pos+1, std::memory_order_release);
+
+		_notFull.notify();
+		return true;
+	}
+
+	template<typename U>
+	bool push(U&& item, int timeoutMs = -1) {
+
+		QueueWaiter::Deadline deadline = QueueWaiter::deadlineFromTimeout(timeoutMs);
+
+		while (!_closed.load(std::memory_order_acquire)) {
+
+			uint32_t epoch = _notFull.epoch();
+
+			if (tryPush(std::forward<U>(item))) {
+				return true;
+			}
+
+			if (!_notFull.wait(epoch, deadline, timeoutMs >= 0)) {
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	bool pop(T & item, int timeoutMs = -1) {
+
+		QueueWaiter::Deadline deadline = QueueWaiter::deadlineFromTimeout(timeoutMs);
+
+		for (;;) {
+
+			uint32_t epoch = _notEmpty.epoch();
+
+			if (tryPop(item)) {
+				return true;
+			}
+
+			if (_closed.load(std::memory_order_acquire)) {
+				return tryPop(item);
+			}
+
+			if (!_notEmpty.wait(epoch, deadline, timeoutMs >= 0)) {
+				return false;
+			}
+		}
+	}
+
+	void close() {
+		_closed.store(true, std::memory_order_release);
+		_notEmpty.notify();
+		_notFull.notify();
+	}
+
+	inline bool isClosed() const { return _closed.load(std::memory_order_acquire); }
+
+protected:
+
+	struct alignas(64) Cell {
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	static size_t roundCapacity(size_t capacity) {
+		size_t ret = 1;
+		while (ret < capacity) {
+			ret <<= 1;
+		}
+		return ret;
+	}
+
+	const size_t _capacity;
+	const size_t _mask;
+	std::unique_ptr<Cell[]> _cells;
+	std::atomic<bool> _closed;
+
+	alignas(64) std::atomic<size_t> _head;
+	alignas(64) std::atomic<size_t> _tail;
+
+	alignas(64) QueueWaiter _notEmpty;
+	alignas(64) QueueWaiter _notFull;
+};
+
+#endif // FRAMEQUEUE_H
@@ -0,0 +1,859 @@
+#include "framerecorder.h"
+
+#include "framewriter.h"
+#include "frameinfostable.h"
+#include "sessionjournal.h"
+
+#include <QDateTime>
+#include <QSettings>
+#include <QTextStream>
+
+#include <cmath>
+#include <algorithm>
+
+const int FrameRecorder::maxPendingDecisions = 64;
+const QStringList FrameRecorder::streams = {"left", "right", "rgb", "depth"};
+
+FrameRecorder::Config FrameRecorder::Config::fromSettings() {
+
+	Config config;
+
+	QSettings settings;
+	config.writerBackend = settings.value("io/writer", config.writerBackend).toString();
+	config.directIo = settings.value("io/directio", config.directIo).toBool();
+	config.writerBuffers = settings.value("io/writerbuffers", config.writerBuffers).toInt();
+	config.writerBufferSizeMb = settings.value("io/writerbuffersize", config.writerBufferSizeMb).toInt();
+	config.infosFormat = settings.value("io/infosformat", config.infosFormat).toString();
+	config.infosBatch = settings.value("io/infosbatch", config.infosBatch).toInt();
+	config.preTriggerSeconds = settings.value("io/pretriggerseconds", config.preTriggerSeconds).toDouble();
+	config.depthCompression = settings.value("io/depthcompression", config.depthCompression).toString().toLower();
+	config.catalog = settings.value("io/catalog", config.catalog).toBool();
+	config.durability = settings.value("io/durability", config.durability).toString().toLower();
+	config.checkpointFrames = std::max(1, settings.value("io/checkpointframes", config.checkpointFrames).toInt());
+	config.checkpointIntervalMs = std::max(1, settings.value("io/checkpointinterval", config.checkpointIntervalMs).toInt());
+
+	if (config.depthCompression != "rvl" and config.depthCompression != "none") {
+		QTextStream err(stderr);
+		err << "Unknown io/depthcompression value " << config.depthCompression << " (expected rvl or none), using rvl" << endl;
+		config.depthCompression = "rvl";
+	}
+
+	if (config.durability != "fdatasync" and config.durability != "syncfs" and config.durability != "none") {
+		QTextStream err(stderr);
+		err << "Unknown io/durability value " << config.durability << " (expected fdatasync, syncfs or none), using fdatasync" << endl;
+		config.durability = "fdatasync";
+	}
+
+	settings.setValue("io/writer", config.writerBackend);
+	settings.setValue("io/directio", config.directIo);
+	settings.setValue("io/writerbuffers", config.writerBuffers);
+	settings.setValue("io/writerbuffersize", config.writerBufferSizeMb);
+	settings.setValue("io/infosformat", config.infosFormat);
+	settings.setValue("io/infosbatch", config.infosBatch);
+	settings.setValue("io/pretriggerseconds", config.preTriggerSeconds);
+	settings.setValue("io/depthcompression", config.depthCompression);
+	settings.setValue("io/catalog", config.catalog);
+	settings.setValue("io/durability", config.durability);
+	settings.setValue("io/checkpointframes", config.checkpointFrames);
+	settings.setValue("io/checkpointinterval", config.checkpointIntervalMs);
+
+	return config;
+}
+
+FrameRecorder::FrameRecorder(QObject *parent) :
+	QObject(parent),
+	_cameraFps(30),
+	_frameSetParts(1),
+	_isStarted(false),
+	_nextFrameSetId(0),
+	_imgsToSave(0),
+	_saving_imgs(false),
+	_writer(nullptr),
+	_writesInFlight(0),
+	_preallocationScheduled(false),
+	_backgroundBusy(false),
+	_backgroundContinue(false),
+	_catalog(nullptr),
+	_journal(nullptr)
+{
+	for (StreamCounters & counters : _streamCounters) {
+		counters.captured = 0;
+		counters.saved = 0;
+		counters.failed = 0;
+	}
+
+	_getTimeMs = [] () {
+		return QDateTime::currentMSecsSinceEpoch();
+	};
+}
+
+FrameRecorder::~FrameRecorder() {
+	stop();
+}
+
+QDir FrameRecorder::outputFolder() const {
+	QMutexLocker locker(&_saveAcessControl);
+	return _imgFolder;
+}
+void FrameRecorder::setOutputFolder(QDir const& folder) {
+	QMutexLocker locker(&_saveAcessControl);
+	_imgFolder = folder;
+	_recordingMonitor.setOutputFolder(folder.absolutePath());
+}
+
+void FrameRecorder::setTimeSource(std::function<qint64()> const& getTimeMs) {
+	_getTimeMs = getTimeMs;
+}
+
+void FrameRecorder::setFrameSavedCallback(FrameSavedCallback const& callback) {
+	_frameSavedCallback = callback;
+}
+
+void FrameRecorder::start(Config const& config, int cameraFps) {
+
+	stop();
+
+	_config = config;
+	_cameraFps = cameraFps;
+
+	QString sessionId = QDateTime::currentDateTimeUtc().toString("yyyy_MM_dd_hh_mm_ss_zzz");
+
+	openCatalog(sessionId);
+	openJournal(sessionId);
+	configureFrameWriter();
+	openInfosTables();
+	startBackgroundThread();
+
+	_nextFrameSetId = 0;
+	_isStarted = true;
+
+	updatePreTriggerCapacity();
+}
+
+void FrameRecorder::stop() {
+
+	if (!_isStarted) {
+		return;
+	}
+
+	stopSaveFrames();
+
+	// the pre-trigger framesets being written are finished before the writer and the session files are closed.
+	stopBackgroundThread();
+
+	_preTriggerBuffer.setCapacity(0);
+	releaseFrameWriter();
+	closeInfosTables();
+	closeJournal();
+	closeCatalog();
+
+	_decisionsMutex.lock();
+	_decisions.clear();
+	_decisionsMutex.unlock();
+
+	_isStarted = false;
+}
+
+bool FrameRecorder::isStarted() const {
+	return _isStarted;
+}
+
+void FrameRecorder::saveFrames(int nFrames) {
+	if (nFrames > 0) {
+		_imgsToSave.fetch_add(nFrames);
+	}
+}
+void FrameRecorder::saveFramesContinuous() {
+	_saving_imgs.store(true);
+}
+void FrameRecorder::stopSaveFrames() {
+	_imgsToSave.store(0);
+	_saving_imgs.store(false);
+}
+bool FrameRecorder::isSaving() const {
+	return _imgsToSave > 0 or _saving_imgs;
+}
+
+void FrameRecorder::setPreTriggerDuration(double seconds) {
+
+	_config.preTriggerSeconds = std::max(0., seconds);
+	updatePreTriggerCapacity();
+}
+
+void FrameRecorder::setFrameSetParts(int parts) {
+	_frameSetParts = std::max(1, parts);
+	updatePreTriggerCapacity();
+}
+
+void FrameRecorder::updatePreTriggerCapacity() {
+
+	if (_isStarted) {
+		_preTriggerBuffer.setCapacity(static_cast<int>(std::ceil(_config.preTriggerSeconds*_cameraFps))*_frameSetParts);
+		preallocatePreTriggerBuffer();
+	}
+}
+
+void FrameRecorder::preallocatePreTriggerBuffer() {
+
+	if (_preallocationScheduled.exchange(true)) {
+		return;
+	}
+
+	runInBackground([this] () {
+		_preallocationScheduled = false;
+		_preTriggerBuffer.preallocate();
+	});
+}
+
+void FrameRecorder::runInBackground(std::function<void()> const& job) {
+
+	QMutexLocker locker(&_backgroundMutex);
+
+	if (!_backgroundContinue) { //not started, the job is run at once.
+		locker.unlock();
+		job();
+		return;
+	}
+
+	_backgroundJobs.enqueue(job);
+	_backgroundJobAvailable.wakeOne();
+}
+
+void FrameRecorder::waitBackgroundJobs() {
+
+	QMutexLocker locker(&_backgroundMutex);
+
+	while (_backgroundBusy or !_backgroundJobs.isEmpty()) {
+		_backgroundIdle.wait(&_backgroundMutex);
+	}
+}
+
+void FrameRecorder::startBackgroundThread() {
+
+	stopBackgroundThread();
+
+	_backgroundContinue = true;
+
+	_backgroundThread = std::thread([this] () {
+
+		QMutexLocker locker(&_backgroundMutex);
+
+		while (true) {
+
+			while (_backgroundJobs.isEmpty() and _backgroundContinue) {
+				_backgroundIdle.wakeAll();
+				_backgroundJobAvailable.wait(&_backgroundMutex);
+			}
+
+			if (_backgroundJobs.isEmpty()) { //stopped, once all the jobs are done.
+				break;
+			}
+
+			std::function<void()> job = _backgroundJobs.dequeue();
+			_backgroundBusy = true;
+			locker.unlock();
+
+			job();
+
+			locker.relock();
+			_backgroundBusy = false;
+		}
+
+		_backgroundIdle.wakeAll();
+	});
+}
+
+void FrameRecorder::stopBackgroundThread() {
+
+	if (!_backgroundThread.joinable()) {
+		return;
+	}
+
+	_backgroundMutex.lock();
+	_backgroundContinue = false;
+	_backgroundJobAvailable.wakeAll();
+	_backgroundMutex.unlock();
+
+	_backgroundThread.join();
+}
+
+void FrameRecorder::flush() {
+
+	waitBackgroundJobs();
+
+	if (_writer != nullptr) {
+		_writer->flush();
+	}
+
+	QMutexLocker locker(&_infosTablesMutex);
+
+	for (FrameInfosTable* table : _infosTables) {
+		table->flush();
+	}
+
+	locker.unlock();
+
+	QMutexLocker catalogLocker(&_catalogMutex);
+
+	if (_catalog != nullptr) {
+		_catalog->flush();
+	}
+}
+
+RecordingMonitor& FrameRecorder::monitor() {
+	return _recordingMonitor;
+}
+RecordingMonitor const& FrameRecorder::monitor() const {
+	return _recordingMonitor;
+}
+
+SessionCatalog::Stats FrameRecorder::catalogStats() const {
+
+	QMutexLocker locker(&_catalogMutex);
+
+	if (_catalog == nullptr) {
+		return {0, 0, 0};
+	}
+
+	return _catalog->stats();
+}
+
+QVector<FrameRecorder::StreamStats> FrameRecorder::streamStats() const {
+
+	QVector<StreamStats> stats;
+
+	for (StreamCounters const& counters : _streamCounters) {
+		stats.push_back({counters.captured.load(), counters.saved.load(), counters.failed.load()});
+	}
+
+	return stats;
+}
+
+int FrameRecorder::writesInFlight() const {
+	return _writesInFlight.load();
+}
+
+void FrameRecorder::countCaptured(ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth) {
+
+	ImageFrame const* frames[] = {&frameLeft, &frameRight, &frameRGB, &frameDepth};
+
+	for (int i = 0; i < 4; i++) {
+		if (frames[i]->isValid()) {
+			_streamCounters[i].captured.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+void FrameRecorder::countWritten(QString const& framePath, bool ok) {
+
+	// the frames are named <timestamp>_<stream>.<extension> or <timestamp>_<frameset id>_<stream>.<extension>
+	int end = framePath.lastIndexOf('.');
+	int start = framePath.lastIndexOf('_', end) + 1;
+	int stream = streams.indexOf(framePath.mid(start, end - start));
+
+	if (stream < 0) {
+		return;
+	}
+
+	if (ok) {
+		_streamCounters[stream].saved.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		_streamCounters[stream].failed.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void FrameRecorder::addSessionFile(QString const& filePath) {
+
+	if (_journal != nullptr) {
+		_journal->addSessionFile(filePath);
+	}
+}
+
+bool FrameRecorder::receiveFrames(ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth) {
+
+	_recordingMonitor.recordIncomingFrameSet(frameLeft.payloadBytes() + frameRight.payloadBytes() + frameRGB.payloadBytes() + frameDepth.payloadBytes());
+	countCaptured(frameLeft, frameRight, frameRGB, frameDepth);
+
+	return saveOrBuffer(consumeSaveRequest(), _nextFrameSetId++, frameLeft, frameRight, frameRGB, frameDepth, _getTimeMs());
+}
+
+bool FrameRecorder::receiveFrameSetPart(qint64 frameSetNumber, ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth) {
+
+	bool firstPart = false;
+	FrameSetDecision decision = decideFrameSet(frameSetNumber, firstPart);
+
+	countCaptured(frameLeft, frameRight, frameRGB, frameDepth);
+
+	if (firstPart) {
+		// the incoming rate is measured once per frameset, the bytes of the other parts are estimated from this one.
+		_recordingMonitor.recordIncomingFrameSet(_frameSetParts*(frameLeft.payloadBytes() + frameRight.payloadBytes() + frameRGB.payloadBytes() + frameDepth.payloadBytes()));
+	}
+
+	return saveOrBuffer(decision.save, frameSetNumber, frameLeft, frameRight, frameRGB, frameDepth, decision.timeMs);
+}
+
+bool FrameRecorder::consumeSaveRequest() {
+
+	if (_saving_imgs) {
+		return true;
+	}
+
+	int remaining = _imgsToSave.load();
+	while (remaining > 0 and !_imgsToSave.compare_exchange_weak(remaining, remaining-1)) {
+	}
+
+	return remaining > 0;
+}
+
+FrameRecorder::FrameSetDecision FrameRecorder::decideFrameSet(qint64 frameSetNumber, bool & firstPart) {
+
+	QMutexLocker locker(&_decisionsMutex);
+
+	auto it = _decisions.constFind(frameSetNumber);
+
+	if (it != _decisions.constEnd()) {
+		firstPart = false;
+		return it.value();
+	}
+
+	firstPart = true;
+
+	FrameSetDecision decision;
+	decision.timeMs = _getTimeMs();
+
+	if (!_decisions.isEmpty() and frameSetNumber < _decisions.firstKey()) { //too late, the other parts are long gone.
+		decision.save = false;
+		return decision;
+	}
+
+	decision.save = consumeSaveRequest();
+
+	_decisions.insert(frameSetNumber, decision);
+
+	while (_decisions.size() > maxPendingDecisions) {
+		_decisions.erase(_decisions.begin());
+	}
+
+	return decision;
+}
+
+bool FrameRecorder::saveOrBuffer(bool save, qint64 frameSetId, ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth, qint64 timeMs) {
+
+	if (save) {
+
+		if (_preTriggerBuffer.size() > 0) {
+
+			// only the frame handles are taken from the ring, the buffered framesets are written by the background
+			// thread, so that the capture goes on while seconds of frames are written.
+			auto buffered = std::make_shared<FrameSetRingBuffer::FrameSets>(_preTriggerBuffer.take());
+
+			runInBackground([this, buffered] () {
+
+				for (FrameSetRingBuffer::FrameSet const& frameSet : *buffered) {
+					saveFrameSet(frameSet.frameSetId, frameSet.frame(0), frameSet.frame(1), frameSet.frame(2), frameSet.frame(3), frameSet.timeMs);
+				}
+
+				_preTriggerBuffer.recycle(std::move(*buffered));
+			});
+		}
+
+		saveFrameSet(frameSetId, frameLeft, frameRight, frameRGB, frameDepth, timeMs);
+
+		if (_recordingMonitor.failedWrites() > 0) {
+			_recordingMonitor.resetFailedWrites();
+			stopSaveFrames();
+			Q_EMIT recordingWarningRaised("Failed to write frames (is the disk full ?), saving stopped !");
+		}
+
+		return true;
+	}
+
+	if (_preTriggerBuffer.capacity() > 0) {
+
+		_preTriggerBuffer.push(frameSetId, frameLeft, frameRight, frameRGB, frameDepth, timeMs);
+
+		if (!_preTriggerBuffer.buffersReady()) { //first frameset, or the frames size changed.
+			preallocatePreTriggerBuffer();
+		}
+	}
+
+	return false;
+}
+
+void FrameRecorder::saveFrameSet(qint64 frameSetId, ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth, qint64 timeMs) {
+
+	QDateTime date = QDateTime::fromMSecsSinceEpoch(timeMs);
+	QString timestamp =date.toString("yyyy_MM_dd_hh_mm_ss_zzz");
+
+	if (_config.frameSetIdInNames) { //played back framesets can come faster than one per millisecond.
+		timestamp += QString("_%1").arg(frameSetId, 9, 10, QChar('0'));
+	}
+	saveFrame(frameLeft, frameSetId, timeMs, timestamp, "left");
+	saveFrame(frameRight, frameSetId, timeMs, timestamp, "right");
+	saveFrame(frameRGB, frameSetId, timeMs, timestamp, "rgb");
+	saveFrame(frameDepth, frameSetId, timeMs, timestamp, "depth", (_config.depthCompression == "rvl") ? ImageFrame::RawRvl : ImageFrame::RawPlain);
+}
+
+bool FrameRecorder::saveFrame(ImageFrame const& frame, qint64 frameSetId, qint64 timeMs, QString const& timestamp, QString const& stream,
+							  ImageFrame::RawEncoding encoding) {
+
+	if (!frame.isValid()) {
+		return false;
+	}
+
+	QString basePath = outputFolder().filePath(timestamp + "_" + stream);
+
+	if (_writer != nullptr) {
+		QString rawFramePath = basePath + ImageFrame::rawFrameExtension;
+
+		// the entry and the infos are ready before the write can complete, they are used by the completion callback.
+		catalogFrame(frame, frameSetId, timeMs, stream, rawFramePath, encoding, true);
+
+		if (_frameSavedCallback) {
+			QMutexLocker locker(&_pendingInfosMutex);
+			_pendingInfos.insert(rawFramePath, frame.additionalInfos());
+		}
+
+		_writesInFlight++;
+
+		if (_writer->enqueue(frame, rawFramePath, encoding)) {
+			saveFrameInfos(frame, rawFramePath, stream);
+			return true;
+		}
+
+		_writesInFlight--;
+
+		_pendingInfosMutex.lock();
+		_pendingInfos.remove(rawFramePath);
+		_pendingInfosMutex.unlock();
+
+		QMutexLocker locker(&_catalogMutex);
+		_pendingEntries.remove(rawFramePath);
+	}
+
+	// compressed frames can only be stored in the raw frame format.
+	QString framePath = basePath + ((encoding == ImageFrame::RawPlain) ? QString(".stevimg") : ImageFrame::rawFrameExtension);
+
+	bool ok = frame.save(framePath, false, encoding);
+	_recordingMonitor.recordWrite(frame.payloadBytes(), ok);
+	countWritten(framePath, ok);
+
+	if (ok) {
+		saveFrameInfos(frame, framePath, stream);
+
+		if (_journal != nullptr) {
+			_journal->frameWritten(framePath, ok);
+		}
+
+		catalogFrame(frame, frameSetId, timeMs, stream, framePath, encoding);
+
+		if (_frameSavedCallback) {
+			_frameSavedCallback(framePath, frame.additionalInfos());
+		}
+	}
+
+	return ok;
+}
+
+void FrameRecorder::saveFrameInfos(ImageFrame const& frame, QString const& framePath, QString const& stream) {
+
+	QMap<QString, QString> infos = frame.additionalInfos();
+
+	// without catalog, the checksum of the formats which have none in their header is kept with the infos.
+	if (!_config.catalog and !framePath.endsWith(ImageFrame::rawFrameExtension)) {
+		infos.insert(SessionCatalog::crc32cKey, QString("%1").arg(frame.payloadCrc32c(), 8, 16, QChar('0')));
+	}
+
+	if (infos.isEmpty()) {
+		return;
+	}
+
+	QMutexLocker locker(&_infosTablesMutex);
+
+	if (_recordingId.isEmpty()) { //tables are disabled
+		locker.unlock();
+		ImageFrame::saveInfos(framePath, infos);
+		return;
+	}
+
+	FrameInfosTable* table = _infosTables.value(stream, nullptr);
+
+	if (table == nullptr) {
+		QString tablePath = outputFolder().filePath("recording_" + _recordingId + "_" + stream + FrameInfosTable::tableExtension);
+		table = new FrameInfosTable(tablePath, _config.infosBatch);
+		_infosTables.insert(stream, table);
+		addSessionFile(tablePath);
+	}
+
+	table->append(framePath, infos);
+}
+
+void FrameRecorder::configureFrameWriter() {
+
+	releaseFrameWriter();
+
+	if (_config.writerBackend != "pwrite" and _config.writerBackend != "iouring") { //default LibStevi writer
+		return;
+	}
+
+	_writer = new FrameWriter(this);
+
+	bool ok = _writer->configure((_config.writerBackend == "iouring") ? FrameWriter::IoUring : FrameWriter::PWrite,
+								 _config.directIo,
+								 _config.writerBuffers,
+								 static_cast<size_t>(_config.writerBufferSizeMb)*1024*1024);
+
+	if (!ok) {
+		QTextStream err(stderr);
+		err << "Failed to allocate the frame writer buffers, falling back to the default writer" << endl;
+		delete _writer;
+		_writer = nullptr;
+		return;
+	}
+
+	_writer->setCompletionCallback([this] (QString const& filePath, bool ok, qint64 bytes) {
+		_recordingMonitor.recordWrite(bytes, ok);
+		_writesInFlight--;
+		countWritten(filePath, ok);
+		frameCompleted(filePath, ok);
+
+		if (!_frameSavedCallback) {
+			return;
+		}
+
+		_pendingInfosMutex.lock();
+		QMap<QString, QString> infos = _pendingInfos.take(filePath);
+		_pendingInfosMutex.unlock();
+
+		if (ok) {
+			_frameSavedCallback(filePath, infos);
+		}
+	});
+
+	_writer->start();
+}
+
+void FrameRecorder::releaseFrameWriter() {
+
+	if (_writer == nullptr) {
+		return;
+	}
+
+	_writer->finish();
+	_writer->wait();
+
+	delete _writer;
+	_writer = nullptr;
+}
+
+void FrameRecorder::openInfosTables() {
+
+	closeInfosTables();
+
+	QMutexLocker locker(&_infosTablesMutex);
+
+	if (_config.infosFormat != "table") { //one .infos file per frame
+		_recordingId.clear();
+		return;
+	}
+
+	_recordingId = QDateTime::currentDateTimeUtc().toString("yyyy_MM_dd_hh_mm_ss_zzz");
+}
+
+void FrameRecorder::closeInfosTables() {
+
+	QMutexLocker locker(&_infosTablesMutex);
+
+	for (FrameInfosTable* table : _infosTables) {
+		if (!table->flush()) {
+			QTextStream err(stderr);
+			err << "Failed to write frames infos table " << table->tablePath() << endl;
+		}
+		delete table;
+	}
+
+	_infosTables.clear();
+	_recordingId.clear();
+}
+
+void FrameRecorder::catalogFrame(ImageFrame const& frame, qint64 frameSetId, qint64 timeMs, QString const& stream, QString const& framePath, ImageFrame::RawEncoding encoding, bool pending) {
+
+	bool rawFrame = framePath.endsWith(ImageFrame::rawFrameExtension);
+
+	// raw frames carry their checksum in their header, the checksum of the other formats is kept by the catalog.
+	QString crc32c;
+
+	if (_config.catalog and !rawFrame) {
+		crc32c = QString("%1").arg(frame.payloadCrc32c(), 8, 16, QChar('0'));
+	}
+
+	QMutexLocker locker(&_catalogMutex);
+
+	if (_catalog == nullptr) {
+		return;
+	}
+
+	SessionCatalog::Entry entry;
+	entry.frameSetId = frameSetId;
+	entry.stream = stream;
+	entry.fileName = _catalogFolder.relativeFilePath(framePath);
+	entry.offset = (rawFrame) ? static_cast<qint64>(ImageFrame::rawHeaderBytes) : 0;
+	entry.bytes = frame.payloadBytes();
+	entry.timeMs = timeMs;
+
+	entry.metadata.insert("width", QString::number(frame.width()));
+	entry.metadata.insert("height", QString::number(frame.height()));
+	entry.metadata.insert("channels", QString::number(frame.channels()));
+	entry.metadata.insert("type", QString::number(frame.imgType()));
+
+	if (encoding != ImageFrame::RawPlain) {
+		entry.metadata.insert("encoding", QString::number(encoding));
+	}
+
+	if (!crc32c.isEmpty()) {
+		entry.metadata.insert(SessionCatalog::crc32cKey, crc32c);
+	}
+
+	if (pending) {
+		_pendingEntries.insert(framePath, entry);
+		return;
+	}
+
+	_catalog->append(entry);
+}
+
+void FrameRecorder::frameCompleted(QString const& framePath, bool ok) {
+
+	// the journal is notified first, so that the catalog only holds frames covered by the next checkpoint.
+	if (_journal != nullptr) {
+		_journal->frameWritten(framePath, ok);
+	}
+
+	QMutexLocker locker(&_catalogMutex);
+
+	auto it = _pendingEntries.find(framePath);
+
+	if (it == _pendingEntries.end()) {
+		return;
+	}
+
+	if (ok and _catalog != nullptr) {
+		_catalog->append(it.value());
+	}
+
+	_pendingEntries.erase(it);
+}
+
+void FrameRecorder::openCatalog(QString const& sessionId) {
+
+	closeCatalog();
+
+	if (!_config.catalog) {
+		return;
+	}
+
+	QMutexLocker locker(&_catalogMutex);
+
+	_catalogFolder = outputFolder();
+	_catalog = new SessionCatalog(SessionCatalog::catalogPathForSession(_catalogFolder, sessionId), _config.infosBatch);
+}
+
+void FrameRecorder::closeCatalog() {
+
+	QMutexLocker locker(&_catalogMutex);
+
+	if (_catalog == nullptr) {
+		return;
+	}
+
+	if (!_catalog->flush()) {
+		QTextStream err(stderr);
+		err << "Failed to write the session catalog " << _catalog->catalogPath() << endl;
+	}
+
+	delete _catalog;
+	_catalog = nullptr;
+	_pendingEntries.clear();
+}
+
+void FrameRecorder::openJournal(QString const& sessionId) {
+
+	closeJournal();
+
+	SessionJournal::Config config;
+	config.durability = _config.durability;
+	config.checkpointFrames = _config.checkpointFrames;
+	config.checkpointIntervalMs = _config.checkpointIntervalMs;
+
+	SessionJournal* journal = new SessionJournal(SessionJournal::journalPathForSession(outputFolder(), sessionId), config);
+	journal->setCheckpointCallback([this] () {
+		return checkpointSessionFiles();
+	});
+
+	// the frames are named after their timestamps, which cannot precede the start of the session.
+	QString firstFrameName = QDateTime::fromMSecsSinceEpoch(_getTimeMs()).toString("yyyy_MM_dd_hh_mm_ss_zzz");
+
+	if (!journal->open(firstFrameName)) {
+		QTextStream err(stderr);
+		err << "Failed to open the session journal, the recording will not be recoverable after a crash" << endl;
+		delete journal;
+		return;
+	}
+
+	_journalMutex.lock();
+	_journal = journal;
+	_journalMutex.unlock();
+
+	QMutexLocker locker(&_catalogMutex);
+
+	if (_catalog != nullptr) {
+		_journal->addSessionFile(_catalog->catalogPath());
+	}
+}
+
+void FrameRecorder::closeJournal() {
+
+	_journalMutex.lock();
+	SessionJournal* journal = _journal;
+	_journal = nullptr;
+	_journalMutex.unlock();
+
+	if (journal == nullptr) {
+		return;
+	}
+
+	journal->close();
+	delete journal;
+}
+
+void FrameRecorder::frameRemoved(QString const& framePath) {
+
+	QMutexLocker locker(&_journalMutex);
+
+	if (_journal != nullptr) {
+		_journal->frameRemoved(framePath);
+	}
+}
+
+qint64 FrameRecorder::checkpointSessionFiles() {
+
+	bool ok = true;
+
+	QMutexLocker locker(&_infosTablesMutex);
+
+	for (FrameInfosTable* table : _infosTables) {
+		ok = table->flush() and ok;
+	}
+
+	locker.unlock();
+
+	QMutexLocker catalogLocker(&_catalogMutex);
+
+	if (_catalog == nullptr) {
+		return (ok) ? 0 : -1;
+	}
+
+	ok = _catalog->flush() and ok;
+
+	return (ok) ? _catalog->stats().frames : -1;
+}
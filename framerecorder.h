@@ -0,0 +1,294 @@
+#ifndef FRAMERECORDER_H
+#define FRAMERECORDER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QDir>
+#include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QQueue>
+#include <QStringList>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "./imageframe.h"
+#include "./framesetringbuffer.h"
+#include "./recordingmonitor.h"
+#include "./sessioncatalog.h"
+
+class FrameWriter;
+class FrameInfosTable;
+class SessionJournal;
+
+/*!
+ * \brief The FrameRecorder class implement the save logic for the framesets produced by a camera.
+ *
+ * It decides which framesets are saved, keeps the pre-trigger buffer, and writes the frames and their infos,
+ * either directly or through a FrameWriter. receiveFrames is meant to be called from the acquisition thread.
+ */
+class FrameRecorder : public QObject
+{
+	Q_OBJECT
+public:
+
+	struct Config {
+
+		Config() :
+			writerBackend("stevimg"),
+			directIo(false),
+			writerBuffers(32),
+			writerBufferSizeMb(16),
+			infosFormat("table"),
+			infosBatch(64),
+			preTriggerSeconds(0),
+			depthCompression("rvl"),
+			catalog(true),
+			durability("fdatasync"),
+			checkpointFrames(256),
+			checkpointIntervalMs(1000),
+			frameSetIdInNames(false)
+		{
+
+		}
+
+		/*!
+		 * \brief fromSettings load the configuration from the application settings (and write back the defaults).
+		 */
+		static Config fromSettings();
+
+		QString writerBackend; //!< "stevimg", "pwrite" or "iouring"
+		bool directIo;
+		int writerBuffers;
+		int writerBufferSizeMb;
+
+		QString infosFormat; //!< "table" or "files"
+		int infosBatch;
+
+		double preTriggerSeconds;
+
+		QString depthCompression; //!< "rvl" or "none", the encoding of the depth frames written as raw frames.
+
+		bool catalog; //!< if true, the saved frames are indexed in a session catalog.
+
+		QString durability; //!< "fdatasync", "syncfs" or "none", how the frames are made durable at each checkpoint (see SessionJournal).
+		int checkpointFrames; //!< the maximal number of frames written between two checkpoints.
+		int checkpointIntervalMs; //!< the maximal delay between two checkpoints.
+
+		bool frameSetIdInNames; //!< if true, the frameset id is added to the frames names (set for playbacks, not a setting).
+	};
+
+	/*!
+	 * \brief FrameSavedCallback is called each time a frame has been completely written, from the thread which wrote it.
+	 *
+	 * The infos of the frame are given with it, since they may still be waiting in an infos table batch.
+	 */
+	using FrameSavedCallback = std::function<void(QString const& framePath, QMap<QString, QString> const& infos)>;
+
+	/*!
+	 * \brief The StreamStats struct count the frames of a stream since the recorder was created.
+	 */
+	struct StreamStats {
+		qint64 captured; //!< the valid frames received from the camera, saved or not.
+		qint64 saved;
+		qint64 failed; //!< the frames which could not be written.
+	};
+
+	static const QStringList streams;
+
+	explicit FrameRecorder(QObject *parent = nullptr);
+	~FrameRecorder();
+
+	QDir outputFolder() const;
+	void setOutputFolder(QDir const& folder);
+
+	/*!
+	 * \brief setTimeSource set the function used to timestamp the framesets, by default the system time.
+	 */
+	void setTimeSource(std::function<qint64()> const& getTimeMs);
+
+	/*!
+	 * \brief setFrameSavedCallback set the function notified of the written frames, must be called while the recorder is stopped.
+	 */
+	void setFrameSavedCallback(FrameSavedCallback const& callback);
+
+	/*!
+	 * \brief frameRemoved notify that a saved frame has been removed (e.g. exported), can be called from any thread.
+	 */
+	void frameRemoved(QString const& framePath);
+
+	void start(Config const& config, int cameraFps);
+	void stop();
+	bool isStarted() const;
+
+	void saveFrames(int nFrames);
+	void saveFramesContinuous();
+	void stopSaveFrames();
+	bool isSaving() const;
+
+	void setPreTriggerDuration(double seconds);
+
+	/*!
+	 * \brief flush block until all the frames received so far are written.
+	 */
+	void flush();
+
+	RecordingMonitor& monitor();
+	RecordingMonitor const& monitor() const;
+
+	/*!
+	 * \brief catalogStats give the statistics of the catalog of the current session (zeros if there is none).
+	 */
+	SessionCatalog::Stats catalogStats() const;
+
+	/*!
+	 * \brief streamStats give the frame counters of each stream (see streams), can be called from any thread.
+	 */
+	QVector<StreamStats> streamStats() const;
+	/*!
+	 * \brief writesInFlight give the number of frames queued to the frame writer and not completely written yet.
+	 */
+	int writesInFlight() const;
+
+	/*!
+	 * \brief addSessionFile register a text file written along the current session, so that it is synced at each checkpoint and repaired after a crash.
+	 */
+	void addSessionFile(QString const& filePath);
+
+	/*!
+	 * \brief receiveFrames treat a frameset coming from the camera.
+	 * \return true if the frameset has been saved, false otherwise.
+	 */
+	bool receiveFrames(ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth);
+
+	/*!
+	 * \brief setFrameSetParts set the number of parts each frameset arrives in (1 when framesets are received whole).
+	 *
+	 * It is used to size the pre-trigger buffer, which holds one entry per part.
+	 */
+	void setFrameSetParts(int parts);
+
+	/*!
+	 * \brief receiveFrameSetPart treat part of a frameset, the frames of the other streams being invalid.
+	 *
+	 * The parts of a frameset may come from different threads, in any order. The save decision and the timestamp
+	 * are taken by the first part received for a frameset number, and applied to the other parts of the same frameset.
+	 * \return true if the part has been saved, false otherwise.
+	 */
+	bool receiveFrameSetPart(qint64 frameSetNumber, ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth);
+
+Q_SIGNALS:
+
+	void recordingWarningRaised(QString txt);
+
+protected:
+
+	struct FrameSetDecision {
+		bool save;
+		qint64 timeMs;
+	};
+
+	static const int maxPendingDecisions;
+
+	bool consumeSaveRequest();
+	FrameSetDecision decideFrameSet(qint64 frameSetNumber, bool & firstPart);
+	bool saveOrBuffer(bool save, qint64 frameSetId, ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth, qint64 timeMs);
+	void updatePreTriggerCapacity();
+	void preallocatePreTriggerBuffer();
+
+	/*!
+	 * \brief runInBackground run a job on the background thread of the recorder, after the jobs already scheduled.
+	 *
+	 * The background thread writes the pre-trigger framesets and allocates the pre-trigger buffers, off the acquisition thread.
+	 */
+	void runInBackground(std::function<void()> const& job);
+	/*!
+	 * \brief waitBackgroundJobs block until all the background jobs scheduled so far are done.
+	 */
+	void waitBackgroundJobs();
+	void startBackgroundThread();
+	void stopBackgroundThread();
+
+	void saveFrameSet(qint64 frameSetId, ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth, qint64 timeMs);
+	bool saveFrame(ImageFrame const& frame, qint64 frameSetId, qint64 timeMs, QString const& timestamp, QString const& stream,
+				   ImageFrame::RawEncoding encoding = ImageFrame::RawPlain);
+	void catalogFrame(ImageFrame const& frame, qint64 frameSetId, qint64 timeMs, QString const& stream, QString const& framePath, ImageFrame::RawEncoding encoding, bool pending = false);
+	void frameCompleted(QString const& framePath, bool ok);
+	void countCaptured(ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth);
+	void countWritten(QString const& framePath, bool ok);
+	void saveFrameInfos(ImageFrame const& frame, QString const& framePath, QString const& stream);
+
+	void configureFrameWriter();
+	void releaseFrameWriter();
+
+	void openInfosTables();
+	void closeInfosTables();
+
+	void openCatalog(QString const& sessionId);
+	void closeCatalog();
+
+	void openJournal(QString const& sessionId);
+	void closeJournal();
+	qint64 checkpointSessionFiles();
+
+	Config _config;
+	int _cameraFps;
+	int _frameSetParts;
+	bool _isStarted;
+	qint64 _nextFrameSetId; //!< the id of the next frameset received whole.
+
+	std::function<qint64()> _getTimeMs;
+	FrameSavedCallback _frameSavedCallback;
+
+	mutable QMutex _saveAcessControl;
+
+	QDir _imgFolder;
+	std::atomic<int> _imgsToSave;
+	std::atomic<bool> _saving_imgs;
+
+	FrameWriter* _writer;
+	std::atomic<int> _writesInFlight;
+
+	struct StreamCounters {
+		std::atomic<qint64> captured;
+		std::atomic<qint64> saved;
+		std::atomic<qint64> failed;
+	};
+
+	StreamCounters _streamCounters[4]; //!< indexed like streams.
+
+	QMutex _decisionsMutex;
+	QMap<qint64, FrameSetDecision> _decisions; //!< the decisions for the last framesets received in parts.
+
+	FrameSetRingBuffer _preTriggerBuffer;
+	std::atomic<bool> _preallocationScheduled;
+
+	std::thread _backgroundThread;
+	QMutex _backgroundMutex;
+	QWaitCondition _backgroundJobAvailable;
+	QWaitCondition _backgroundIdle;
+	QQueue<std::function<void()>> _backgroundJobs;
+	bool _backgroundBusy;
+	bool _backgroundContinue;
+	RecordingMonitor _recordingMonitor;
+
+	QString _recordingId;
+	QMap<QString, FrameInfosTable*> _infosTables;
+	QMutex _infosTablesMutex;
+
+	QDir _catalogFolder; //!< the folder the catalog file names are relative to.
+	SessionCatalog* _catalog;
+	QHash<QString, SessionCatalog::Entry> _pendingEntries; //!< the entries of the frames being written, cataloged once complete.
+	mutable QMutex _catalogMutex;
+
+	QHash<QString, QMap<QString, QString>> _pendingInfos; //!< the infos of the frames being written, given to the frame saved callback.
+	QMutex _pendingInfosMutex;
+
+	QMutex _journalMutex; //!< protects _journal against frameRemoved, the writers are stopped before the journal is closed.
+	SessionJournal* _journal;
+};
+
+#endif // FRAMERECORDER_H
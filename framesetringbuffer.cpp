@@ -0,0 +1,224 @@
+#include "framesetringbuffer.h"
+
+#include <algorithm>
+
+FrameSetRingBuffer::FrameSetRingBuffer(int capacity) :
+	_head(0),
+	_size(0),
+	_buffersReady(false)
+{
+	for (Layout & layout : _layouts) {
+		layout = {ImageFrame::INVALID, 0, 0, 0};
+	}
+
+	setCapacity(capacity);
+}
+
+int FrameSetRingBuffer::capacity() const {
+	QMutexLocker locker(&_mutex);
+	return _slots.size();
+}
+void FrameSetRingBuffer::setCapacity(int capacity) {
+
+	QMutexLocker locker(&_mutex);
+
+	if (capacity < 0) {
+		capacity = 0;
+	}
+
+	if (capacity == _slots.size()) {
+		return;
+	}
+
+	_slots.clear();
+	_slots.resize(capacity);
+	_head = 0;
+	_size = 0;
+	_buffersReady = false;
+}
+
+int FrameSetRingBuffer::size() const {
+	QMutexLocker locker(&_mutex);
+	return _size;
+}
+
+void FrameSetRingBuffer::push(qint64 frameSetId, ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth, qint64 timeMs) {
+
+	QMutexLocker locker(&_mutex);
+
+	if (_slots.isEmpty()) {
+		return;
+	}
+
+	ImageFrame const* frames[] = {&frameLeft, &frameRight, &frameRGB, &frameDepth};
+	FrameSet & slot = _slots[_head];
+
+	slot.frameSetId = frameSetId;
+	slot.timeMs = timeMs;
+
+	for (int i = 0; i < nStreams; i++) {
+
+		ImageFrame const& frame = *frames[i];
+		slot.present[i] = frame.isValid();
+
+		if (!frame.isValid()) {
+			continue; //the buffer of the stream is kept for the next frameset.
+		}
+
+		if (!matchLayout(frame, _layouts[i])) {
+			_layouts[i] = {frame.imgType(), frame.height(), frame.width(), frame.channels()};
+			_buffersReady = false;
+		}
+
+		copyFrame(slot.frames[i], frame);
+	}
+
+	_head = (_head + 1) % _slots.size();
+
+	if (_size < _slots.size()) {
+		_size++;
+	}
+}
+
+FrameSetRingBuffer::FrameSets FrameSetRingBuffer::take() {
+
+	QMutexLocker locker(&_mutex);
+
+	FrameSets ret;
+	ret.reserve(_size);
+
+	int start = (_head - _size + _slots.size()) % std::max(1, _slots.size());
+
+	for (int i = 0; i < _size; i++) {
+		FrameSet & slot = _slots[(start + i) % _slots.size()];
+		ret.push_back(slot);
+		slot = FrameSet();
+	}
+
+	_size = 0;
+
+	if (!ret.isEmpty()) {
+		_buffersReady = false;
+	}
+
+	return ret;
+}
+
+void FrameSetRingBuffer::recycle(FrameSets && frameSets) {
+
+	QMutexLocker locker(&_mutex);
+
+	for (int stream = 0; stream < nStreams; stream++) {
+
+		int next = 0;
+
+		for (int i = 0; i < _slots.size(); i++) {
+
+			if (!isFreeBuffer(i, stream) or matchLayout(_slots[i].frames[stream], _layouts[stream])) {
+				continue;
+			}
+
+			while (next < frameSets.size() and !matchLayout(frameSets[next].frames[stream], _layouts[stream])) {
+				next++;
+			}
+
+			if (next >= frameSets.size()) {
+				break;
+			}
+
+			_slots[i].frames[stream] = frameSets[next].frames[stream];
+			frameSets[next].frames[stream] = ImageFrame();
+		}
+	}
+
+	frameSets.clear();
+
+	_buffersReady = allSlotsHaveBuffers();
+}
+
+bool FrameSetRingBuffer::buffersReady() const {
+	QMutexLocker locker(&_mutex);
+	return _buffersReady;
+}
+
+void FrameSetRingBuffer::preallocate() {
+
+	QMutexLocker locker(&_mutex);
+
+	if (_buffersReady) {
+		return;
+	}
+
+	Layout layouts[nStreams];
+	std::copy(std::begin(_layouts), std::end(_layouts), std::begin(layouts));
+	int capacity = _slots.size();
+
+	locker.unlock();
+
+	FrameSets allocated(capacity);
+
+	for (FrameSet & frameSet : allocated) {
+		for (int stream = 0; stream < nStreams; stream++) {
+			Layout const& layout = layouts[stream];
+			frameSet.frames[stream] = ImageFrame::allocate(layout.type, layout.height, layout.width, layout.channels);
+		}
+	}
+
+	locker.relock();
+
+	if (capacity != _slots.size()) {
+		return; //resized in the meantime, the next preallocation will use the new capacity.
+	}
+
+	for (int stream = 0; stream < nStreams; stream++) {
+		if (capacity == 0 or !matchLayout(allocated[0].frames[stream], _layouts[stream])) {
+			continue; //the size of the frames changed in the meantime, or the allocation failed.
+		}
+
+		for (int i = 0; i < _slots.size(); i++) {
+			if (isFreeBuffer(i, stream) and !matchLayout(_slots[i].frames[stream], _layouts[stream])) {
+				_slots[i].frames[stream] = allocated[i].frames[stream];
+			}
+		}
+	}
+
+	_buffersReady = allSlotsHaveBuffers();
+}
+
+void FrameSetRingBuffer::clear() {
+	QMutexLocker locker(&_mutex);
+	_size = 0;
+}
+
+bool FrameSetRingBuffer::matchLayout(ImageFrame const& frame, Layout const& layout) {
+	return frame.imgType() == layout.type and
+			frame.height() == layout.height and
+			frame.width() == layout.width and
+			frame.channels() == layout.channels;
+}
+
+void FrameSetRingBuffer::copyFrame(ImageFrame & slot, ImageFrame const& frame) {
+
+	if (!slot.copyPixelsFrom(frame)) {
+		slot = frame.deepCopy();
+	}
+}
+
+bool FrameSetRingBuffer::isFreeBuffer(int slot, int stream) const {
+	// the filled slots are the _size slots preceding _head.
+	int age = (_head - 1 - slot + 2*_slots.size()) % _slots.size();
+	return age >= _size or !_slots[slot].present[stream];
+}
+
+bool FrameSetRingBuffer::allSlotsHaveBuffers() const {
+
+	for (FrameSet const& slot : _slots) {
+		for (int stream = 0; stream < nStreams; stream++) {
+			if (_layouts[stream].type != ImageFrame::INVALID and !matchLayout(slot.frames[stream], _layouts[stream])) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
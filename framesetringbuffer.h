@@ -0,0 +1,117 @@
+#ifndef FRAMESETRINGBUFFER_H
+#define FRAMESETRINGBUFFER_H
+
+#include <QMutex>
+#include <QVector>
+
+#include "./imageframe.h"
+
+/*!
+ * \brief The FrameSetRingBuffer class keep a copy of the last framesets received.
+ *
+ * It is used to capture the frames received just before a save is triggered.
+ * Each slot holds a buffer for each stream, allocated by preallocate once the size of the frames is known,
+ * and reused when the ring wraps around, so no allocation happens on the capture path in steady state.
+ * Slots whose buffers are missing (e.g. before preallocate completed) allocate them when they are filled.
+ */
+class FrameSetRingBuffer
+{
+public:
+
+	static const int nStreams = 4;
+
+	struct FrameSet {
+
+		FrameSet() :
+			frameSetId(0),
+			present{false, false, false, false},
+			timeMs(0)
+		{
+
+		}
+
+		/*!
+		 * \brief frame give the frame of a stream (left, right, rgb, depth), or an invalid frame if the frameset has none.
+		 */
+		inline ImageFrame frame(int stream) const {
+			return (present[stream]) ? frames[stream] : ImageFrame();
+		}
+
+		qint64 frameSetId;
+		ImageFrame frames[nStreams]; //!< the buffers of the slot, only the ones flagged in present hold a frame of the frameset.
+		bool present[nStreams];
+		qint64 timeMs;
+	};
+
+	using FrameSets = QVector<FrameSet>;
+
+	explicit FrameSetRingBuffer(int capacity = 0);
+
+	int capacity() const;
+	/*!
+	 * \brief setCapacity resize and empty the ring, the buffers have to be preallocated again.
+	 */
+	void setCapacity(int capacity);
+
+	int size() const;
+
+	/*!
+	 * \brief push copy a frameset in the ring, overwriting the oldest one if the ring is full.
+	 */
+	void push(qint64 frameSetId, ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB, ImageFrame const& frameDepth, qint64 timeMs);
+
+	/*!
+	 * \brief take move the framesets out of the ring, from oldest to newest, and empty the ring.
+	 *
+	 * Only the frame handles are moved, so the ring is locked for a short time whatever the size of the frames.
+	 * The framesets should be given back with recycle once they are not used anymore, so that their buffers are reused.
+	 */
+	FrameSets take();
+	/*!
+	 * \brief recycle give back the buffers of framesets returned by take, they are used for the empty slots.
+	 */
+	void recycle(FrameSets && frameSets);
+
+	/*!
+	 * \brief buffersReady indicate if all the slots have their buffers, for the size of the last frames pushed.
+	 */
+	bool buffersReady() const;
+	/*!
+	 * \brief preallocate allocate the missing buffers of the slots, for the size of the last frames pushed.
+	 *
+	 * The buffers are allocated without holding the lock of the ring, so that it can be called from a background thread
+	 * while the ring is being filled. It does nothing before the first push.
+	 */
+	void preallocate();
+
+	void clear();
+
+protected:
+
+	struct Layout {
+		ImageFrame::ImgType type;
+		int height;
+		int width;
+		int channels;
+	};
+
+	static bool matchLayout(ImageFrame const& frame, Layout const& layout);
+	static void copyFrame(ImageFrame & slot, ImageFrame const& frame);
+
+	/*!
+	 * \brief isFreeBuffer indicate if the buffer of a stream in a slot holds no frame of a buffered frameset.
+	 */
+	bool isFreeBuffer(int slot, int stream) const;
+	bool allSlotsHaveBuffers() const;
+
+	mutable QMutex _mutex;
+
+	QVector<FrameSet> _slots;
+	int _head;
+	int _size;
+
+	Layout _layouts[nStreams]; //!< the size of the frames of each stream, INVALID if the stream has not been seen yet.
+	bool _buffersReady;
+};
+
+#endif // FRAMESETRINGBUFFER_H
@@ -0,0 +1,234 @@
+#include "frameverifier.h"
+
+#include "imageframe.h"
+#include "framechecksum.h"
+#include "sessioncatalog.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QThread>
+#include <QMutex>
+#include <QElapsedTimer>
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const qint64 readChunkBytes = 4*1024*1024;
+
+FrameVerifier::Result verifyRawFrame(QFile & file, qint64 & bytes) {
+
+	thread_local std::vector<uint8_t> buffer;
+	buffer.resize(readChunkBytes);
+
+	if (file.read(reinterpret_cast<char*>(buffer.data()), ImageFrame::rawHeaderBytes) != static_cast<qint64>(ImageFrame::rawHeaderBytes)) {
+		return FrameVerifier::Corrupted;
+	}
+
+	bytes += ImageFrame::rawHeaderBytes;
+
+	ImageFrame::RawLayout layout;
+
+	if (!ImageFrame::readRawLayout(buffer.data(), layout)) {
+		return FrameVerifier::Corrupted;
+	}
+
+	if (static_cast<quint64>(file.size()) < ImageFrame::rawHeaderBytes + layout.payloadBytes) {
+		return FrameVerifier::Corrupted;
+	}
+
+	if (!layout.hasChecksum) {
+		return FrameVerifier::Unchecked;
+	}
+
+	uint32_t crc = layout.headerCrc32c;
+	quint64 remaining = layout.payloadBytes;
+
+	while (remaining > 0) {
+
+		qint64 read = file.read(reinterpret_cast<char*>(buffer.data()), std::min<quint64>(remaining, readChunkBytes));
+
+		if (read <= 0) {
+			return FrameVerifier::Corrupted;
+		}
+
+		crc = FrameChecksum::crc32c(buffer.data(), read, crc);
+		remaining -= read;
+		bytes += read;
+	}
+
+	return (crc == layout.crc32c) ? FrameVerifier::Intact : FrameVerifier::Corrupted;
+}
+
+} // namespace
+
+FrameVerifier::Config FrameVerifier::Config::fromSettings() {
+
+	Config config;
+
+	QSettings settings;
+	config.threads = std::max(0, settings.value("io/verifythreads", config.threads).toInt());
+
+	settings.setValue("io/verifythreads", config.threads);
+
+	return config;
+}
+
+FrameVerifier::FrameVerifier(Config const& config) :
+	_config(config)
+{
+
+}
+
+FrameVerifier::Result FrameVerifier::verifyFrame(QString const& framePath, QString const& expectedCrc32c, qint64 & bytes) {
+
+	if (framePath.endsWith(ImageFrame::rawFrameExtension)) {
+
+		QFile file(framePath);
+
+		if (!file.exists()) {
+			return Missing;
+		}
+
+		if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+			return Corrupted;
+		}
+
+		posix_fadvise(file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+		Result result = verifyRawFrame(file, bytes);
+
+		// verifying a whole session does not evict the pages of the running recording.
+		posix_fadvise(file.handle(), 0, 0, POSIX_FADV_DONTNEED);
+
+		return result;
+	}
+
+	QFileInfo info(framePath);
+
+	if (!info.exists()) {
+		return Missing;
+	}
+
+	// the frames recorded without catalog keep their checksum with their infos.
+	QString crc32c = (expectedCrc32c.isEmpty()) ? ImageFrame::loadInfos(framePath).value(SessionCatalog::crc32cKey) : expectedCrc32c;
+
+	if (crc32c.isEmpty()) {
+		return Unchecked;
+	}
+
+	bool ok;
+	uint32_t expected = crc32c.toUInt(&ok, 16);
+
+	if (!ok) {
+		return Unchecked;
+	}
+
+	ImageFrame frame(framePath);
+	bytes += info.size();
+
+	if (!frame.isValid()) {
+		return Corrupted;
+	}
+
+	return (frame.payloadCrc32c() == expected) ? Intact : Corrupted;
+}
+
+bool FrameVerifier::verifySession(QString const& catalogPath, Report & report) const {
+
+	SessionCatalog::Index index;
+
+	if (!index.load(catalogPath)) {
+		return false;
+	}
+
+	QVector<Item> items;
+	items.reserve(index.size());
+
+	for (SessionCatalog::Entry const& entry : index.entries()) {
+		items.push_back({index.framePath(entry), entry.metadata.value(SessionCatalog::crc32cKey)});
+	}
+
+	report = verify(items);
+	return true;
+}
+
+FrameVerifier::Report FrameVerifier::verifyFolder(QDir const& folder) const {
+
+	QVector<Item> items;
+
+	for (QString const& file : folder.entryList({"*.stevimg", "*" + ImageFrame::rawFrameExtension}, QDir::Files, QDir::Name)) {
+		items.push_back({folder.filePath(file), QString()});
+	}
+
+	return verify(items);
+}
+
+FrameVerifier::Report FrameVerifier::verify(QVector<Item> const& items) const {
+
+	QElapsedTimer timer;
+	timer.start();
+
+	int nWorkers = (_config.threads > 0) ? _config.threads : QThread::idealThreadCount();
+	nWorkers = std::max(1, std::min(nWorkers, items.size()));
+
+	Report report;
+	QMutex reportMutex;
+	std::atomic<int> next(0);
+
+	// several reads in flight keep the disk queue full, whatever the file sizes.
+	auto worker = [&items, &report, &reportMutex, &next] () {
+
+		Report local;
+
+		for (int i = next++; i < items.size(); i = next++) {
+
+			switch (verifyFrame(items[i].framePath, items[i].expectedCrc32c, local.bytes)) {
+			case Intact:
+				local.intact++;
+				break;
+			case Corrupted:
+				local.corrupted++;
+				local.corruptedFiles << items[i].framePath;
+				break;
+			case Unchecked:
+				local.unchecked++;
+				break;
+			case Missing:
+				local.missing++;
+				break;
+			}
+		}
+
+		QMutexLocker locker(&reportMutex);
+		report.intact += local.intact;
+		report.corrupted += local.corrupted;
+		report.unchecked += local.unchecked;
+		report.missing += local.missing;
+		report.bytes += local.bytes;
+		report.corruptedFiles << local.corruptedFiles;
+	};
+
+	std::vector<std::thread> workers;
+
+	for (int i = 1; i < nWorkers; i++) {
+		workers.emplace_back(worker);
+	}
+
+	worker();
+
+	for (std::thread & thread : workers) {
+		thread.join();
+	}
+
+	report.corruptedFiles.sort();
+	report.elapsedMs = timer.elapsed();
+
+	return report;
+}
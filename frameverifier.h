@@ -0,0 +1,97 @@
+#ifndef FRAMEVERIFIER_H
+#define FRAMEVERIFIER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QDir>
+
+/*!
+ * \brief The FrameVerifier class check the recorded frames against their checksums, e.g. after a copy between hosts.
+ *
+ * Raw frames are checked against the checksum of their header, streamed from the file in large reads, the other
+ * formats are decoded and checked against the checksum stored in the session catalog, or with the frame infos when
+ * the session has been recorded without catalog.
+ * The frames are checked by a pool of worker threads, so that the verification runs at the speed of the disk.
+ */
+class FrameVerifier
+{
+public:
+
+	struct Config {
+
+		Config() :
+			threads(0)
+		{
+
+		}
+
+		/*!
+		 * \brief fromSettings load the configuration from the application settings (and write back the defaults).
+		 */
+		static Config fromSettings();
+
+		int threads; //!< the number of workers, 0 for one per core.
+	};
+
+	enum Result {
+		Intact,
+		Corrupted, //!< the checksum does not match, or the file is truncated or unreadable.
+		Unchecked, //!< the frame has no checksum (written by an older version).
+		Missing //!< the frame file does not exist anymore, e.g. because it has been exported.
+	};
+
+	struct Report {
+
+		Report() :
+			intact(0),
+			corrupted(0),
+			unchecked(0),
+			missing(0),
+			bytes(0),
+			elapsedMs(0)
+		{
+
+		}
+
+		qint64 intact;
+		qint64 corrupted;
+		qint64 unchecked;
+		qint64 missing;
+		qint64 bytes; //!< the number of bytes read.
+		qint64 elapsedMs;
+		QStringList corruptedFiles;
+	};
+
+	explicit FrameVerifier(Config const& config = Config());
+
+	/*!
+	 * \brief verifyFrame check a single frame.
+	 * \param expectedCrc32c the checksum from the catalog, as hexadecimal, empty to use the one of the frame infos (ignored for raw frames).
+	 * \param bytes incremented by the number of bytes read.
+	 */
+	static Result verifyFrame(QString const& framePath, QString const& expectedCrc32c, qint64 & bytes);
+
+	/*!
+	 * \brief verifySession check all the frames of the catalog of a session.
+	 * \return false if the catalog could not be read.
+	 */
+	bool verifySession(QString const& catalogPath, Report & report) const;
+	/*!
+	 * \brief verifyFolder check the frames of a folder recorded without catalog.
+	 */
+	Report verifyFolder(QDir const& folder) const;
+
+protected:
+
+	struct Item {
+		QString framePath;
+		QString expectedCrc32c;
+	};
+
+	Report verify(QVector<Item> const& items) const;
+
+	Config _config;
+};
+
+#endif // FRAMEVERIFIER_H
@@ -0,0 +1,433 @@
+#include "framewriter.h"
+
+#include "threadtuning.h"
+#include "framememory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/uio.h>
+
+#include <QTextStream>
+#include <QDebug>
+
+#ifdef RSNIR_HAS_LIBURING
+#include <liburing.h>
+#endif
+
+const size_t FrameWriter::directIoAlignment = 4096;
+
+static size_t alignedSize(size_t size, size_t alignment) {
+	return ((size + alignment - 1)/alignment)*alignment;
+}
+
+FrameWriter::FrameWriter(QObject *parent) :
+	QThread(parent),
+	_backend(PWrite),
+	_directIo(false),
+	_bufferSize(0),
+	_inFlight(0),
+	_ring(nullptr),
+	_continue(true)
+{
+
+}
+
+FrameWriter::~FrameWriter() {
+
+	deinitIoUring();
+}
+
+bool FrameWriter::configure(Backend backend, bool directIo, int nBuffers, size_t bufferSize) {
+
+	if (isRunning() or nBuffers <= 0 or bufferSize == 0) {
+		return false;
+	}
+
+	// the ring of a previous configuration has the previous buffers registered, it is torn down before they are released.
+	deinitIoUring();
+
+	_directIo = directIo;
+	_bufferSize = alignedSize(bufferSize, directIoAlignment);
+
+	_slots.clear();
+	_freeSlots.clear();
+
+	_buffers = FrameMemory::allocate(nBuffers*_bufferSize, buffersNode());
+
+	if (_buffers == nullptr) {
+		return false;
+	}
+
+	_slots.resize(nBuffers);
+	_freeSlots.reserve(nBuffers);
+
+	for (int i = 0; i < nBuffers; i++) {
+		_slots[i] = {_buffers.get() + i*_bufferSize, 0, 0, QString(), -1};
+		_freeSlots.push_back(i);
+	}
+
+	_backend = backend;
+
+	if (_backend == IoUring and !initIoUring()) {
+		QTextStream err(stderr);
+		err << "Could not initialize io_uring, frames will be written with pwrite" << endl;
+		_backend = PWrite;
+	}
+
+	return true;
+}
+
+int FrameWriter::buffersNode() const {
+
+	// the buffers are filled by the grabber thread and read by the writer thread, prefer the node of the pinned thread if any.
+	for (ThreadTuning::Role role : {ThreadTuning::Writer, ThreadTuning::Grabber}) {
+
+		ThreadTuning::Config config = ThreadTuning::load(role);
+
+		if (!config.cpus.isEmpty()) {
+			int node = FrameMemory::nodeOfCpu(config.cpus.first());
+
+			if (node >= 0) {
+				return node;
+			}
+		}
+	}
+
+	return FrameMemory::CurrentNode;
+}
+
+FrameWriter::Backend FrameWriter::backend() const {
+	return _backend;
+}
+bool FrameWriter::directIo() const {
+	return _directIo;
+}
+
+void FrameWriter::setCompletionCallback(CompletionCallback const& callback) {
+	_completionCallback = callback;
+}
+
+bool FrameWriter::enqueue(ImageFrame const& frame, QString const& filePath, ImageFrame::RawEncoding encoding) {
+
+	size_t maxBytes = frame.maxRawBytes(encoding);
+
+	if (maxBytes == 0 or maxBytes > _bufferSize) {
+		return false;
+	}
+
+	_queueMutex.lock();
+	while (_freeSlots.isEmpty()) {
+		_slotAvailable.wait(&_queueMutex);
+	}
+	int slotId = _freeSlots.takeLast();
+	_inFlight++;
+	_queueMutex.unlock();
+
+	Slot & slot = _slots[slotId];
+
+	size_t dataBytes = frame.writeRaw(slot.data, _bufferSize, encoding);
+
+	if (dataBytes == 0) {
+		_queueMutex.lock();
+		_freeSlots.push_back(slotId);
+		_inFlight--;
+		_slotAvailable.wakeOne();
+		if (_inFlight == 0) {
+			_allDone.wakeAll();
+		}
+		_queueMutex.unlock();
+		return false;
+	}
+
+	slot.dataBytes = dataBytes;
+	slot.writeBytes = (_directIo) ? alignedSize(dataBytes, directIoAlignment) : dataBytes;
+	slot.filePath = filePath;
+	slot.fd = -1;
+
+	if (slot.writeBytes > slot.dataBytes) {
+		memset(slot.data + slot.dataBytes, 0, slot.writeBytes - slot.dataBytes);
+	}
+
+	_queueMutex.lock();
+	_pendingSlots.enqueue(slotId);
+	_workAvailable.wakeOne();
+	_queueMutex.unlock();
+
+	return true;
+}
+
+void FrameWriter::flush() {
+
+	_queueMutex.lock();
+	while (_inFlight > 0) {
+		_allDone.wait(&_queueMutex);
+	}
+	_queueMutex.unlock();
+}
+
+void FrameWriter::run() {
+
+	ThreadTuning::applyToCurrentThread(ThreadTuning::Writer);
+
+	if (_backend == IoUring) {
+		runIoUring();
+	} else {
+		runPWrite();
+	}
+}
+
+void FrameWriter::finish() {
+	_queueMutex.lock();
+	_continue = false;
+	_workAvailable.wakeAll();
+	_queueMutex.unlock();
+}
+
+int FrameWriter::openSlotFile(Slot & slot) {
+
+	QByteArray path = slot.filePath.toLocal8Bit();
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	if (_directIo) {
+		slot.fd = open(path.constData(), flags | O_DIRECT, 0644);
+
+		if (slot.fd >= 0 or errno != EINVAL) {
+			return slot.fd;
+		}
+		// the filesystem does not support O_DIRECT, the padded buffer is still fine to write.
+	}
+
+	slot.fd = open(path.constData(), flags, 0644);
+	return slot.fd;
+}
+
+bool FrameWriter::writeSlotData(Slot & slot, size_t offset) {
+
+	while (offset < slot.writeBytes) {
+
+		if (_directIo and offset % directIoAlignment != 0 and !disableDirectIo(slot)) {
+			return false;
+		}
+
+		ssize_t n = pwrite(slot.fd, slot.data + offset, slot.writeBytes - offset, offset);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		offset += n;
+	}
+
+	return true;
+}
+
+bool FrameWriter::disableDirectIo(Slot & slot) {
+
+	// after a short write, the remainder is not aligned for O_DIRECT anymore, it goes through the page cache.
+	int flags = fcntl(slot.fd, F_GETFL);
+
+	if (flags < 0) {
+		return false;
+	}
+
+	return !(flags & O_DIRECT) or fcntl(slot.fd, F_SETFL, flags & ~O_DIRECT) == 0;
+}
+
+void FrameWriter::completeSlot(int slotId, bool ok) {
+
+	Slot & slot = _slots[slotId];
+
+	if (slot.fd >= 0) {
+		if (ok and slot.writeBytes != slot.dataBytes) {
+			ok = ftruncate(slot.fd, slot.dataBytes) == 0;
+		}
+		close(slot.fd);
+		slot.fd = -1;
+	}
+
+	if (_completionCallback) {
+		_completionCallback(slot.filePath, ok, (ok) ? slot.dataBytes : 0);
+	}
+
+	_queueMutex.lock();
+	_freeSlots.push_back(slotId);
+	_inFlight--;
+	_slotAvailable.wakeOne();
+	if (_inFlight == 0) {
+		_allDone.wakeAll();
+	}
+	_queueMutex.unlock();
+}
+
+void FrameWriter::runPWrite() {
+
+	while (true) {
+
+		_queueMutex.lock();
+		while (_pendingSlots.isEmpty() and _continue) {
+			_workAvailable.wait(&_queueMutex);
+		}
+
+		if (_pendingSlots.isEmpty()) {
+			_queueMutex.unlock();
+			break;
+		}
+
+		QQueue<int> batch;
+		std::swap(batch, _pendingSlots);
+		_queueMutex.unlock();
+
+		for (int slotId : batch) {
+			Slot & slot = _slots[slotId];
+
+			bool ok = openSlotFile(slot) >= 0;
+
+			if (ok) {
+				ok = writeSlotData(slot, 0);
+			}
+
+			completeSlot(slotId, ok);
+		}
+	}
+}
+
+#ifdef RSNIR_HAS_LIBURING
+
+bool FrameWriter::initIoUring() {
+
+	unsigned int queueDepth = 1;
+	while (queueDepth < _slots.size()) {
+		queueDepth *= 2;
+	}
+
+	_ring = new io_uring;
+
+	if (io_uring_queue_init(queueDepth, _ring, 0) < 0) {
+		delete _ring;
+		_ring = nullptr;
+		return false;
+	}
+
+	std::vector<iovec> iovecs(_slots.size());
+
+	for (size_t i = 0; i < _slots.size(); i++) {
+		iovecs[i].iov_base = _slots[i].data;
+		iovecs[i].iov_len = _bufferSize;
+	}
+
+	if (io_uring_register_buffers(_ring, iovecs.data(), iovecs.size()) < 0) {
+		// usually RLIMIT_MEMLOCK is too low to pin the buffers.
+		io_uring_queue_exit(_ring);
+		delete _ring;
+		_ring = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+void FrameWriter::deinitIoUring() {
+
+	if (_ring != nullptr) {
+		io_uring_unregister_buffers(_ring);
+		io_uring_queue_exit(_ring);
+		delete _ring;
+		_ring = nullptr;
+	}
+}
+
+void FrameWriter::runIoUring() {
+
+	int inRing = 0;
+
+	while (true) {
+
+		_queueMutex.lock();
+		while (_pendingSlots.isEmpty() and _continue and inRing == 0) {
+			_workAvailable.wait(&_queueMutex);
+		}
+
+		if (_pendingSlots.isEmpty() and !_continue and inRing == 0) {
+			_queueMutex.unlock();
+			break;
+		}
+
+		QQueue<int> batch;
+		std::swap(batch, _pendingSlots);
+		_queueMutex.unlock();
+
+		int queued = 0;
+
+		for (int slotId : batch) {
+			Slot & slot = _slots[slotId];
+
+			if (openSlotFile(slot) < 0) {
+				completeSlot(slotId, false);
+				continue;
+			}
+
+			// the ring is at least as deep as the number of slots, so a sqe is always available.
+			io_uring_sqe* sqe = io_uring_get_sqe(_ring);
+			io_uring_prep_write_fixed(sqe, slot.fd, slot.data, slot.writeBytes, 0, slotId);
+			io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<intptr_t>(slotId)));
+			queued++;
+		}
+
+		if (queued > 0) {
+			io_uring_submit(_ring);
+			inRing += queued;
+		}
+
+		if (inRing == 0) {
+			continue;
+		}
+
+		io_uring_cqe* cqe;
+
+		if (batch.isEmpty()) {
+			// nothing new to submit, wait for a completion, but not for too long so that new frames are not delayed.
+			__kernel_timespec timeout = {0, 1000000};
+			io_uring_wait_cqe_timeout(_ring, &cqe, &timeout);
+		}
+
+		while (io_uring_peek_cqe(_ring, &cqe) == 0) {
+
+			int slotId = static_cast<int>(reinterpret_cast<intptr_t>(io_uring_cqe_get_data(cqe)));
+			int res = cqe->res;
+			io_uring_cqe_seen(_ring, cqe);
+			inRing--;
+
+			Slot & slot = _slots[slotId];
+			bool ok = res >= 0;
+
+			if (ok and static_cast<size_t>(res) < slot.writeBytes) {
+				ok = writeSlotData(slot, res);
+			}
+
+			completeSlot(slotId, ok);
+		}
+	}
+}
+
+#else
+
+bool FrameWriter::initIoUring() {
+	return false;
+}
+
+void FrameWriter::deinitIoUring() {
+
+}
+
+void FrameWriter::runIoUring() {
+	runPWrite();
+}
+
+#endif
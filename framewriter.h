@@ -0,0 +1,128 @@
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QQueue>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "./imageframe.h"
+
+struct io_uring;
+
+/*!
+ * \brief The FrameWriter class write frames to disk from a dedicated thread.
+ *
+ * Frames are serialized, in the raw frame format, by the calling thread into a pool of pre-allocated,
+ * page aligned, buffers. The writer thread then submit the pending buffers in batches, either with
+ * io_uring (using registered buffers) or, if io_uring is not available, with plain pwrite calls.
+ *
+ * When all the buffers are in flight, enqueue blocks until a write completes.
+ */
+class FrameWriter : public QThread
+{
+	Q_OBJECT
+public:
+
+	enum Backend {
+		PWrite,
+		IoUring
+	};
+
+	/*!
+	 * \brief CompletionCallback is called from the writer thread each time a file has been written (or failed to be).
+	 */
+	using CompletionCallback = std::function<void(QString const& filePath, bool ok, qint64 bytes)>;
+
+	static const size_t directIoAlignment;
+
+	explicit FrameWriter(QObject *parent = nullptr);
+	~FrameWriter();
+
+	/*!
+	 * \brief configure set up the writer, must be called before the thread is started.
+	 * \param backend the preferred backend, io_uring fall back to pwrite if it cannot be initialized.
+	 * \param directIo if true, the files are opened with O_DIRECT.
+	 * \param nBuffers the number of buffers in the pool, i.e. the maximal number of writes in flight.
+	 * \param bufferSize the size of each buffer, in bytes.
+	 * \return true on success.
+	 */
+	bool configure(Backend backend, bool directIo, int nBuffers, size_t bufferSize);
+
+	Backend backend() const;
+	bool directIo() const;
+
+	void setCompletionCallback(CompletionCallback const& callback);
+
+	/*!
+	 * \brief enqueue copy a frame in a free buffer and schedule it to be written.
+	 * \param frame the frame to write.
+	 * \param filePath the path of the file to write.
+	 * \param encoding the encoding of the pixels, the encoding is done by the calling thread.
+	 * \return false if the frame could not be scheduled (e.g. it is too large for the buffers), true otherwise.
+	 */
+	bool enqueue(ImageFrame const& frame, QString const& filePath, ImageFrame::RawEncoding encoding = ImageFrame::RawPlain);
+
+	/*!
+	 * \brief flush block until all the scheduled frames have been written.
+	 */
+	void flush();
+
+	virtual void run();
+	void finish();
+
+protected:
+
+	struct Slot {
+		uint8_t* data;
+		size_t dataBytes;
+		size_t writeBytes;
+		QString filePath;
+		int fd;
+	};
+
+	int buffersNode() const;
+
+	int openSlotFile(Slot & slot);
+	/*!
+	 * \brief writeSlotData write the data of a slot from offset, with pwrite, until it is complete.
+	 */
+	bool writeSlotData(Slot & slot, size_t offset);
+	bool disableDirectIo(Slot & slot);
+	void completeSlot(int slotId, bool ok);
+
+	void runPWrite();
+	void runIoUring();
+
+	bool initIoUring();
+	void deinitIoUring();
+
+	Backend _backend;
+	bool _directIo;
+	size_t _bufferSize;
+
+	std::shared_ptr<uint8_t> _buffers; //!< the memory of all the slots, in one block.
+	std::vector<Slot> _slots;
+
+	QMutex _queueMutex;
+	QWaitCondition _slotAvailable;
+	QWaitCondition _workAvailable;
+	QWaitCondition _allDone;
+
+	QVector<int> _freeSlots;
+	QQueue<int> _pendingSlots;
+	int _inFlight;
+
+	CompletionCallback _completionCallback;
+
+	io_uring* _ring;
+
+	bool _continue;
+};
+
+#endif // FRAMEWRITER_H
@@ -1,191 +1,727 @@
 #include "imageframe.h"
 
+#include "frameinfostable.h"
+#include "framememory.h"
+#include "depthcompression.h"
+#include "framechecksum.h"
+
 #include "LibStevi/io/image_io.h"
 
 #include <QFile>
 #include <QTextStream>
 #include <QDebug>
 
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <utility>
+
 
 const QString ImageFrame::colorSpaceKey = "colorspace";
+const QString ImageFrame::depthScaleKey = "depthscale";
+const QString ImageFrame::rawFrameExtension = ".rawframe";
+const size_t ImageFrame::rawHeaderBytes = 4096;
+
+namespace {
+
+const char rawFrameMagic[8] = {'R','S','N','I','R','R','A','W'};
+const uint32_t rawFrameVersion = 2; //!< version 2 added the checksum, version 1 files are still read.
+const uint32_t rawFrameFirstChecksummedVersion = 2;
+
+struct RawFrameHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t imgType;
+	uint32_t height;
+	uint32_t width;
+	uint32_t channels;
+	uint32_t elementBytes;
+	uint64_t payloadBytes; //!< the number of bytes of pixels data following the header, after encoding.
+	uint32_t encoding; //!< zero (RawPlain) in the files written before the encodings were introduced.
+	uint32_t checksum; //!< rawChecksumCrc32c, only meaningful from version 2, it was uninitialized padding before.
+	uint32_t crc32c; //!< the checksum of the header fields before it, followed by the payload.
+};
+
+const uint32_t rawChecksumCrc32c = 1;
+
+// the limits of the raw frame headers which are accepted, so that a corrupted header cannot trigger a huge allocation.
+const uint32_t rawMaxDimension = 1 << 15;
+const uint32_t rawMaxChannels = 64;
+const uint64_t rawMaxElements = uint64_t(1) << 28;
+const size_t rawChecksummedHeaderBytes = offsetof(RawFrameHeader, crc32c);
+
+inline bool supportsEncoding(ImageFrame::ImgType type, ImageFrame::RawEncoding encoding) {
+	return encoding == ImageFrame::RawPlain or (encoding == ImageFrame::RawRvl and type == ImageFrame::GRAY_16);
+}
+
+template<typename T>
+size_t packPixels(Multidim::Array<T, 2>* img, uint8_t* out) {
+
+	const int h = img->shape()[0];
+	const int w = img->shape()[1];
+
+	T* dst = reinterpret_cast<T*>(out);
+
+	for (int i = 0; i < h; i++) {
+		if (img->strides()[1] == 1) {
+			std::memcpy(dst + i*w, &img->atUnchecked(i,0), w*sizeof (T));
+		} else {
+			for (int j = 0; j < w; j++) {
+				dst[i*w + j] = img->atUnchecked(i,j);
+			}
+		}
+	}
+
+	return h*w*sizeof (T);
+}
+
+template<typename T>
+size_t packPixels(Multidim::Array<T, 3>* img, uint8_t* out) {
+
+	const int h = img->shape()[0];
+	const int w = img->shape()[1];
+	const int c = img->shape()[2];
+
+	T* dst = reinterpret_cast<T*>(out);
+
+	for (int i = 0; i < h; i++) {
+		if (img->strides()[2] == 1 and img->strides()[1] == c) {
+			std::memcpy(dst + i*w*c, &img->atUnchecked(i,0,0), w*c*sizeof (T));
+		} else {
+			for (int j = 0; j < w; j++) {
+				for (int k = 0; k < c; k++) {
+					dst[(i*w + j)*c + k] = img->atUnchecked(i,j,k);
+				}
+			}
+		}
+	}
+
+	return h*w*c*sizeof (T);
+}
+
+template<typename T>
+bool unpackPixels(QFile & file, Multidim::Array<T, 2>* img) {
+
+	qint64 nBytes = img->shape()[0]*img->shape()[1]*sizeof (T);
+	return file.read(reinterpret_cast<char*>(&img->atUnchecked(0,0)), nBytes) == nBytes;
+}
+
+template<typename T>
+bool unpackPixels(QFile & file, Multidim::Array<T, 3>* img) {
+
+	qint64 nBytes = img->shape()[0]*img->shape()[1]*img->shape()[2]*sizeof (T);
+	return file.read(reinterpret_cast<char*>(&img->atUnchecked(0,0,0)), nBytes) == nBytes;
+}
+
+int64_t encodeRvlPixels(Multidim::Array<uint16_t, 2>* img, uint8_t* out, size_t capacity) {
+
+	const int h = img->shape()[0];
+	const int w = img->shape()[1];
+
+	if (img->strides()[1] == 1 and img->strides()[0] == w) {
+		return DepthCompression::rvlEncode(&img->atUnchecked(0,0), h*w, out, capacity);
+	}
+
+	thread_local std::vector<uint16_t> packed;
+	packed.resize(h*w);
+	packPixels(img, reinterpret_cast<uint8_t*>(packed.data()));
+
+	return DepthCompression::rvlEncode(packed.data(), packed.size(), out, capacity);
+}
+
+template<typename T>
+uint32_t pixelsCrc32c(Multidim::Array<T, 2>* img) {
+
+	const int h = img->shape()[0];
+	const int w = img->shape()[1];
+
+	thread_local std::vector<T> row;
+	uint32_t crc = 0;
+
+	for (int i = 0; i < h; i++) {
+		if (img->strides()[1] == 1) {
+			crc = FrameChecksum::crc32c(&img->atUnchecked(i,0), w*sizeof (T), crc);
+		} else {
+			row.resize(w);
+			for (int j = 0; j < w; j++) {
+				row[j] = img->atUnchecked(i,j);
+			}
+			crc = FrameChecksum::crc32c(row.data(), w*sizeof (T), crc);
+		}
+	}
+
+	return crc;
+}
+
+template<typename T>
+uint32_t pixelsCrc32c(Multidim::Array<T, 3>* img) {
+
+	const int h = img->shape()[0];
+	const int w = img->shape()[1];
+	const int c = img->shape()[2];
+
+	thread_local std::vector<T> row;
+	uint32_t crc = 0;
+
+	for (int i = 0; i < h; i++) {
+		if (img->strides()[2] == 1 and img->strides()[1] == c) {
+			crc = FrameChecksum::crc32c(&img->atUnchecked(i,0,0), w*c*sizeof (T), crc);
+		} else {
+			row.resize(w*c);
+			for (int j = 0; j < w; j++) {
+				for (int k = 0; k < c; k++) {
+					row[j*c + k] = img->atUnchecked(i,j,k);
+				}
+			}
+			crc = FrameChecksum::crc32c(row.data(), w*c*sizeof (T), crc);
+		}
+	}
+
+	return crc;
+}
+
+bool decodeRvlPixels(QFile & file, qint64 encodedBytes, Multidim::Array<uint16_t, 2>* img) {
+
+	QByteArray encoded = file.read(encodedBytes);
+
+	if (encoded.size() != encodedBytes) {
+		return false;
+	}
+
+	return DepthCompression::rvlDecode(reinterpret_cast<uint8_t const*>(encoded.constData()), encoded.size(),
+									   &img->atUnchecked(0,0), img->shape()[0]*img->shape()[1]);
+}
+
+template<typename Format>
+typename Format::Array::ShapeBlock contiguousShape(int h, int w, int c) {
+	if constexpr (Format::dims == 2) {
+		return {h, w};
+	} else {
+		return {h, w, c};
+	}
+}
+
+template<typename Format>
+typename Format::Array::ShapeBlock contiguousStrides(int w, int c) {
+	if constexpr (Format::dims == 2) {
+		return {w, 1};
+	} else {
+		return {w*c, c, 1};
+	}
+}
+
+/*!
+ * \brief The BufferPixels struct hold an array viewing a separately allocated buffer, and the buffer, behind a single handle.
+ */
+template<typename Format>
+struct BufferPixels {
+
+	BufferPixels(std::shared_ptr<uint8_t> const& pixelsBuffer, int h, int w, int c) :
+		buffer(pixelsBuffer),
+		array(reinterpret_cast<typename Format::Element*>(pixelsBuffer.get()), contiguousShape<Format>(h, w, c), contiguousStrides<Format>(w, c), false)
+	{
+
+	}
+
+	std::shared_ptr<uint8_t> buffer;
+	typename Format::Array array;
+};
+
+template<typename T>
+uint8_t* firstPixel(Multidim::Array<T, 2>* img) {
+	return reinterpret_cast<uint8_t*>(&img->atUnchecked(0,0));
+}
+
+template<typename T>
+uint8_t* firstPixel(Multidim::Array<T, 3>* img) {
+	return reinterpret_cast<uint8_t*>(&img->atUnchecked(0,0,0));
+}
+
+template<typename T>
+auto fullView(Multidim::Array<T, 2>* img) {
+	return img->subView(Multidim::DimSlice(), Multidim::DimSlice());
+}
+
+template<typename T>
+auto fullView(Multidim::Array<T, 3>* img) {
+	return img->subView(Multidim::DimSlice(), Multidim::DimSlice(), Multidim::DimSlice());
+}
+
+} // namespace
+
+template<ImageFrame::ImgType type>
+void ImageFrame::setPixels(std::shared_ptr<typename PixelFormat<type>::Array> const& pixels) {
+
+	_type = type;
+	_height = pixels->shape()[0];
+	_width = pixels->shape()[1];
+
+	if constexpr (PixelFormat<type>::dims == 3) {
+		_channels = pixels->shape()[2];
+	} else {
+		_channels = 1;
+	}
+
+	_pixels = pixels;
+}
 
 ImageFrame::ImageFrame() :
 	_type(INVALID),
-	_grayscale8(),
-	_grayscale16(),
-	_grayscalef32(),
-	_rgba8()
+	_height(0),
+	_width(0),
+	_channels(0),
+	_pixels()
 {
 
 }
 ImageFrame::ImageFrame(uint8_t *data, Multidim::Array<uint8_t, 2>::ShapeBlock shape, Multidim::Array<uint8_t, 2>::ShapeBlock stride, bool copy) :
-	_type(GRAY_8),
-	_grayscale8(),
-	_grayscale16(),
-	_grayscalef32(),
-	_rgba8()
+	ImageFrame()
 {
-	_grayscale8 = std::make_shared<Multidim::Array<uint8_t, 2>>(data, shape, stride, copy);
+	setPixels<GRAY_8>(std::make_shared<Multidim::Array<uint8_t, 2>>(data, shape, stride, copy));
 }
 ImageFrame::ImageFrame(uint16_t* data, Multidim::Array<uint16_t, 2>::ShapeBlock shape, Multidim::Array<uint16_t, 2>::ShapeBlock stride, bool copy) :
-	_type(GRAY_16),
-	_grayscale8(),
-	_grayscale16(),
-	_grayscalef32(),
-	_rgba8()
+	ImageFrame()
 {
-	_grayscale16 = std::make_shared<Multidim::Array<uint16_t, 2>>(data, shape, stride, copy);
+	setPixels<GRAY_16>(std::make_shared<Multidim::Array<uint16_t, 2>>(data, shape, stride, copy));
 }
 ImageFrame::ImageFrame(float* data, Multidim::Array<float, 2>::ShapeBlock shape, Multidim::Array<float, 2>::ShapeBlock stride, bool copy) :
-	_type(GRAY_F32),
-	_grayscale8(),
-	_grayscale16(),
-	_grayscalef32(),
-	_rgba8()
+	ImageFrame()
 {
-	_grayscalef32 = std::make_shared<Multidim::Array<float, 2>>(data, shape, stride, copy);
+	setPixels<GRAY_F32>(std::make_shared<Multidim::Array<float, 2>>(data, shape, stride, copy));
 }
 ImageFrame::ImageFrame(uint8_t* data, Multidim::Array<uint8_t, 3>::ShapeBlock shape, Multidim::Array<uint8_t, 3>::ShapeBlock stride, bool copy) :
-	_type(MULTICHANNEL_8),
-	_grayscale8(),
-	_grayscale16(),
-	_grayscalef32(),
-	_rgba8()
+	ImageFrame()
 {
-	_rgba8 = std::make_shared<Multidim::Array<uint8_t, 3>>(data, shape, stride, copy);
+	setPixels<MULTICHANNEL_8>(std::make_shared<Multidim::Array<uint8_t, 3>>(data, shape, stride, copy));
 }
 
 ImageFrame::ImageFrame(QString const& fileName) :
-	_type(INVALID),
-	_grayscale8(),
-	_grayscale16(),
-	_grayscalef32(),
-	_rgba8()
+	ImageFrame()
 {
 
+	_additionalInfos = loadInfos(fileName);
 
-	QFile infoFile(fileName + ".infos");
+	if (fileName.endsWith(rawFrameExtension)) {
+		readRaw(fileName);
+	}
 
-	if (infoFile.exists()) {
+	if (fileName.endsWith(".stevimg")) {
 
-		if(infoFile.open(QIODevice::ReadOnly)) {
+		std::string path = fileName.toStdString();
 
-			QByteArray line = infoFile.readLine();
+		for (ImgType type : {GRAY_8, GRAY_16, GRAY_F32, MULTICHANNEL_8}) {
+			visitFormat(type, [this, &path] (auto format) {
 
-			while (!line.isEmpty()) {
+				using Format = decltype(format);
+				using T = typename Format::Element;
 
-				QString l = QString::fromLocal8Bit(line).trimmed();
-				QStringList lst = l.split(":");
+				if (isValid() or !StereoVision::IO::stevImgFileMatchTypeAndDim<T, Format::dims>(path)) {
+					return;
+				}
+
+				auto pixels = std::make_shared<typename Format::Array>();
+				*pixels = StereoVision::IO::readStevimg<T, Format::dims>(path);
 
-				if (lst.size() == 2) {
-					_additionalInfos.insert(lst[0].trimmed(), lst[1].trimmed());
+				if (!pixels->empty()) {
+					setPixels<Format::type>(pixels);
 				}
+			});
+		}
+	}
 
-				line = infoFile.readLine();
-			}
+	if (_type == INVALID and !fileName.endsWith(rawFrameExtension)) {
+		auto pixels = std::make_shared<Multidim::Array<uint8_t, 3>>();
+		*pixels = StereoVision::IO::readImage<uint8_t>(fileName.toStdString());
+		if (!pixels->empty() and pixels->shape()[2] == 3) {
+			setPixels<MULTICHANNEL_8>(pixels);
 		}
+	}
+
+}
 
+ImageFrame::ImageFrame(ImageFrame && other) :
+	_type(std::exchange(other._type, INVALID)),
+	_height(std::exchange(other._height, 0)),
+	_width(std::exchange(other._width, 0)),
+	_channels(std::exchange(other._channels, 0)),
+	_pixels(std::move(other._pixels)),
+	_additionalInfos(std::move(other._additionalInfos))
+{
+	other._pixels.reset();
+	other._additionalInfos.clear();
+}
+
+ImageFrame& ImageFrame::operator=(ImageFrame && other) {
+
+	if (this == &other) {
+		return *this;
 	}
 
-	if (fileName.endsWith(".stevimg")) {
+	_type = std::exchange(other._type, INVALID);
+	_height = std::exchange(other._height, 0);
+	_width = std::exchange(other._width, 0);
+	_channels = std::exchange(other._channels, 0);
+	_pixels = std::move(other._pixels);
+	_additionalInfos = std::move(other._additionalInfos);
 
-		if (StereoVision::IO::stevImgFileMatchTypeAndDim<uint8_t, 2>(fileName.toStdString())) {
-			Multidim::Array<uint8_t, 2> img = StereoVision::IO::readStevimg<uint8_t, 2>(fileName.toStdString());
-			if (!img.empty()) {
-				_grayscale8 = std::make_shared<Multidim::Array<uint8_t, 2>>();
-				*_grayscale8 = std::move(img);
-				_type = GRAY_8;
-			}
+	other._pixels.reset();
+	other._additionalInfos.clear();
+
+	return *this;
+}
+
+ImageFrame::~ImageFrame() {
+
+} 
+
+bool ImageFrame::save(QString const& filePath, bool withInfos, RawEncoding encoding) const {
+
+	if (withInfos) {
+		saveInfos(filePath);
+	}
+
+	if (filePath.endsWith(rawFrameExtension)) {
+
+		if (!isValid()) {
+			return false;
 		}
 
-		if (StereoVision::IO::stevImgFileMatchTypeAndDim<uint16_t, 2>(fileName.toStdString())) {
-			Multidim::Array<uint16_t, 2> img = StereoVision::IO::readStevimg<uint16_t, 2>(fileName.toStdString());
-			if (!img.empty()) {
-				_grayscale16 = std::make_shared<Multidim::Array<uint16_t, 2>>();
-				*_grayscale16 = std::move(img);
-				_type = GRAY_16;
-			}
-        }
-
-        if (StereoVision::IO::stevImgFileMatchTypeAndDim<float, 2>(fileName.toStdString())) {
-            Multidim::Array<float, 2> img = StereoVision::IO::readStevimg<float, 2>(fileName.toStdString());
-            if (!img.empty()) {
-                _grayscalef32 = std::make_shared<Multidim::Array<float, 2>>();
-                *_grayscalef32 = std::move(img);
-                _type = GRAY_F32;
-            }
-        }
-
-        if (StereoVision::IO::stevImgFileMatchTypeAndDim<uint8_t, 3>(fileName.toStdString())) {
-            Multidim::Array<uint8_t, 3> img = StereoVision::IO::readStevimg<uint8_t, 3>(fileName.toStdString());
-            if (!img.empty()) {
-                _rgba8 = std::make_shared<Multidim::Array<uint8_t, 3>>();
-                *_rgba8 = std::move(img);
-				_type = MULTICHANNEL_8;
-            }
-        }
-
-	}
-
-	if (_type == INVALID) {
-		Multidim::Array<uint8_t, 3> img = StereoVision::IO::readImage<uint8_t>(fileName.toStdString());
-		if (!img.empty() and img.shape()[2] == 3) {
-			_rgba8 = std::make_shared<Multidim::Array<uint8_t, 3>>();
-			*_rgba8 = std::move(img);
-			_type = MULTICHANNEL_8;
+		QByteArray data(maxRawBytes(encoding), '\0');
+		size_t written = writeRaw(reinterpret_cast<uint8_t*>(data.data()), data.size(), encoding);
+
+		if (written == 0) {
+			return false;
+		}
+
+		data.resize(written);
+
+		QFile rawFile(filePath);
+
+		if (!rawFile.open(QIODevice::WriteOnly)) {
+			return false;
 		}
+
+		return rawFile.write(data) == data.size();
 	}
 
+	bool ok = false;
+
+	visit([&filePath, &ok] (auto* img, auto format) {
+		using T = typename decltype(format)::Element;
+		ok = StereoVision::IO::writeImage<T, T>(filePath.toStdString(), fullView(img));
+	});
+
+	return ok;
 }
 
-ImageFrame::ImageFrame(ImageFrame const& other) :
-	_type(other._type),
-	_grayscale8(other._grayscale8),
-	_grayscale16(other._grayscale16),
-	_grayscalef32(other._grayscalef32),
-	_rgba8(other._rgba8),
-	_additionalInfos(other._additionalInfos)
-{
+ImageFrame ImageFrame::deepCopy() const {
 
+	ImageFrame ret = allocate(_type, height(), width(), channels());
+
+	if (!ret.isValid()) {
+		return ret;
+	}
+
+	visit([&ret] (auto* img, auto format) {
+		packPixels(img, firstPixel(ret.view<decltype(format)::type>()));
+	});
+
+	ret._additionalInfos = _additionalInfos;
+
+	return ret;
 }
 
+ImageFrame ImageFrame::allocate(ImgType type, int height, int width, int channels) {
 
-ImageFrame::~ImageFrame() {
+	ImageFrame ret;
 
-} 
+	visitFormat(type, [&ret, height, width, channels] (auto format) {
+
+		using Format = decltype(format);
+
+		const int c = (Format::dims == 3) ? channels : 1;
+
+		// the pixels live in a FrameMemory buffer (hugepages and NUMA placement when configured), the array only views it.
+		std::shared_ptr<uint8_t> buffer = FrameMemory::allocate(static_cast<size_t>(height)*width*c*sizeof (typename Format::Element));
+
+		if (buffer == nullptr) {
+			return;
+		}
+
+		auto pixels = std::make_shared<BufferPixels<Format>>(buffer, height, width, c);
+		ret.setPixels<Format::type>(std::shared_ptr<typename Format::Array>(pixels, &pixels->array));
+	});
+
+	return ret;
+}
+
+bool ImageFrame::copyPixelsFrom(ImageFrame const& other) {
+
+	if (_type != other._type or !isValid()) {
+		return false;
+	}
+
+	if (height() != other.height() or width() != other.width() or channels() != other.channels()) {
+		return false;
+	}
+
+	if (_pixels.use_count() != 1) {
+		return false;
+	}
+
+	visit([&other] (auto* img, auto format) {
+		packPixels(other.view<decltype(format)::type>(), firstPixel(img));
+	});
+
+	_additionalInfos = other._additionalInfos;
 
-bool ImageFrame::save(QString const& filePath) const {
+	return true;
+}
+
+bool ImageFrame::saveInfos(QString const& filePath) const {
+	return saveInfos(filePath, _additionalInfos);
+}
+
+bool ImageFrame::saveInfos(QString const& filePath, QMap<QString, QString> const& infos) {
+
+	if (infos.isEmpty()) {
+		return true;
+	}
+
+	QFile infoFile(filePath + ".infos");
+
+	if (!infoFile.open(QIODevice::WriteOnly)){
+		return false;
+	}
+
+	QTextStream stream(&infoFile);
+
+	for (auto it = infos.constBegin(); it != infos.constEnd(); ++it) {
+		stream << it.key() << ": " << it.value() << "\n";
+	}
+
+	stream.flush();
+	infoFile.close();
+	return true;
+}
+
+QMap<QString, QString> ImageFrame::loadInfos(QString const& fileName) {
 
-	if (!_additionalInfos.isEmpty()) {
-		QFile infoFile(filePath + ".infos");
+	QFile infoFile(fileName + ".infos");
+
+	if (!infoFile.exists()) {
+		return FrameInfosTable::lookup(fileName);
+	}
+
+	QMap<QString, QString> infos;
 
-		if (infoFile.open(QIODevice::WriteOnly)){
+	if(infoFile.open(QIODevice::ReadOnly)) {
 
-			for (QString key : _additionalInfos.keys()) {
-				QTextStream(&infoFile) << key << ": " << _additionalInfos[key] << "\n";
+		QByteArray line = infoFile.readLine();
+
+		while (!line.isEmpty()) {
+
+			QString l = QString::fromLocal8Bit(line).trimmed();
+			QStringList lst = l.split(":");
+
+			if (lst.size() == 2) {
+				infos.insert(lst[0].trimmed(), lst[1].trimmed());
 			}
 
-			infoFile.close();
+			line = infoFile.readLine();
 		}
 	}
 
-	if (_type == GRAY_8) {
-		return StereoVision::IO::writeImage<uint8_t, uint8_t>(filePath.toStdString(), _grayscale8->subView(Multidim::DimSlice(), Multidim::DimSlice()));
+	return infos;
+}
+
+size_t ImageFrame::payloadBytes() const {
+
+	size_t elementBytes = 0;
+
+	visit([&elementBytes] (auto*, auto format) {
+		elementBytes = sizeof (typename decltype(format)::Element);
+	});
+
+	return static_cast<size_t>(_height)*_width*_channels*elementBytes;
+}
+
+size_t ImageFrame::maxRawBytes(RawEncoding encoding) const {
+
+	if (isValid() and encoding == RawRvl and supportsEncoding(_type, encoding)) {
+		return rawHeaderBytes + DepthCompression::rvlMaxBytes(height()*width());
 	}
 
-	if (_type == GRAY_16) {
-		return StereoVision::IO::writeImage<uint16_t, uint16_t>(filePath.toStdString(), _grayscale16->subView(Multidim::DimSlice(), Multidim::DimSlice()));
+	return rawBytes();
+}
+
+size_t ImageFrame::writeRaw(uint8_t* buffer, size_t capacity, RawEncoding encoding) const {
+
+	if (!supportsEncoding(_type, encoding)) {
+		encoding = RawPlain;
+	}
+
+	if (!isValid() or capacity < maxRawBytes(encoding)) {
+		return 0;
+	}
+
+	RawFrameHeader header{};
+	std::memcpy(header.magic, rawFrameMagic, sizeof (rawFrameMagic));
+	header.version = rawFrameVersion;
+	header.imgType = _type;
+	header.height = height();
+	header.width = width();
+	header.channels = channels();
+	header.elementBytes = payloadBytes()/(height()*width()*channels());
+	header.payloadBytes = payloadBytes();
+	header.encoding = encoding;
+
+	std::memset(buffer, 0, rawHeaderBytes);
+
+	uint8_t* pixels = buffer + rawHeaderBytes;
+
+	if (encoding == RawRvl) {
+		int64_t encoded = encodeRvlPixels(view<GRAY_16>(), pixels, capacity - rawHeaderBytes);
+
+		if (encoded < 0) {
+			return 0;
+		}
+
+		header.payloadBytes = static_cast<uint64_t>(encoded);
+	} else {
+		visit([&header, pixels] (auto* img, auto) {
+			header.payloadBytes = packPixels(img, pixels);
+		});
+	}
+
+	if (header.payloadBytes == 0) {
+		return 0;
 	}
 
-	if (_type == GRAY_F32) {
-		return StereoVision::IO::writeImage<float, float>(filePath.toStdString(), _grayscalef32->subView(Multidim::DimSlice(), Multidim::DimSlice()));
+	// the payload has just been written, so the checksum pass reads it from the cache.
+	header.checksum = rawChecksumCrc32c;
+	header.crc32c = 0;
+	std::memcpy(buffer, &header, sizeof (header));
+
+	uint32_t crc = FrameChecksum::crc32c(buffer, rawChecksummedHeaderBytes);
+	crc = FrameChecksum::crc32c(pixels, header.payloadBytes, crc);
+	std::memcpy(buffer + offsetof(RawFrameHeader, crc32c), &crc, sizeof (crc));
+
+	return rawHeaderBytes + header.payloadBytes;
+}
+
+uint32_t ImageFrame::payloadCrc32c() const {
+
+	uint32_t crc = 0;
+
+	visit([&crc] (auto* img, auto) {
+		crc = pixelsCrc32c(img);
+	});
+
+	return crc;
+}
+
+bool ImageFrame::readRaw(QString const& fileName) {
+
+	QFile rawFile(fileName);
+
+	if (!rawFile.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	QByteArray headerData = rawFile.read(rawHeaderBytes);
+
+	if (headerData.size() != static_cast<int>(rawHeaderBytes)) {
+		return false;
+	}
+
+	RawLayout layout;
+
+	if (!readRawLayout(reinterpret_cast<uint8_t const*>(headerData.constData()), layout)) {
+		return false;
+	}
+
+	if (layout.payloadBytes > static_cast<quint64>(rawFile.size()) - rawHeaderBytes) {
+		return false; //truncated file, or corrupted header.
+	}
+
+	const int h = layout.height;
+	const int w = layout.width;
+	const int c = layout.channels;
+
+	visitFormat(layout.type, [this, &rawFile, &layout, h, w, c] (auto format) {
+
+		using Format = decltype(format);
+
+		auto pixels = std::make_shared<typename Format::Array>(contiguousShape<Format>(h, w, c), contiguousStrides<Format>(w, c));
+		bool ok;
+
+		if constexpr (Format::type == GRAY_16) {
+			ok = (layout.encoding == RawRvl) ? decodeRvlPixels(rawFile, layout.payloadBytes, pixels.get()) : unpackPixels(rawFile, pixels.get());
+		} else {
+			ok = unpackPixels(rawFile, pixels.get());
+		}
+
+		if (ok) {
+			setPixels<Format::type>(pixels);
+		}
+	});
+
+	return isValid();
+}
+
+bool ImageFrame::readRawLayout(uint8_t const* header, RawLayout & layout) {
+
+	RawFrameHeader rawHeader{};
+	std::memcpy(&rawHeader, header, sizeof (rawHeader));
+
+	if (std::memcmp(rawHeader.magic, rawFrameMagic, sizeof (rawFrameMagic)) != 0 or rawHeader.version < 1 or rawHeader.version > rawFrameVersion) {
+		return false;
+	}
+
+	if (rawHeader.imgType >= INVALID or !supportsEncoding(static_cast<ImgType>(rawHeader.imgType), static_cast<RawEncoding>(rawHeader.encoding))) {
+		return false;
+	}
+
+	if (rawHeader.height == 0 or rawHeader.height > rawMaxDimension or
+			rawHeader.width == 0 or rawHeader.width > rawMaxDimension or
+			rawHeader.channels == 0 or rawHeader.channels > rawMaxChannels) {
+		return false;
+	}
+
+	const uint64_t nElements = static_cast<uint64_t>(rawHeader.height)*rawHeader.width*rawHeader.channels;
+
+	if (nElements > rawMaxElements) {
+		return false;
+	}
+
+	bool formatOk = false;
+
+	visitFormat(static_cast<ImgType>(rawHeader.imgType), [&rawHeader, &formatOk] (auto format) {
+		using Format = decltype(format);
+		formatOk = rawHeader.elementBytes == sizeof (typename Format::Element) and (Format::dims == 3 or rawHeader.channels == 1);
+	});
+
+	if (!formatOk) {
+		return false;
 	}
 
-	if (_type == MULTICHANNEL_8) {
-		return StereoVision::IO::writeImage<uint8_t, uint8_t>(filePath.toStdString(), _rgba8->subView(Multidim::DimSlice(), Multidim::DimSlice(), Multidim::DimSlice()));
+	if (rawHeader.encoding == RawPlain and rawHeader.payloadBytes != nElements*rawHeader.elementBytes) {
+		return false;
 	}
 
-	return false;
+	layout.type = static_cast<ImgType>(rawHeader.imgType);
+	layout.height = rawHeader.height;
+	layout.width = rawHeader.width;
+	layout.channels = rawHeader.channels;
+	layout.elementBytes = rawHeader.elementBytes;
+	layout.encoding = static_cast<RawEncoding>(rawHeader.encoding);
+	layout.payloadBytes = rawHeader.payloadBytes;
+	layout.hasChecksum = rawHeader.version >= rawFrameFirstChecksummedVersion and rawHeader.checksum == rawChecksumCrc32c;
+	layout.crc32c = rawHeader.crc32c;
+	layout.headerCrc32c = (layout.hasChecksum) ? FrameChecksum::crc32c(header, rawChecksummedHeaderBytes) : 0;
+
+	return true;
 }
 
 QMap<QString, QString> &ImageFrame::additionalInfos()
@@ -12,6 +12,28 @@ class ImageFrame
 public:
 
 	static const QString colorSpaceKey;
+	static const QString depthScaleKey; //!< the size in meters of one unit of a depth frame.
+
+	/*!
+	 * \brief rawFrameExtension is the extension of the files written in the raw frame format.
+	 *
+	 * A raw frame file is made of a fixed size header (see rawHeaderBytes),
+	 * followed by the pixels of the image, packed in row major order (or encoded, see RawEncoding).
+	 * The header size is a multiple of the page size, so that raw frames can be written with O_DIRECT.
+	 * The header holds a CRC32C of its fields and of the payload, to verify the frame after it has been copied.
+	 */
+	static const QString rawFrameExtension;
+	static const size_t rawHeaderBytes;
+
+	/*!
+	 * \brief The RawEncoding enum list the encodings of the pixels in the raw frame format.
+	 *
+	 * RawRvl is only used for GRAY_16 frames (depth images), other frames are always written with RawPlain.
+	 */
+	enum RawEncoding {
+		RawPlain = 0,
+		RawRvl = 1
+	};
 
 	enum ImgType {
 		GRAY_8,
@@ -21,6 +43,47 @@ public:
 		INVALID
 	};
 
+	/*!
+	 * \brief The RawLayout struct describe the pixels of a raw frame file, as read from its header.
+	 */
+	struct RawLayout {
+		ImgType type;
+		int height;
+		int width;
+		int channels;
+		int elementBytes;
+		RawEncoding encoding;
+		quint64 payloadBytes; //!< the number of bytes following the header, after encoding.
+		bool hasChecksum; //!< false for the files written before the checksums were introduced.
+		uint32_t crc32c; //!< the checksum stored in the header.
+		uint32_t headerCrc32c; //!< the checksum of the header fields, to extend over the payload to compare with crc32c.
+	};
+
+	/*!
+	 * \brief readRawLayout parse a raw frame header.
+	 * \param header the first rawHeaderBytes bytes of a raw frame file.
+	 * \return false if the header is not a valid raw frame header, or if its shape is not plausible.
+	 */
+	static bool readRawLayout(uint8_t const* header, RawLayout & layout);
+
+	/*!
+	 * \brief loadInfos read the additional infos of a frame file, from its .infos file or from the infos table of its recording.
+	 */
+	static QMap<QString, QString> loadInfos(QString const& fileName);
+	/*!
+	 * \brief saveInfos write additional infos in a .infos file next to filePath, if there are any.
+	 */
+	static bool saveInfos(QString const& filePath, QMap<QString, QString> const& infos);
+
+	/*!
+	 * \brief The PixelFormat struct give, at compile time, how the pixels of a frame type are stored.
+	 *
+	 * Each valid ImgType has a specialization (see below the class) with the Element type, the number of dimensions
+	 * and the Array type holding the pixels. A new frame type only needs a new ImgType value and its specialization.
+	 */
+	template<ImgType type>
+	struct PixelFormat;
+
 	ImageFrame();
 	ImageFrame(uint8_t* data, Multidim::Array<uint8_t, 2>::ShapeBlock shape, Multidim::Array<uint8_t, 2>::ShapeBlock stride, bool copy = true);
 	ImageFrame(uint16_t* data, Multidim::Array<uint16_t, 2>::ShapeBlock shape, Multidim::Array<uint16_t, 2>::ShapeBlock stride, bool copy = true);
@@ -29,81 +92,116 @@ public:
 
 	ImageFrame(const QString &fileName);
 
-	ImageFrame(ImageFrame const& other);
+	ImageFrame(ImageFrame const& other) = default;
+	/*!
+	 * \brief ImageFrame take the pixels of other, which is left invalid (a defaulted move would leave its type and shape set without pixels).
+	 */
+	ImageFrame(ImageFrame && other);
+
+	ImageFrame& operator=(ImageFrame const& other) = default;
+	ImageFrame& operator=(ImageFrame && other);
 
 	~ImageFrame();
 
 	inline ImgType imgType() const { return _type; }
 	inline bool isValid() const { return _type != INVALID; }
 
-	inline int height() const {
-		switch (_type) {
-		case GRAY_8:
-			return _grayscale8->shape()[0];
-		case GRAY_16:
-			return _grayscale16->shape()[0];
-		case GRAY_F32:
-			return _grayscalef32->shape()[0];
-		case MULTICHANNEL_8:
-			return _rgba8->shape()[0];
-		default:
-			return 0;
-		}
-	}
+	inline int height() const { return _height; }
+	inline int width() const { return _width; }
+	inline int channels() const { return _channels; }
 
-	inline int width() const {
-		switch (_type) {
-		case GRAY_8:
-			return _grayscale8->shape()[1];
-		case GRAY_16:
-			return _grayscale16->shape()[1];
-		case GRAY_F32:
-			return _grayscalef32->shape()[1];
-		case MULTICHANNEL_8:
-			return _rgba8->shape()[1];
-		default:
-			return 0;
+	/*!
+	 * \brief view give the pixels of the frame if it is of the given type, nullptr otherwise.
+	 */
+	template<ImgType type>
+	inline typename PixelFormat<type>::Array* view() const {
+		if (_type == type) {
+			return static_cast<typename PixelFormat<type>::Array*>(_pixels.get());
 		}
+		return nullptr;
 	}
 
-	inline int channels() const {
-		switch (_type) {
-		case MULTICHANNEL_8:
-			return _rgba8->shape()[2];
-		default:
-			return 1;
-		}
-	}
+	/*!
+	 * \brief visitFormat call f(PixelFormat<type>()) for a runtime frame type.
+	 *
+	 * This is the only place which switches on the frame types, the generic lambdas passed to visitFormat and visit
+	 * get the element type and the dimensions from their PixelFormat argument.
+	 * \return false, without calling f, if type is not a valid frame type.
+	 */
+	template<typename F>
+	static bool visitFormat(ImgType type, F && f);
+	/*!
+	 * \brief visit call f(view<type>(), PixelFormat<type>()) for the type of the frame, nothing is called for an invalid frame.
+	 */
+	template<typename F>
+	void visit(F && f) const;
 
-	inline Multidim::Array<uint8_t, 2>* grayscale8() const {
-		if (_type == GRAY_8) {
-			return _grayscale8.get();
-		}
-		return nullptr;
-	}
+	inline Multidim::Array<uint8_t, 2>* grayscale8() const;
+	inline Multidim::Array<uint16_t, 2>* grayscale16() const;
+	inline Multidim::Array<float, 2>* grayscalef32() const;
+	inline Multidim::Array<uint8_t, 3>* multichannels8() const;
 
-	inline Multidim::Array<uint16_t, 2>* grayscale16() const {
-		if (_type == GRAY_16) {
-			return _grayscale16.get();
-		}
-		return nullptr;
-	}
+	/*!
+	 * \brief deepCopy create a frame owning a contiguous copy of the pixels of this frame.
+	 *
+	 * The copy is allocated by FrameMemory, on the NUMA node of the calling thread if enabled.
+	 */
+	ImageFrame deepCopy() const;
+	/*!
+	 * \brief allocate create a frame owning contiguous, uninitialized, pixels, allocated like the pixels of deepCopy.
+	 *
+	 * It is used to prepare frames which are later filled with copyPixelsFrom.
+	 * \param channels the number of channels, ignored for the grayscale types.
+	 * \return an invalid frame if type is invalid or if the allocation failed.
+	 */
+	static ImageFrame allocate(ImgType type, int height, int width, int channels);
+	/*!
+	 * \brief copyPixelsFrom copy the pixels (and infos) of other into the storage of this frame, without allocating.
+	 *
+	 * The storage of this frame is expected to be contiguous, as it is for a frame created by deepCopy.
+	 *
+	 * \return false if the frames types or shapes differ, or if the storage of this frame is shared with another frame.
+	 */
+	bool copyPixelsFrom(ImageFrame const& other);
 
-	inline Multidim::Array<float, 2>* grayscalef32() const {
-		if (_type == GRAY_F32) {
-			return _grayscalef32.get();
-		}
-		return nullptr;
-	}
+	/*!
+	 * \brief save the frame in a file.
+	 * \param filePath the path of the file, the format is deduced from the extension.
+	 * \param withInfos if true, the additional infos are written in a .infos file next to the frame.
+	 * \param encoding the encoding of the pixels, for the raw frame format.
+	 * \return true on success.
+	 */
+	bool save(QString const& filePath, bool withInfos = true, RawEncoding encoding = RawPlain) const;
+	/*!
+	 * \brief saveInfos write the additional infos of the frame in a .infos file next to filePath, if there are any.
+	 */
+	bool saveInfos(QString const& filePath) const;
 
-	inline Multidim::Array<uint8_t, 3>* multichannels8() const {
-		if (_type == MULTICHANNEL_8) {
-			return _rgba8.get();
-		}
-		return nullptr;
-	}
+	/*!
+	 * \brief payloadBytes give the number of bytes required to store the pixels of the frame, without padding.
+	 */
+	size_t payloadBytes() const;
+	/*!
+	 * \brief rawBytes give the size of the frame serialized in the raw frame format.
+	 */
+	inline size_t rawBytes() const { return (isValid()) ? rawHeaderBytes + payloadBytes() : 0; }
+	/*!
+	 * \brief maxRawBytes give the largest size the frame can take in the raw frame format with a given encoding.
+	 */
+	size_t maxRawBytes(RawEncoding encoding) const;
+	/*!
+	 * \brief writeRaw serialize the frame, in the raw frame format, in a memory buffer.
+	 * \param buffer the buffer to write in.
+	 * \param capacity the size of the buffer, at least maxRawBytes(encoding).
+	 * \param encoding the encoding of the pixels, ignored (RawPlain is used) if the frame type does not support it.
+	 * \return the number of bytes written, or 0 if the buffer is too small or the frame is invalid.
+	 */
+	size_t writeRaw(uint8_t* buffer, size_t capacity, RawEncoding encoding = RawPlain) const;
 
-	bool save(QString const& filePath) const;
+	/*!
+	 * \brief payloadCrc32c give the CRC32C of the pixels, packed in row major order, as stored in the catalogs for the non raw formats.
+	 */
+	uint32_t payloadCrc32c() const;
 
 
 	QMap<QString, QString>& additionalInfos();
@@ -111,15 +209,107 @@ public:
 
 protected:
 
+	bool readRaw(QString const& fileName);
+
+	/*!
+	 * \brief setPixels make pixels the pixels of the frame, and cache their shape.
+	 */
+	template<ImgType type>
+	void setPixels(std::shared_ptr<typename PixelFormat<type>::Array> const& pixels);
+
 	ImgType _type;
 
-	std::shared_ptr<Multidim::Array<uint8_t, 2>> _grayscale8;
-	std::shared_ptr<Multidim::Array<uint16_t, 2>> _grayscale16;
-	std::shared_ptr<Multidim::Array<float, 2>> _grayscalef32;
-	std::shared_ptr<Multidim::Array<uint8_t, 3>> _rgba8;
+	int _height;
+	int _width;
+	int _channels;
+
+	/*!
+	 * \brief _pixels point to the PixelFormat<_type>::Array of the frame.
+	 *
+	 * It is the only handle on the pixels, shared by the copies of the frame, and also owns the buffer the array views
+	 * when the pixels are stored outside of the array (see deepCopy), so copying a frame costs a single reference count.
+	 */
+	std::shared_ptr<void> _pixels;
 
-	QMap<QString, QString> _additionalInfos;
+	QMap<QString, QString> _additionalInfos; //!< implicitly shared, copying the frame does not copy the infos.
+
+};
+
+template<>
+struct ImageFrame::PixelFormat<ImageFrame::GRAY_8> {
+	static constexpr ImgType type = GRAY_8;
+	using Element = uint8_t;
+	static constexpr int dims = 2;
+	using Array = Multidim::Array<Element, dims>;
+};
+
+template<>
+struct ImageFrame::PixelFormat<ImageFrame::GRAY_16> {
+	static constexpr ImgType type = GRAY_16;
+	using Element = uint16_t;
+	static constexpr int dims = 2;
+	using Array = Multidim::Array<Element, dims>;
+};
 
+template<>
+struct ImageFrame::PixelFormat<ImageFrame::GRAY_F32> {
+	static constexpr ImgType type = GRAY_F32;
+	using Element = float;
+	static constexpr int dims = 2;
+	using Array = Multidim::Array<Element, dims>;
 };
 
+template<>
+struct ImageFrame::PixelFormat<ImageFrame::MULTICHANNEL_8> {
+	static constexpr ImgType type = MULTICHANNEL_8;
+	using Element = uint8_t;
+	static constexpr int dims = 3; //!< 1 to 4 channels.
+	using Array = Multidim::Array<Element, dims>;
+};
+
+template<typename F>
+bool ImageFrame::visitFormat(ImgType type, F && f) {
+
+	switch (type) {
+	case GRAY_8:
+		f(PixelFormat<GRAY_8>());
+		return true;
+	case GRAY_16:
+		f(PixelFormat<GRAY_16>());
+		return true;
+	case GRAY_F32:
+		f(PixelFormat<GRAY_F32>());
+		return true;
+	case MULTICHANNEL_8:
+		f(PixelFormat<MULTICHANNEL_8>());
+		return true;
+	default:
+		return false;
+	}
+}
+
+template<typename F>
+void ImageFrame::visit(F && f) const {
+
+	visitFormat(_type, [this, &f] (auto format) {
+		f(view<decltype(format)::type>(), format);
+	});
+}
+
+inline Multidim::Array<uint8_t, 2>* ImageFrame::grayscale8() const {
+	return view<GRAY_8>();
+}
+
+inline Multidim::Array<uint16_t, 2>* ImageFrame::grayscale16() const {
+	return view<GRAY_16>();
+}
+
+inline Multidim::Array<float, 2>* ImageFrame::grayscalef32() const {
+	return view<GRAY_F32>();
+}
+
+inline Multidim::Array<uint8_t, 3>* ImageFrame::multichannels8() const {
+	return view<MULTICHANNEL_8>();
+}
+
 #endif // IMAGEFRAME_H
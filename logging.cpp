@@ -0,0 +1,207 @@
+#include "logging.h"
+
+#include <QDateTime>
+#include <QSettings>
+
+#include <algorithm>
+#include <cstdio>
+
+Q_LOGGING_CATEGORY(lcApp, "rsnir.app")
+Q_LOGGING_CATEGORY(lcCamera, "rsnir.camera")
+Q_LOGGING_CATEGORY(lcRemote, "rsnir.remote")
+
+AsyncLogSink* AsyncLogSink::_instance = nullptr;
+QtMessageHandler AsyncLogSink::_previousHandler = nullptr;
+
+namespace {
+
+char const* levelName(QtMsgType type) {
+
+	switch (type) {
+	case QtDebugMsg:
+		return "debug";
+	case QtInfoMsg:
+		return "info";
+	case QtWarningMsg:
+		return "warning";
+	case QtCriticalMsg:
+		return "critical";
+	case QtFatalMsg:
+		return "fatal";
+	}
+
+	return "unknown";
+}
+
+} // namespace
+
+AsyncLogSink::Config AsyncLogSink::Config::fromSettings() {
+
+	Config config;
+
+	QSettings settings;
+	config.rules = settings.value("log/rules", config.rules).toString();
+	config.file = settings.value("log/file", config.file).toString();
+	config.queueSize = std::max(1, settings.value("log/queuesize", config.queueSize).toInt());
+
+	settings.setValue("log/rules", config.rules);
+	settings.setValue("log/file", config.file);
+	settings.setValue("log/queuesize", config.queueSize);
+
+	return config;
+}
+
+void AsyncLogSink::install(Config const& config) {
+
+	uninstall();
+
+	QString rules = config.rules;
+	QLoggingCategory::setFilterRules(rules.replace(';', '\n'));
+
+	_instance = new AsyncLogSink(config);
+	_instance->start(QThread::LowPriority);
+
+	_previousHandler = qInstallMessageHandler(&AsyncLogSink::handleMessage);
+}
+
+void AsyncLogSink::uninstall() {
+
+	if (_instance == nullptr) {
+		return;
+	}
+
+	qInstallMessageHandler(_previousHandler);
+	_previousHandler = nullptr;
+
+	_instance->finish();
+	delete _instance;
+	_instance = nullptr;
+}
+
+AsyncLogSink::AsyncLogSink(Config const& config) :
+	_config(config),
+	_dropped(0),
+	_continue(true)
+{
+	_lines.reserve(_config.queueSize);
+
+	if (!_config.file.isEmpty()) {
+		_file.setFileName(_config.file);
+
+		if (!_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+			fprintf(stderr, "Could not open the log file %s, logging to stderr only\n", qPrintable(_config.file));
+		}
+	}
+}
+
+AsyncLogSink::~AsyncLogSink() {
+	finish();
+}
+
+void AsyncLogSink::handleMessage(QtMsgType type, QMessageLogContext const& context, QString const& msg) {
+
+	QByteArray line = QDateTime::currentDateTime().toString(Qt::ISODateWithMs).toUtf8();
+	line += ' ';
+	line += levelName(type);
+	line += ' ';
+	line += (context.category != nullptr) ? context.category : "default";
+	line += ": ";
+	line += msg.toUtf8();
+	line += '\n';
+
+	AsyncLogSink* sink = _instance;
+
+	if (sink == nullptr) {
+		fwrite(line.constData(), 1, line.size(), stderr);
+		return;
+	}
+
+	// the process may not survive a fatal message, so it is written before returning, with everything queued before it.
+	sink->push(line, type == QtFatalMsg);
+}
+
+void AsyncLogSink::push(QByteArray const& line, bool synchronous) {
+
+	QMutexLocker locker(&_mutex);
+
+	if (synchronous) {
+		QVector<QByteArray> lines;
+		lines.swap(_lines);
+		lines.push_back(line);
+		locker.unlock();
+		write(lines);
+		return;
+	}
+
+	if (_lines.size() >= _config.queueSize) {
+		_dropped++;
+		return;
+	}
+
+	_lines.push_back(line);
+
+	if (_lines.size() == 1) {
+		_linesAvailable.wakeOne();
+	}
+}
+
+void AsyncLogSink::run() {
+
+	QVector<QByteArray> lines;
+	lines.reserve(_config.queueSize);
+
+	QMutexLocker locker(&_mutex);
+
+	while (_continue or !_lines.isEmpty()) {
+
+		if (_lines.isEmpty()) {
+			_linesAvailable.wait(&_mutex);
+			continue;
+		}
+
+		lines.swap(_lines);
+		qint64 dropped = _dropped;
+		_dropped = 0;
+
+		locker.unlock();
+
+		if (dropped > 0) {
+			lines.push_back(QString("%1 log messages dropped, the log sink could not keep up\n").arg(dropped).toUtf8());
+		}
+
+		write(lines);
+		lines.clear();
+
+		locker.relock();
+	}
+}
+
+void AsyncLogSink::write(QVector<QByteArray> const& lines) {
+
+	QMutexLocker locker(&_writeMutex);
+
+	for (QByteArray const& line : lines) {
+		fwrite(line.constData(), 1, line.size(), stderr);
+
+		if (_file.isOpen()) {
+			_file.write(line);
+		}
+	}
+
+	fflush(stderr);
+
+	if (_file.isOpen()) {
+		_file.flush();
+	}
+}
+
+void AsyncLogSink::finish() {
+
+	{
+		QMutexLocker locker(&_mutex);
+		_continue = false;
+		_linesAvailable.wakeAll();
+	}
+
+	wait();
+}
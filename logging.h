@@ -0,0 +1,87 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QLoggingCategory>
+#include <QVector>
+#include <QFile>
+
+Q_DECLARE_LOGGING_CATEGORY(lcApp)
+Q_DECLARE_LOGGING_CATEGORY(lcCamera)
+Q_DECLARE_LOGGING_CATEGORY(lcRemote)
+
+/*!
+ * \brief The AsyncLogSink class write the log messages from a background thread.
+ *
+ * Messages are logged through the categories above (qCDebug, qCInfo, qCWarning, qCCritical), filtered by the log/rules
+ * setting (QLoggingCategory rules, debug messages are disabled by default), and formatted as one line per message:
+ * time, level, category and text. The calling thread only formats the line and pushes it to a bounded queue,
+ * lines are dropped (and counted) rather than blocking when the queue is full.
+ * Debug messages are removed at compile time in release builds (QT_NO_DEBUG_OUTPUT), so they cost nothing in the
+ * capture and network paths.
+ */
+class AsyncLogSink : public QThread
+{
+	Q_OBJECT
+public:
+
+	struct Config {
+
+		Config() :
+			rules("rsnir.*.debug=false"),
+			queueSize(1024)
+		{
+
+		}
+
+		/*!
+		 * \brief fromSettings load the configuration from the log/ settings (and write back the defaults).
+		 */
+		static Config fromSettings();
+
+		QString rules; //!< QLoggingCategory filter rules, separated by ';'.
+		QString file; //!< a file the messages are appended to, in addition to stderr, empty for stderr only.
+		int queueSize; //!< the number of lines which can wait to be written.
+	};
+
+	/*!
+	 * \brief install start the sink and make it the Qt message handler.
+	 */
+	static void install(Config const& config);
+	/*!
+	 * \brief uninstall write the remaining messages, stop the sink and restore the default message handler.
+	 */
+	static void uninstall();
+
+	~AsyncLogSink();
+
+	virtual void run();
+
+protected:
+
+	explicit AsyncLogSink(Config const& config);
+
+	static void handleMessage(QtMsgType type, QMessageLogContext const& context, QString const& msg);
+
+	void push(QByteArray const& line, bool synchronous);
+	void write(QVector<QByteArray> const& lines);
+	void finish();
+
+	static AsyncLogSink* _instance;
+	static QtMessageHandler _previousHandler;
+
+	Config _config;
+
+	QMutex _mutex;
+	QWaitCondition _linesAvailable;
+	QVector<QByteArray> _lines;
+	qint64 _dropped;
+	bool _continue;
+
+	QMutex _writeMutex;
+	QFile _file;
+};
+
+#endif // LOGGING_H
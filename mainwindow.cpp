@@ -14,6 +14,7 @@
 
 #include "cameraslist.h"
 #include "cameraapplication.h"
+#include "streamprofilesdialog.h"
 
 MainWindow::MainWindow(QWidget *parent)
 	: QMainWindow(parent)
@@ -45,6 +46,7 @@ MainWindow::MainWindow(QWidget *parent)
 
 	ui->exportDirField->setText(CameraApplication::GetCameraApp()->exportDir());
 	connect(ui->chooseDirButton, &QPushButton::clicked, this, &MainWindow::selectExportDir);
+	connect(ui->profilesButton, &QPushButton::clicked, this, &MainWindow::editStreamProfiles);
 
 	setFocusPolicy(Qt::StrongFocus);
 
@@ -59,11 +61,14 @@ MainWindow::~MainWindow()
 
 void MainWindow::setFrames(ImageFrame frameLeft, ImageFrame frameRight) {
 
-	QPixmap pxLeft = imageFrameToQPixmap(frameLeft);
-	QPixmap pxRight = imageFrameToQPixmap(frameRight);
+	// a stream can be disabled in the camera stream profiles.
+	if (frameLeft.isValid()) {
+		_pxmLeft->setPixmap(imageFrameToQPixmap(frameLeft));
+	}
 
-	_pxmLeft->setPixmap(pxLeft);
-	_pxmRight->setPixmap(pxRight);
+	if (frameRight.isValid()) {
+		_pxmRight->setPixmap(imageFrameToQPixmap(frameRight));
+	}
 
 }
 
@@ -109,6 +114,9 @@ void MainWindow::showErrorMessage(QString txt) {
 	QMessageBox::critical(this, "An error happened during acquisition", txt);
 	endGrabber();
 }
+void MainWindow::showStatusMessage(QString txt) {
+	ui->statusbar->showMessage(txt, 10000);
+}
 void MainWindow::endGrabber() {
 
 	ui->actionStart_acquisition->setEnabled(true);
@@ -125,51 +133,25 @@ void MainWindow::selectExportDir() {
 	if (!dir.isEmpty()) {
 		if (QDir(dir).exists()) {
 			CameraApplication::GetCameraApp()->setExportDir(dir);
-			ui->exportDirField->setText(dir);
+			ui->exportDirField->setText(CameraApplication::GetCameraApp()->exportDir()); //unchanged if refused.
 		}
 	}
 }
 
-QPixmap imageFrameToQPixmap(const ImageFrame &f)
-{
-
-	int w = f.width();
-	int h = f.height();
-
-	if (f.imgType() == ImageFrame::GRAY_8) {
-		QImage ret((uchar*) &f.grayscale8()->atUnchecked(0,0), w, h, w, QImage::Format_Grayscale8);
-		return QPixmap::fromImage(ret);
-	}
+void MainWindow::editStreamProfiles() {
 
-	if (f.imgType() == ImageFrame::GRAY_16) {
-		Multidim::Array<uint16_t, 2>* original = f.grayscale16();
-		Multidim::Array<uint8_t, 2> grayMap(original->shape(), original->strides());
-
-		qint64 mean = 0;
-		for (int i = 0; i < original->shape()[0]; i++) {
-			for (int j = 0; j < original->shape()[1]; j++) {
-				grayMap.atUnchecked(i,j) = static_cast<uint8_t>(original->valueUnchecked(i,j)/256);
-				mean += grayMap.atUnchecked(i,j);
-			}
-		}
+	int row = ui->camerasListView->currentIndex().row();
 
-		QImage ret((uchar*) &grayMap.atUnchecked(0,0), w, h, w, QImage::Format_Grayscale8);
-		QPixmap px = QPixmap::fromImage(ret.copy());
-		return px.scaled(w/2,h/2);
+	if (_cam_lst == nullptr or row < 0 or !_cam_lst->isRs(row)) {
+		showStatusMessage("Select a RealSense camera to edit its stream profiles");
+		return;
 	}
 
-	if (f.imgType() == ImageFrame::MULTICHANNEL_8) {
+	StreamProfilesDialog dialog(QString::fromStdString(_cam_lst->serialNumber(row)), this);
 
-		if (f.multichannels8()->shape()[2] == 3) { //RGB
-			QImage ret((uchar*) &f.multichannels8()->atUnchecked(0,0,0), w, h, w*3, QImage::Format_RGB888);
-			return QPixmap::fromImage(ret);
-		}
-
-		if (f.multichannels8()->shape()[2] == 4) { //RGBA
-			QImage ret((uchar*) &f.multichannels8()->atUnchecked(0,0,0), w, h, w*4, QImage::Format_RGBA8888);
-			return QPixmap::fromImage(ret);
+	if (dialog.exec() == QDialog::Accepted) {
+		if (CameraApplication::GetCameraApp()->setStreamProfiles(row, dialog.config())) {
+			showStatusMessage("Stream profiles saved, they are used the next time the camera starts");
 		}
 	}
-
-	throw std::runtime_error("Unsupported frame format !");
 }
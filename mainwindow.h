@@ -6,6 +6,7 @@
 #include <QDir>
 
 #include "./imageframe.h"
+#include "./framepixmap.h"
 
 class QGraphicsScene;
 class QGraphicsPixmapItem;
@@ -29,6 +30,7 @@ public:
 	void setCameraList(CamerasList* lst);
 
 	void showErrorMessage(QString txt);
+	void showStatusMessage(QString txt);
 
 private:
 
@@ -43,6 +45,7 @@ protected:
 	void endGrabber();
 
 	void selectExportDir();
+	void editStreamProfiles();
 
 	Ui::MainWindow *ui;
 
@@ -56,6 +59,4 @@ protected:
 
 };
 
-QPixmap imageFrameToQPixmap(const ImageFrame &f);
-
 #endif // MAINWINDOW_H
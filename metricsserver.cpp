@@ -0,0 +1,196 @@
+#include "metricsserver.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QTextStream>
+
+#include <unistd.h>
+
+const quint16 MetricsServer::preferredPort = 9464;
+
+const int MetricsServer::maxRequestBytes = 8192;
+const int MetricsServer::requestTimeoutMs = 5000;
+
+namespace {
+
+QString escapeLabel(QString const& value) {
+
+	QString ret = value;
+	ret.replace('\\', "\\\\");
+	ret.replace('"', "\\\"");
+	ret.replace('\n', "\\n");
+
+	return ret;
+}
+
+} // namespace
+
+void PrometheusText::sample(QString const& name, QString const& type, QString const& help, double value, Labels const& labels) {
+
+	if (!_described.contains(name)) {
+		_described.insert(name);
+		_text += "# HELP " + name.toUtf8() + ' ' + help.toUtf8() + '\n';
+		_text += "# TYPE " + name.toUtf8() + ' ' + type.toUtf8() + '\n';
+	}
+
+	_text += name.toUtf8();
+
+	if (!labels.isEmpty()) {
+
+		QStringList pairs;
+
+		for (auto it = labels.constBegin(); it != labels.constEnd(); ++it) {
+			pairs << it.key() + "=\"" + escapeLabel(it.value()) + '"';
+		}
+
+		_text += '{' + pairs.join(',').toUtf8() + '}';
+	}
+
+	_text += ' ' + QByteArray::number(value, 'g', 15) + '\n';
+}
+
+void PrometheusText::addThreadsCpuTime() {
+
+	const double ticksPerSecond = sysconf(_SC_CLK_TCK);
+
+	QDir tasks("/proc/self/task");
+
+	for (QString const& tid : tasks.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+
+		QFile stat(tasks.filePath(tid + "/stat"));
+
+		if (!stat.open(QIODevice::ReadOnly)) {
+			continue; //the thread has exited.
+		}
+
+		// <tid> (<name>) <state> ..., the name can hold spaces and parentheses, the fields are counted from the last ')'.
+		QByteArray line = stat.readAll();
+		int nameStart = line.indexOf('(');
+		int nameEnd = line.lastIndexOf(')');
+
+		if (nameStart < 0 or nameEnd < nameStart) {
+			continue;
+		}
+
+		QList<QByteArray> fields = line.mid(nameEnd + 2).split(' ');
+
+		// utime and stime are the 14th and 15th fields of the line, the 12th and 13th after the name.
+		if (fields.size() < 13) {
+			continue;
+		}
+
+		double seconds = (fields[11].toLongLong() + fields[12].toLongLong())/ticksPerSecond;
+
+		sample("rsnir_thread_cpu_seconds_total", "counter", "Cpu time used by each thread of the process.", seconds,
+			   {{"tid", tid}, {"thread", QString::fromUtf8(line.mid(nameStart + 1, nameEnd - nameStart - 1))}});
+	}
+}
+
+MetricsServer::Config MetricsServer::Config::fromSettings() {
+
+	Config config;
+
+	QSettings settings;
+	config.enabled = settings.value("metrics/enabled", config.enabled).toBool();
+	config.address = settings.value("metrics/address", config.address).toString();
+	config.port = static_cast<quint16>(settings.value("metrics/port", config.port).toUInt());
+
+	settings.setValue("metrics/enabled", config.enabled);
+	settings.setValue("metrics/address", config.address);
+	settings.setValue("metrics/port", config.port);
+
+	return config;
+}
+
+MetricsServer::MetricsServer(Collector const& collector, QObject *parent) :
+	QTcpServer(parent),
+	_collector(collector)
+{
+	connect(this, &QTcpServer::newConnection, this, &MetricsServer::manageNewPendingConnection);
+}
+
+bool MetricsServer::start(Config const& config) {
+
+	if (!config.enabled) {
+		return false;
+	}
+
+	QHostAddress address(config.address);
+	QTextStream err(stderr);
+
+	if (address.isNull()) {
+		err << "Invalid metrics/address " << config.address << ", the metrics are not served" << endl;
+		return false;
+	}
+
+	if (!listen(address, config.port)) {
+
+		if (serverError() != QAbstractSocket::AddressInUseError or !listen(address, 0)) {
+			err << "Could not serve the metrics on " << config.address << ":" << config.port << ": " << errorString() << endl;
+			return false;
+		}
+
+		err << "Port " << config.port << " is already used, the metrics are served on port " << serverPort() << " instead" << endl;
+	}
+
+	return true;
+}
+
+void MetricsServer::manageNewPendingConnection() {
+
+	while (hasPendingConnections()) {
+
+		QTcpSocket* socket = nextPendingConnection();
+
+		connect(socket, &QAbstractSocket::disconnected, socket, &QObject::deleteLater);
+		connect(socket, &QIODevice::readyRead, this, [this, socket] () {
+			answer(socket);
+		});
+
+		// clients which never complete their request do not hold a connection forever.
+		QTimer::singleShot(requestTimeoutMs, socket, [socket] () {
+			socket->abort();
+			socket->deleteLater();
+		});
+	}
+}
+
+void MetricsServer::answer(QTcpSocket* socket) {
+
+	QByteArray request = socket->peek(maxRequestBytes);
+
+	bool http = request.startsWith("GET ") or request.startsWith("HEAD ");
+	bool complete = (http) ? request.contains("\r\n\r\n") or request.contains("\n\n") : request.contains('\n');
+
+	if (!complete and request.size() < maxRequestBytes) {
+		return; //wait for the rest of the request.
+	}
+
+	socket->readAll();
+	disconnect(socket, &QIODevice::readyRead, this, nullptr);
+
+	PrometheusText metrics;
+
+	if (_collector) {
+		_collector(metrics);
+	}
+
+	if (http) {
+		QByteArray header = "HTTP/1.0 200 OK\r\n"
+							"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+							"Content-Length: " + QByteArray::number(metrics.text().size()) + "\r\n"
+							"Connection: close\r\n\r\n";
+		socket->write(header);
+
+		if (request.startsWith("GET ")) {
+			socket->write(metrics.text());
+		}
+	} else {
+		socket->write(metrics.text());
+	}
+
+	socket->disconnectFromHost();
+}
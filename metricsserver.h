@@ -0,0 +1,100 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QTcpServer>
+#include <QHostAddress>
+#include <QByteArray>
+#include <QSet>
+#include <QMap>
+
+#include <functional>
+
+/*!
+ * \brief The PrometheusText class build a metrics page in the Prometheus text exposition format.
+ */
+class PrometheusText
+{
+public:
+
+	using Labels = QMap<QString, QString>;
+
+	/*!
+	 * \brief sample add a sample of a metric, the help and type lines are written before its first sample.
+	 *
+	 * The samples of a metric have to be added one after the other, without samples of other metrics in between.
+	 * \param type "counter" or "gauge".
+	 */
+	void sample(QString const& name, QString const& type, QString const& help, double value, Labels const& labels = Labels());
+
+	/*!
+	 * \brief addThreadsCpuTime add the cpu time used by each thread of the process, read from /proc/self/task.
+	 */
+	void addThreadsCpuTime();
+
+	inline QByteArray const& text() const { return _text; }
+
+protected:
+
+	QByteArray _text;
+	QSet<QString> _described;
+};
+
+/*!
+ * \brief The MetricsServer class serve the metrics of the application in the Prometheus text format.
+ *
+ * It answers HTTP GET requests (whatever the path), so that it can be scraped by Prometheus, and plain TCP clients which
+ * send a single line (e.g. with netcat), then closes the connection. The metrics are collected for each request by the
+ * collector, which is called from the thread of the server and must only read thread safe state.
+ */
+class MetricsServer : public QTcpServer
+{
+	Q_OBJECT
+public:
+
+	static const quint16 preferredPort;
+
+	struct Config {
+
+		Config() :
+			enabled(true),
+			address("127.0.0.1"),
+			port(preferredPort)
+		{
+
+		}
+
+		/*!
+		 * \brief fromSettings load the configuration from the metrics/ settings (and write back the defaults).
+		 */
+		static Config fromSettings();
+
+		bool enabled;
+		QString address; //!< the address to listen on, only the local host by default, 0.0.0.0 to serve all the interfaces.
+		quint16 port;
+	};
+
+	using Collector = std::function<void(PrometheusText &)>;
+
+	explicit MetricsServer(Collector const& collector, QObject *parent = nullptr);
+
+	/*!
+	 * \brief start listen with the given configuration, must be called from the thread of the server.
+	 *
+	 * If the port is already used (e.g. by another instance on the same host), a free port is used instead,
+	 * serverPort gives the port actually used.
+	 * \return false if the server could not listen (or is disabled).
+	 */
+	bool start(Config const& config);
+
+protected:
+
+	static const int maxRequestBytes;
+	static const int requestTimeoutMs;
+
+	void manageNewPendingConnection();
+	void answer(QTcpSocket* socket);
+
+	Collector _collector;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,260 @@
+#include "recordingmonitor.h"
+
+#include <QDir>
+#include <QStorageInfo>
+#include <QTemporaryFile>
+
+#include <unistd.h>
+
+#include <algorithm>
+
+const qint64 RecordingMonitor::probeBytes = 64*1024*1024;
+
+static const double incomingRateSmoothing = 0.1;
+static const double sustainabilityMargin = 1.1;
+static const double writeRateSmoothing = 0.3;
+static const qint64 writeWindowNs = 1000000000;
+
+static QString filesystemRoot(QString const& folder) {
+	QStorageInfo storage(folder);
+	return (storage.isValid()) ? storage.rootPath() : folder;
+}
+
+RecordingMonitor::RecordingMonitor() :
+	_lastFrameSetNs(-1),
+	_incomingBytesPerSecond(0),
+	_windowStartNs(-1),
+	_windowBytes(0),
+	_writeBytesPerSecond(0),
+	_peakWriteBytesPerSecond(0),
+	_probing(false),
+	_failedWrites(0)
+{
+	_clock.start();
+}
+
+RecordingMonitor::~RecordingMonitor() {
+	if (_probeThread.joinable()) {
+		_probeThread.join();
+	}
+}
+
+QString RecordingMonitor::outputFolder() const {
+	QMutexLocker locker(&_mutex);
+	return _outputFolder;
+}
+void RecordingMonitor::setOutputFolder(QString const& folder) {
+
+	QString filesystem = filesystemRoot(folder);
+
+	QMutexLocker locker(&_mutex);
+
+	if (folder == _outputFolder) {
+		return;
+	}
+
+	_outputFolder = folder;
+	_outputFilesystem = filesystem;
+	_writeBytesPerSecond = 0;
+	_peakWriteBytesPerSecond = 0;
+}
+
+void RecordingMonitor::recordIncomingFrameSet(qint64 bytes) {
+
+	QMutexLocker locker(&_mutex);
+
+	qint64 now = _clock.nsecsElapsed();
+
+	if (_lastFrameSetNs >= 0 and now > _lastFrameSetNs) {
+		double rate = bytes*1e9/(now - _lastFrameSetNs);
+
+		if (_incomingBytesPerSecond <= 0) {
+			_incomingBytesPerSecond = rate;
+		} else {
+			_incomingBytesPerSecond += incomingRateSmoothing*(rate - _incomingBytesPerSecond);
+		}
+	}
+
+	_lastFrameSetNs = now;
+}
+
+void RecordingMonitor::recordWrite(qint64 bytes, bool ok) {
+
+	QMutexLocker locker(&_mutex);
+
+	if (!ok) {
+		_failedWrites++;
+		return;
+	}
+
+	qint64 now = _clock.nsecsElapsed();
+
+	if (_windowStartNs < 0) {
+		_windowStartNs = now;
+	}
+
+	_windowBytes += bytes;
+
+	if (now - _windowStartNs >= writeWindowNs) {
+		// the rate achieved in a window is a lower bound of the throughput, as the writes might have waited for frames.
+		double rate = _windowBytes*1e9/(now - _windowStartNs);
+		_peakWriteBytesPerSecond = std::max(_peakWriteBytesPerSecond, rate);
+
+		if (_writeBytesPerSecond <= 0) {
+			_writeBytesPerSecond = rate;
+		} else {
+			_writeBytesPerSecond += writeRateSmoothing*(rate - _writeBytesPerSecond);
+		}
+
+		_windowStartNs = now;
+		_windowBytes = 0;
+	}
+}
+
+double RecordingMonitor::probeWriteThroughput(bool force) {
+
+	QString folder;
+	QString filesystem;
+
+	_mutex.lock();
+	folder = _outputFolder;
+	filesystem = _outputFilesystem;
+	if (_probedWriteBytesPerSecond.value(filesystem, 0) > 0 and !force) {
+		double ret = _probedWriteBytesPerSecond.value(filesystem);
+		_mutex.unlock();
+		return ret;
+	}
+	_mutex.unlock();
+
+	QTemporaryFile probe(QDir(folder).filePath("write_probe_XXXXXX"));
+
+	if (!probe.open()) {
+		return 0;
+	}
+
+	const qint64 chunkBytes = 4*1024*1024;
+	QByteArray chunk(chunkBytes, '\x5a');
+
+	QElapsedTimer timer;
+	timer.start();
+
+	qint64 written = 0;
+	while (written < probeBytes) {
+		qint64 n = probe.write(chunk);
+
+		if (n <= 0) {
+			return 0;
+		}
+
+		written += n;
+	}
+
+	probe.flush();
+	fdatasync(probe.handle());
+
+	qint64 elapsed = timer.nsecsElapsed();
+	probe.close();
+
+	if (elapsed <= 0) {
+		return 0;
+	}
+
+	double rate = written*1e9/elapsed;
+
+	QMutexLocker locker(&_mutex);
+	_probedWriteBytesPerSecond.insert(filesystem, rate);
+
+	return rate;
+}
+
+void RecordingMonitor::probeWriteThroughputInBackground() {
+
+	QMutexLocker locker(&_mutex);
+
+	// the running probe checks the output filesystem again under the lock before it stops, so a folder changed
+	// in the meantime is probed by it.
+	if (_probing or _probedWriteBytesPerSecond.contains(_outputFilesystem)) {
+		return;
+	}
+
+	if (_probeThread.joinable()) {
+		_probeThread.join(); //done, it does not take the lock anymore.
+	}
+
+	_probing = true;
+
+	_probeThread = std::thread([this] () {
+
+		QMutexLocker locker(&_mutex);
+
+		while (!_probedWriteBytesPerSecond.contains(_outputFilesystem)) {
+
+			QString filesystem = _outputFilesystem;
+			locker.unlock();
+
+			double rate = probeWriteThroughput();
+
+			locker.relock();
+
+			if (rate <= 0) {
+				_probedWriteBytesPerSecond.insert(filesystem, 0); //cannot be written, the throughput stays unknown.
+			}
+		}
+
+		_probing = false;
+	});
+}
+
+RecordingMonitor::Estimate RecordingMonitor::estimate() const {
+
+	_mutex.lock();
+	QString folder = _outputFolder;
+	_mutex.unlock();
+
+	// statvfs can block on a slow or remote filesystem, the writers must not wait for it.
+	QStorageInfo storage(folder);
+
+	Estimate ret;
+	ret.freeBytes = (storage.isValid()) ? storage.bytesAvailable() : -1;
+
+	QMutexLocker locker(&_mutex);
+
+	ret.incomingBytesPerSecond = _incomingBytesPerSecond;
+
+	// the rate of the last completed window, if it is recent, otherwise nothing is being written.
+	bool writing = _windowStartNs >= 0 and _clock.nsecsElapsed() - _windowStartNs < 2*writeWindowNs;
+	ret.writeBytesPerSecond = (writing) ? _writeBytesPerSecond : 0;
+	ret.writeCapacityBytesPerSecond = std::max(_peakWriteBytesPerSecond, _probedWriteBytesPerSecond.value(_outputFilesystem, 0));
+
+	ret.remainingSeconds = -1;
+	if (ret.freeBytes >= 0 and ret.incomingBytesPerSecond > 0) {
+		ret.remainingSeconds = ret.freeBytes/ret.incomingBytesPerSecond;
+	}
+
+	ret.sustainable = true;
+	if (ret.writeCapacityBytesPerSecond > 0) {
+		ret.sustainable = ret.writeCapacityBytesPerSecond >= sustainabilityMargin*ret.incomingBytesPerSecond;
+	}
+
+	return ret;
+}
+
+qint64 RecordingMonitor::failedWrites() const {
+	QMutexLocker locker(&_mutex);
+	return _failedWrites;
+}
+void RecordingMonitor::resetFailedWrites() {
+	QMutexLocker locker(&_mutex);
+	_failedWrites = 0;
+}
+
+QString formatDuration(double seconds) {
+
+	if (seconds < 0) {
+		return "unknown";
+	}
+
+	qint64 s = static_cast<qint64>(seconds);
+
+	return QString("%1h%2m%3s").arg(s/3600).arg((s/60)%60, 2, 10, QChar('0')).arg(s%60, 2, 10, QChar('0'));
+}
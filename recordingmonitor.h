@@ -0,0 +1,97 @@
+#ifndef RECORDINGMONITOR_H
+#define RECORDINGMONITOR_H
+
+#include <QString>
+#include <QMutex>
+#include <QHash>
+#include <QElapsedTimer>
+
+#include <thread>
+
+/*!
+ * \brief The RecordingMonitor class estimate if a recording can be sustained by the output filesystem.
+ *
+ * It tracks the data rate produced by the camera, the throughput achieved by the writes and the free space
+ * on the output filesystem, in order to predict the remaining recording time.
+ * All the methods are thread safe.
+ */
+class RecordingMonitor
+{
+public:
+
+	struct Estimate {
+		qint64 freeBytes;
+		double incomingBytesPerSecond;
+		double writeBytesPerSecond; //!< the throughput of the recent writes, 0 if nothing has been written recently.
+		double writeCapacityBytesPerSecond; //!< the highest throughput measured or probed on the output filesystem, 0 if unknown.
+		double remainingSeconds; //!< negative if unknown
+		bool sustainable;
+	};
+
+	static const qint64 probeBytes;
+
+	RecordingMonitor();
+	~RecordingMonitor();
+
+	QString outputFolder() const;
+	void setOutputFolder(QString const& folder);
+
+	/*!
+	 * \brief recordIncomingFrameSet update the incoming data rate estimate.
+	 * \param bytes the number of bytes that would be written to save the frameset.
+	 */
+	void recordIncomingFrameSet(qint64 bytes);
+
+	/*!
+	 * \brief recordWrite register a completed write.
+	 */
+	void recordWrite(qint64 bytes, bool ok);
+
+	/*!
+	 * \brief probeWriteThroughput measure the write throughput of the output folder by writing (and syncing) a temporary file.
+	 * \return the measured throughput, in bytes per seconds, or 0 if the probe failed.
+	 *
+	 * The result is cached per output filesystem. The probe blocks for as long as the write takes,
+	 * use probeWriteThroughputInBackground from threads which cannot wait.
+	 */
+	double probeWriteThroughput(bool force = false);
+	/*!
+	 * \brief probeWriteThroughputInBackground probe the output filesystem from a worker thread, if it has not been probed yet.
+	 *
+	 * The probe writes probeBytes, so it is only requested when a recording to disk is about to start.
+	 * The result is used by estimate once the probe is done.
+	 */
+	void probeWriteThroughputInBackground();
+
+	Estimate estimate() const;
+
+	qint64 failedWrites() const;
+	void resetFailedWrites();
+
+protected:
+
+	mutable QMutex _mutex;
+
+	QString _outputFolder;
+	QString _outputFilesystem; //!< the root of the filesystem of the output folder.
+
+	QElapsedTimer _clock;
+
+	qint64 _lastFrameSetNs;
+	double _incomingBytesPerSecond;
+
+	qint64 _windowStartNs;
+	qint64 _windowBytes;
+	double _writeBytesPerSecond;
+	double _peakWriteBytesPerSecond;
+	QHash<QString, double> _probedWriteBytesPerSecond; //!< by filesystem root.
+
+	std::thread _probeThread;
+	bool _probing; //!< protected by _mutex.
+
+	qint64 _failedWrites;
+};
+
+QString formatDuration(double seconds);
+
+#endif // RECORDINGMONITOR_H
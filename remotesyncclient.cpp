@@ -1,13 +1,15 @@
 #include "remotesyncclient.h"
 
 #include <QTextStream>
+#include <QStringList>
 #include <QTcpSocket>
 #include <QHostAddress>
 #include <QDateTime>
-#include <QDebug>
 #include <QThread>
 
 #include "remotesyncserver.h"
+#include "logging.h"
+#include "recordingmonitor.h"
 
 RemoteSyncClient::RemoteSyncClient(QObject *parent) :
 	QObject(parent),
@@ -31,7 +33,7 @@ void RemoteSyncClient::collectData() {
 
 		QByteArray packet = _socket->read(RemoteConnectionManager::MaxMessageSize);
 
-		qDebug() << "received packet: " << packet;
+		qCDebug(lcRemote) << "Received" << packet.size() << "bytes from" << _socket->peerName();
 
 		_messageBuffer += packet;
 
@@ -109,7 +111,7 @@ void RemoteSyncClient::treatAnswer() {
 	qint64 ms_server = QString::fromUtf8(timestamp).toLongLong(&int_ok, 16);
 
 	if (!int_ok) {
-		qDebug() << "cannot convert timestamp to int";
+		qCWarning(lcRemote) << "Cannot convert the timestamp of the answer to an integer";
 		manageInvalidAnswer();
 		return;
 	}
@@ -126,12 +128,27 @@ void RemoteSyncClient::treatAnswer() {
 		return;
 	}
 
+	if (reqType == RemoteConnectionManager::IsRecordingActionCode) {
+		manageIsRecordingActionAnswer(status_ok, serverTime, msg.mid(space_pos+1));
+		return;
+	}
+
 	if (reqType == RemoteConnectionManager::TimeMeasureActionCode) {
 		manageTimeMeasureActionAnswer(status_ok, serverTime, msg.mid(space_pos+1));
 		return;
 	}
 
-	qDebug() << "previous request type not recognized !";
+	if (reqType == RemoteConnectionManager::StreamProfileActionCode) {
+		manageStreamProfileActionAnswer(status_ok, serverTime, msg.mid(space_pos+1));
+		return;
+	}
+
+	if (reqType == RemoteConnectionManager::StatusActionCode) {
+		manageStatusActionAnswer(status_ok, serverTime, msg.mid(space_pos+1));
+		return;
+	}
+
+	qCWarning(lcRemote) << "Previous request type not recognized !";
 
 	// if request code not recognized
 	manageInvalidAnswer();
@@ -205,7 +222,7 @@ bool RemoteSyncClient::isConnected() const {
 
 void RemoteSyncClient::checkConnectionTime() {
 
-	qDebug() << "checkConnectionTime requested  for " << _socket->peerName();
+	qCDebug(lcRemote) << "Connection time check requested for" << _socket->peerName();
 
 	if (isConnected()) {
 
@@ -218,6 +235,18 @@ void RemoteSyncClient::checkConnectionTime() {
 
 }
 
+void RemoteSyncClient::checkRecordingStatus() {
+	if (isConnected()) {
+		sendRequest(RemoteConnectionManager::IsRecordingActionCode);
+	}
+}
+
+void RemoteSyncClient::checkStatus() {
+	if (isConnected()) {
+		sendRequest(RemoteConnectionManager::StatusActionCode);
+	}
+}
+
 void RemoteSyncClient::setSaveFolder(QString folder) {
 	if (isConnected()) {
 		sendRequest(RemoteConnectionManager::SetSaveFolderActionCode, folder.toUtf8());
@@ -264,6 +293,16 @@ void RemoteSyncClient::setTimeSource(QString addr, quint16 port) {
 		sendRequest(RemoteConnectionManager::TimeSourceActionCode, QString("%1 %2").arg(addr).arg(port));
 	}
 }
+void RemoteSyncClient::setStreamProfile(int cameraNum, QString stream, QString profile) {
+	if (isConnected()) {
+		sendRequest(RemoteConnectionManager::StreamProfileActionCode, QString("%1 %2 %3").arg(cameraNum).arg(stream).arg(profile));
+	}
+}
+void RemoteSyncClient::checkStreamProfiles(int cameraNum) {
+	if (isConnected()) {
+		sendRequest(RemoteConnectionManager::StreamProfileActionCode, QString("%1").arg(cameraNum));
+	}
+}
 
 QString RemoteSyncClient::getHost() const {
 	return _socket->peerName();
@@ -302,7 +341,7 @@ void RemoteSyncClient::sendRequest(QByteArray type, QString msg) {
 		QByteArray end(&code,1);
 		req += end;
 
-		qDebug() << "ready to send request: " << req;
+		qCDebug(lcRemote) << "Sending request" << req.left(RemoteConnectionManager::actionCodeBytes) << "of" << req.size() << "bytes";
 
 		_socket->write(req);
 		_socket->flush();
@@ -343,20 +382,35 @@ void RemoteSyncClient::manageStopRecordActionAnswer(bool status_ok, QDateTime co
 }
 void RemoteSyncClient::manageIsRecordingActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg) {
 
-	Q_UNUSED(msg);
-
 	QTextStream out(stdout);
 
-	out << "Is recording action answer received! Status is : " << ((status_ok) ? "ok" : "error") << "\n\t";
-	out << "Server time was :" << serverTime.toString() << endl;
+	out << "Is recording action answer received from " << getHost() << "! Status is : " << ((status_ok) ? "ok" : "error") << "\n\t";
+	out << "Server time was :" << serverTime.toString();
+
+	QStringList fields = QString::fromUtf8(msg).split(' ', QString::SkipEmptyParts);
+
+	if (fields.size() >= 1) {
+		out << "\n\t" << "Saving frames: " << ((fields[0] == "y") ? "yes" : "no");
+	}
+
+	if (fields.size() >= 3) {
+		bool ok;
+		double remaining = fields[1].toDouble(&ok);
+		out << "\n\t" << "Remaining recording time: " << formatDuration((ok) ? remaining : -1);
+		out << "\n\t" << "Sustainable: " << ((fields[2] == "s") ? "yes" : "no");
+	}
+
+	if (fields.size() >= 5) { //older servers do not send the session catalog counts.
+		out << "\n\t" << "Session catalog: " << fields[3] << " framesets, " << fields[4] << " frames";
+	}
+
+	out << endl;
 
 }
 void RemoteSyncClient::manageTimeMeasureActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg) {
 
-	qDebug() << "manageTimeMeasureAction answer received from "
-			 << _socket->peerName()
-			 << " [" << _socket->peerAddress().toString() << "]: "
-			 << msg;
+	qCDebug(lcRemote) << "Time measure answer received from" << _socket->peerName()
+					  << "[" << _socket->peerAddress().toString() << "]";
 
 	qint64 now_ms = QDateTime::currentDateTimeUtc().currentMSecsSinceEpoch();
 
@@ -377,6 +431,25 @@ void RemoteSyncClient::manageTimeMeasureActionAnswer(bool status_ok, QDateTime c
 						   now_ms);
 	}
 }
+void RemoteSyncClient::manageStreamProfileActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg) {
+
+	QTextStream out(stdout);
+
+	out << "Stream profile action answer received from " << getHost() << "! Status is : " << ((status_ok) ? "ok" : "error") << "\n\t";
+	out << "Server time was :" << serverTime.toString();
+
+	for (QString const& item : QString::fromUtf8(msg).split(';', QString::SkipEmptyParts)) {
+		out << "\n\t" << item;
+	}
+
+	out << endl;
+}
+
+void RemoteSyncClient::manageStatusActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg) {
+
+	// older servers answer the unknown action code with an error.
+	Q_EMIT statusReceived(getHost(), serverTime.toMSecsSinceEpoch(), (status_ok) ? QString::fromUtf8(msg) : QString());
+}
 
 void RemoteSyncClient::manageInvalidAnswer() {
 
@@ -20,6 +20,8 @@ public:
 	bool isConnected() const;
 
 	void checkConnectionTime();
+	void checkRecordingStatus();
+	void checkStatus();
 
 	void setSaveFolder(QString folder);
 	void startRecording(int cameraNum);
@@ -30,6 +32,8 @@ public:
 	void stopRecording();
 	void triggerExport();
 	void setTimeSource(QString addr, quint16 port);
+	void setStreamProfile(int cameraNum, QString stream, QString profile);
+	void checkStreamProfiles(int cameraNum);
 
 	QString getHost() const;
 	QString getDescr() const;
@@ -42,6 +46,11 @@ Q_SIGNALS:
 							qint64 sent_ms,
 							qint64 server_ms,
 							qint64 now_ms);
+	/*!
+	 * \brief statusReceived is emitted with the answer to checkStatus.
+	 * \param status the status line (see StatusSnapshot::toLine), empty if the server could not give it.
+	 */
+	void statusReceived(QString peerName, qint64 server_ms, QString status);
 
 protected:
 
@@ -55,6 +64,8 @@ protected:
 	void manageStopRecordActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg);
 	void manageIsRecordingActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg);
 	void manageTimeMeasureActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg);
+	void manageStreamProfileActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg);
+	void manageStatusActionAnswer(bool status_ok, QDateTime const& serverTime, QByteArray const& msg);
 
 	void manageInvalidAnswer();
 	void manageFailingConnection();
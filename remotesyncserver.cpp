@@ -4,6 +4,7 @@
 #include <QDateTime>
 
 #include "cameraapplication.h"
+#include "logging.h"
 
 const int RemoteConnectionManager::MaxMessageSize = 256;
 
@@ -21,6 +22,8 @@ const QByteArray RemoteConnectionManager::ExportRecordActionCode = QByteArray("x
 const QByteArray RemoteConnectionManager::IsRecordingActionCode = QByteArray("ircd",4); //is recording
 const QByteArray RemoteConnectionManager::TimeMeasureActionCode = QByteArray("ttdm",4); //transit time delay measure
 const QByteArray RemoteConnectionManager::TimeSourceActionCode = QByteArray("tsst",4); //transit time delay measure
+const QByteArray RemoteConnectionManager::StreamProfileActionCode = QByteArray("strp",4); //stream profile
+const QByteArray RemoteConnectionManager::StatusActionCode = QByteArray("stat",4); //status
 
 RemoteConnectionManager::RemoteConnectionManager(RemoteSyncServer *server, QTcpSocket* socket) :
 	QObject(server),
@@ -50,8 +53,6 @@ void RemoteConnectionManager::collectData() {
 
 		_messageBuffer += _socket->read(MaxMessageSize);
 
-		qDebug() << "Message buffer grows: " << _messageBuffer;
-
 		while (_messageBufferCurrentMessagePos != _messageBuffer.size()) {
 
 			if (_messageBuffer[_messageBufferCurrentMessagePos] == EndMsgSymbol) {
@@ -60,15 +61,13 @@ void RemoteConnectionManager::collectData() {
 				_messageBuffer = _messageBuffer.mid(_messageBufferCurrentMessagePos+1);
 				_messageBufferCurrentMessagePos = -1;
 
-				qDebug() << "Message buffer after treating request: " << _messageBuffer << " pos: " << _messageBufferCurrentMessagePos;
-
 			} else if (_messageBufferCurrentMessagePos == MaxMessageSize-1) {
 
 				_messageBuffer = _messageBuffer.mid(_messageBufferCurrentMessagePos+1);
 				_messageBufferCurrentMessagePos = -1;
 				manageInvalidRequest();
 
-				qDebug() << "Message buffer after invalid request: " << _messageBuffer << " pos: " << _messageBufferCurrentMessagePos;
+				qCWarning(lcRemote) << "Request longer than" << MaxMessageSize << "bytes from" << _socket->peerAddress().toString() << "discarded";
 
 			}
 
@@ -97,7 +96,7 @@ void RemoteConnectionManager::treatRequest() {
 
 	QByteArray actionCode = msg.left(actionCodeBytes);
 
-	qDebug() << "Request received for: " << actionCode;
+	qCDebug(lcRemote) << "Request received:" << actionCode << "with" << msg.size() - actionCode.size() << "bytes of parameters";
 
 	if (actionCode == SetSaveFolderActionCode) {
 		manageSetSaveFolderActionRequest(msg.mid(actionCodeBytes));
@@ -134,6 +133,11 @@ void RemoteConnectionManager::treatRequest() {
 		return;
 	}
 
+	if (actionCode == IsRecordingActionCode) {
+		manageIsRecordingActionRequest(msg.mid(actionCodeBytes));
+		return;
+	}
+
 	if (actionCode == TimeMeasureActionCode) {
 		manageTimeMeasureActionRequest(msg.mid(actionCodeBytes));
 		return;
@@ -144,6 +148,16 @@ void RemoteConnectionManager::treatRequest() {
 		return;
 	}
 
+	if (actionCode == StreamProfileActionCode) {
+		manageStreamProfileActionRequest(msg.mid(actionCodeBytes));
+		return;
+	}
+
+	if (actionCode == StatusActionCode) {
+		manageStatusActionRequest(msg.mid(actionCodeBytes));
+		return;
+	}
+
 	// if request code not recognized
 	manageInvalidRequest();
 }
@@ -162,7 +176,7 @@ void RemoteConnectionManager::manageStartRecordActionRequest(QByteArray const& m
 	bool ok;
     int camNum = data.toInt(&ok, 10);
 
-    qDebug() << "Start recording action request received with message: " << msg << " camNum: " << camNum << " status: " << ok;
+	qCDebug(lcRemote) << "Start recording with camera" << camNum << "valid:" << ok;
 
 	if (ok) {
 		_server->startRecording(camNum);
@@ -184,7 +198,7 @@ void RemoteConnectionManager::manageSaveImagesActionRequest(QByteArray const& ms
 		nFrames = -1;
 	}
 
-	qDebug() << "Frame save action request received with message: " << msg << " nFrames: " << ((nFrames > 0) ? QString("%1").arg(nFrames) : "infinity") << " status: " << ok;
+	qCDebug(lcRemote) << "Save frames:" << nFrames << "(-1 for continuous) valid:" << ok;
 
 	if (ok) {
 		if (nFrames > 0) {
@@ -200,8 +214,6 @@ void RemoteConnectionManager::manageSaveImagesActionRequest(QByteArray const& ms
 }
 void RemoteConnectionManager::manageStopSaveImagesActionRequest(QByteArray const& msg) {
 
-	qDebug() << "Stop saving images action request received with message: " << msg;
-
 	Q_UNUSED(msg);
 	_server->stopSaveImagesRecording();
 	sendAnswer(true);
@@ -209,8 +221,6 @@ void RemoteConnectionManager::manageStopSaveImagesActionRequest(QByteArray const
 }
 void RemoteConnectionManager::manageStopRecordActionRequest(QByteArray const& msg) {
 
-    qDebug() << "Stop recording action request received with message: " << msg;
-
 	Q_UNUSED(msg);
 	_server->stopRecording();
 	sendAnswer(true);
@@ -221,7 +231,7 @@ void RemoteConnectionManager::manageInfraRedPatternActionRequest(QByteArray cons
 
 	QString data = QString::fromUtf8(msg);
 
-	qDebug() << "Infrared pattern action request received with message: " << msg;
+	qCDebug(lcRemote) << "Infrared pattern:" << data;
 
 	if (data.toLower() == "on") {
 		_server->setInfraRedPatternOn(true);
@@ -237,8 +247,6 @@ void RemoteConnectionManager::manageInfraRedPatternActionRequest(QByteArray cons
 
 void RemoteConnectionManager::manageExportRecordActionRequest(QByteArray const& msg) {
 
-	qDebug() << "Export recording action request received with message: " << msg;
-
 	Q_UNUSED(msg);
 	_server->exportRecorded();
 	sendAnswer(true);
@@ -246,8 +254,6 @@ void RemoteConnectionManager::manageExportRecordActionRequest(QByteArray const&
 
 void RemoteConnectionManager::manageTimeMeasureActionRequest(QByteArray const& msg) {
 
-	qDebug() << "Timing action request received with message: " << msg;
-
 	QByteArray ans = msg;
 
 	sendAnswer(true, ans);
@@ -255,8 +261,6 @@ void RemoteConnectionManager::manageTimeMeasureActionRequest(QByteArray const& m
 
 void RemoteConnectionManager::manageTimeSourceActionRequest(QByteArray const& msg) {
 
-	qDebug() << "Time source request received with message: " << msg;
-
 	QString params = QString::fromUtf8(msg);
 
 	QStringList split = params.split(' ', QString::SplitBehavior::SkipEmptyParts);
@@ -287,13 +291,58 @@ void RemoteConnectionManager::manageTimeSourceActionRequest(QByteArray const& ms
 
 }
 
+void RemoteConnectionManager::manageStreamProfileActionRequest(QByteArray const& msg) {
+
+	// format is: <camNum> to get the profiles, <camNum> <stream> <profile> to set the profile of a stream.
+	QStringList split = QString::fromUtf8(msg).split(' ', QString::SplitBehavior::SkipEmptyParts);
+
+	if (split.isEmpty()) {
+		sendAnswer(false);
+		return;
+	}
+
+	bool ok = true;
+	int camNum = split[0].toInt(&ok, 10);
+
+	if (!ok) {
+		sendAnswer(false);
+		return;
+	}
+
+	CameraApplication* app = CameraApplication::GetCameraApp();
+	QString profiles;
+
+	if (split.size() >= 3) {
+		QString stream = split[1];
+		QString profile = QStringList(split.mid(2)).join(' ');
+
+		// the profiles are validated against the device by the application thread, so that the answer tells if the profile was accepted.
+		QMetaObject::invokeMethod(app, [app, camNum, stream, profile, &ok] () {
+			ok = app->setStreamProfile(camNum, stream, profile);
+		}, Qt::BlockingQueuedConnection);
+	} else if (split.size() != 1) {
+		ok = false;
+	}
+
+	if (ok) {
+		QMetaObject::invokeMethod(app, [app, camNum, &profiles] () {
+			profiles = app->streamProfilesDescr(camNum);
+		}, Qt::BlockingQueuedConnection);
+	}
+
+	sendAnswer(ok and !profiles.isEmpty(), profiles);
+}
+
 void RemoteConnectionManager::manageIsRecordingActionRequest(QByteArray const& msg) {
 	Q_UNUSED(msg);
 
-	char status = (_server->appIsRecording()) ? 'y' : 'n';
-	QByteArray ans(&status,1);
+	sendAnswer(true, _server->appRecordingStatus());
+}
+
+void RemoteConnectionManager::manageStatusActionRequest(QByteArray const& msg) {
+	Q_UNUSED(msg);
 
-	sendAnswer(true, ans);
+	sendAnswer(true, _server->appStatus());
 }
 
 void RemoteConnectionManager::manageInvalidRequest() {
@@ -321,7 +370,7 @@ void RemoteConnectionManager::sendAnswer(bool ok, QString msg) {
 	QByteArray end(&code,1);
 	ans += end;
 
-	qDebug() << "Sending answer: " << ans;
+	qCDebug(lcRemote) << "Sending answer" << ans.left(1) << "of" << ans.size() << "bytes";
 
 	_socket->write(ans);
 }
@@ -338,6 +387,24 @@ bool RemoteSyncServer::appIsRecording() const {
 }
 
 
+QString RemoteSyncServer::appRecordingStatus() const {
+
+	// format is: <is recording y/n> <remaining time in s, -1 if unknown> <sustainable s/u> <framesets in the session catalog> <frames in the session catalog>
+	RecordingMonitor::Estimate estimate = CameraApplication::GetCameraApp()->recordingEstimate();
+	SessionCatalog::Stats catalogStats = CameraApplication::GetCameraApp()->sessionCatalogStats();
+
+	return QString("%1 %2 %3 %4 %5")
+			.arg((appIsRecording()) ? 'y' : 'n')
+			.arg(static_cast<qint64>(estimate.remainingSeconds))
+			.arg((estimate.sustainable) ? 's' : 'u')
+			.arg(catalogStats.frameSets)
+			.arg(catalogStats.frames);
+}
+
+QString RemoteSyncServer::appStatus() const {
+	return CameraApplication::GetCameraApp()->statusSnapshot().toLine();
+}
+
 void RemoteSyncServer::manageNewPendingConnection() {
 
 	QTcpSocket* socket = nextPendingConnection();
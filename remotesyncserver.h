@@ -25,6 +25,8 @@ public:
 	static const QByteArray IsRecordingActionCode;
 	static const QByteArray TimeMeasureActionCode;
 	static const QByteArray TimeSourceActionCode;
+	static const QByteArray StreamProfileActionCode;
+	static const QByteArray StatusActionCode;
 
 	explicit RemoteConnectionManager(RemoteSyncServer* server, QTcpSocket* socket);
 
@@ -47,6 +49,8 @@ protected:
 	void manageIsRecordingActionRequest(QByteArray const& msg);
 	void manageTimeMeasureActionRequest(QByteArray const& msg);
 	void manageTimeSourceActionRequest(QByteArray const& msg);
+	void manageStreamProfileActionRequest(QByteArray const& msg);
+	void manageStatusActionRequest(QByteArray const& msg);
 
 	void manageInvalidRequest();
 
@@ -71,6 +75,11 @@ public:
 	explicit RemoteSyncServer(QObject *parent = nullptr);
 
 	bool appIsRecording() const;
+	QString appRecordingStatus() const;
+	/*!
+	 * \brief appStatus give the status snapshot of the application, see StatusSnapshot::toLine for the format.
+	 */
+	QString appStatus() const;
 
 Q_SIGNALS:
 
@@ -0,0 +1,266 @@
+#include "sessioncatalog.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+
+const QString SessionCatalog::catalogsFolderName = "sessions";
+const QString SessionCatalog::catalogExtension = ".catalog";
+const QString SessionCatalog::crc32cKey = "crc32c";
+
+const qint64 SessionCatalog::frameSetsWindow = 256;
+
+namespace {
+
+const int nFields = 6;
+
+QByteArray encodeString(QString const& txt) {
+	return txt.toUtf8().toPercentEncoding();
+}
+
+QString decodeString(QByteArray const& data) {
+	return QString::fromUtf8(QByteArray::fromPercentEncoding(data));
+}
+
+} // namespace
+
+bool SessionCatalog::Index::load(QString const& catalogPath) {
+
+	_entries.clear();
+	_frameSetIds.clear();
+	_frameSets.clear();
+	_files.clear();
+
+	QFileInfo catalogInfo(catalogPath);
+	_framesFolder = QDir(catalogInfo.absoluteDir().filePath(".."));
+
+	QFile catalog(catalogPath);
+
+	if (!catalog.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	QByteArray line = catalog.readLine();
+
+	while (!line.isEmpty()) {
+
+		Entry entry;
+
+		if (decodeLine(line, entry)) {
+
+			int id = _entries.size();
+
+			auto frameSet = _frameSets.find(entry.frameSetId);
+
+			if (frameSet == _frameSets.end()) {
+				_frameSetIds.push_back(entry.frameSetId);
+				frameSet = _frameSets.insert(entry.frameSetId, QVector<int>());
+			}
+
+			frameSet->push_back(id);
+			_files.insert(entry.fileName, id);
+			_entries.push_back(entry);
+		}
+
+		line = catalog.readLine();
+	}
+
+	return true;
+}
+
+QVector<SessionCatalog::Entry> SessionCatalog::Index::frameSet(qint64 frameSetId) const {
+
+	QVector<Entry> ret;
+
+	for (int id : _frameSets.value(frameSetId)) {
+		ret.push_back(_entries[id]);
+	}
+
+	return ret;
+}
+
+bool SessionCatalog::Index::find(QString const& fileName, Entry & entry) const {
+
+	auto it = _files.constFind(fileName);
+
+	if (it == _files.constEnd()) {
+		return false;
+	}
+
+	entry = _entries[it.value()];
+	return true;
+}
+
+QString SessionCatalog::Index::framePath(Entry const& entry) const {
+	return QDir::cleanPath(_framesFolder.absoluteFilePath(entry.fileName));
+}
+
+SessionCatalog::SessionCatalog(QString const& catalogPath, int batchSize) :
+	_file(catalogPath),
+	_nPending(0),
+	_batchSize(std::max(1, batchSize)),
+	_stats{0, 0, 0},
+	_lastFrameSetId(-1)
+{
+
+}
+
+SessionCatalog::~SessionCatalog() {
+	flush();
+}
+
+QString SessionCatalog::catalogPath() const {
+	return _file.fileName();
+}
+
+void SessionCatalog::append(Entry const& entry) {
+
+	QMutexLocker locker(&_mutex);
+
+	_pending += encodeLine(entry);
+	_nPending++;
+
+	_stats.frames++;
+	_stats.bytes += entry.bytes;
+
+	if (entry.frameSetId > _lastFrameSetId - frameSetsWindow and !_recentFrameSetIds.contains(entry.frameSetId)) {
+		_recentFrameSetIds.insert(entry.frameSetId);
+		_stats.frameSets++;
+	}
+
+	if (entry.frameSetId > _lastFrameSetId) {
+		_lastFrameSetId = entry.frameSetId;
+
+		if (_recentFrameSetIds.size() > 2*frameSetsWindow) {
+			for (auto it = _recentFrameSetIds.begin(); it != _recentFrameSetIds.end();) {
+				if (*it <= _lastFrameSetId - frameSetsWindow) {
+					it = _recentFrameSetIds.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+	}
+
+	if (_nPending >= _batchSize) {
+		locker.unlock();
+		flush();
+	}
+}
+
+bool SessionCatalog::flush() {
+
+	QMutexLocker locker(&_mutex);
+
+	if (_pending.isEmpty()) {
+		return true;
+	}
+
+	if (!_file.isOpen()) {
+
+		QFileInfo catalogInfo(_file.fileName());
+		catalogInfo.absoluteDir().mkpath(".");
+
+		if (!_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+			return false;
+		}
+	}
+
+	bool ok = _file.write(_pending) == _pending.size();
+	ok = ok and _file.flush();
+
+	_pending.clear();
+	_nPending = 0;
+
+	return ok;
+}
+
+SessionCatalog::Stats SessionCatalog::stats() const {
+	QMutexLocker locker(&_mutex);
+	return _stats;
+}
+
+QString SessionCatalog::catalogPathForSession(QDir const& outputFolder, QString const& sessionId) {
+	return outputFolder.filePath(catalogsFolderName + "/session_" + sessionId + catalogExtension);
+}
+
+QStringList SessionCatalog::listCatalogs(QDir const& outputFolder) {
+
+	QDir catalogsFolder(outputFolder.filePath(catalogsFolderName));
+
+	if (!catalogsFolder.exists()) {
+		return QStringList();
+	}
+
+	QStringList ret;
+
+	// the session ids are timestamps, so the name order is the chronological order.
+	for (QString const& catalog : catalogsFolder.entryList({"*" + catalogExtension}, QDir::Files, QDir::Name)) {
+		ret << catalogsFolder.filePath(catalog);
+	}
+
+	return ret;
+}
+
+QByteArray SessionCatalog::encodeLine(Entry const& entry) {
+
+	QByteArray line = QByteArray::number(entry.frameSetId);
+	line += '\t';
+	line += encodeString(entry.stream);
+	line += '\t';
+	line += encodeString(entry.fileName);
+	line += '\t';
+	line += QByteArray::number(entry.offset);
+	line += '\t';
+	line += QByteArray::number(entry.bytes);
+	line += '\t';
+	line += QByteArray::number(entry.timeMs);
+
+	for (auto it = entry.metadata.constBegin(); it != entry.metadata.constEnd(); ++it) {
+		line += '\t';
+		line += encodeString(it.key());
+		line += '=';
+		line += encodeString(it.value());
+	}
+
+	line += '\n';
+
+	return line;
+}
+
+bool SessionCatalog::decodeLine(QByteArray const& line, Entry & entry) {
+
+	QList<QByteArray> fields = line.trimmed().split('\t');
+
+	if (fields.size() < nFields) {
+		return false;
+	}
+
+	bool ok1, ok2, ok3, ok4;
+
+	entry.frameSetId = fields[0].toLongLong(&ok1);
+	entry.stream = decodeString(fields[1]);
+	entry.fileName = decodeString(fields[2]);
+	entry.offset = fields[3].toLongLong(&ok2);
+	entry.bytes = fields[4].toLongLong(&ok3);
+	entry.timeMs = fields[5].toLongLong(&ok4);
+
+	if (!ok1 or !ok2 or !ok3 or !ok4 or entry.fileName.isEmpty()) {
+		return false;
+	}
+
+	entry.metadata.clear();
+
+	for (int i = nFields; i < fields.size(); i++) {
+
+		int sep = fields[i].indexOf('=');
+
+		if (sep < 0) {
+			return false;
+		}
+
+		entry.metadata.insert(decodeString(fields[i].left(sep)), decodeString(fields[i].mid(sep+1)));
+	}
+
+	return true;
+}
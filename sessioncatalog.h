@@ -0,0 +1,140 @@
+#ifndef SESSIONCATALOG_H
+#define SESSIONCATALOG_H
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QFile>
+#include <QDir>
+#include <QMutex>
+
+/*!
+ * \brief The SessionCatalog class index the frames saved during a recording session.
+ *
+ * The catalog is an append-only text file, stored in the sessions subfolder of the output folder, with one line per frame:
+ * the frameset id, the stream, the frame file name (relative to the output folder), the offset of the frame in the file,
+ * its size, the frameset timestamp and tab separated key=value metadata (strings are percent encoded).
+ * Lines are accumulated in memory and appended to the file in batches, like the infos tables.
+ *
+ * Export, replay and status queries read the catalogs instead of listing the output folder, which can hold millions of files.
+ */
+class SessionCatalog
+{
+public:
+
+	static const QString catalogsFolderName;
+	static const QString catalogExtension;
+	static const QString crc32cKey; //!< the metadata holding the checksum of the pixels of the frames not stored as raw frames.
+
+	struct Entry {
+
+		Entry() :
+			frameSetId(-1),
+			offset(0),
+			bytes(0),
+			timeMs(0)
+		{
+
+		}
+
+		qint64 frameSetId;
+		QString stream;
+		QString fileName;
+		qint64 offset; //!< the offset of the pixels in the file (the header size for raw frames, 0 for the other formats).
+		qint64 bytes; //!< the size of the pixels, before any encoding.
+		qint64 timeMs;
+		QMap<QString, QString> metadata;
+	};
+
+	struct Stats {
+		qint64 frameSets;
+		qint64 frames;
+		qint64 bytes;
+	};
+
+	/*!
+	 * \brief The Index class hold a catalog in memory, with constant time lookups by frameset id and by file name.
+	 */
+	class Index
+	{
+	public:
+
+		bool load(QString const& catalogPath);
+
+		inline int size() const { return _entries.size(); }
+		inline QVector<Entry> const& entries() const { return _entries; }
+
+		/*!
+		 * \brief frameSetIds give the ids of the framesets, in the order they have been saved.
+		 */
+		inline QVector<qint64> const& frameSetIds() const { return _frameSetIds; }
+
+		/*!
+		 * \brief frameSet give the entries of all the streams of a frameset.
+		 */
+		QVector<Entry> frameSet(qint64 frameSetId) const;
+		bool find(QString const& fileName, Entry & entry) const;
+
+		/*!
+		 * \brief framePath give the absolute path of the file of an entry.
+		 */
+		QString framePath(Entry const& entry) const;
+
+	protected:
+
+		QDir _framesFolder;
+		QVector<Entry> _entries;
+		QVector<qint64> _frameSetIds;
+		QHash<qint64, QVector<int>> _frameSets;
+		QHash<QString, int> _files;
+	};
+
+	SessionCatalog(QString const& catalogPath, int batchSize = 64);
+	~SessionCatalog();
+
+	QString catalogPath() const;
+
+	void append(Entry const& entry);
+
+	/*!
+	 * \brief flush write the pending lines to disk.
+	 * \return false if the catalog could not be written.
+	 */
+	bool flush();
+
+	Stats stats() const;
+
+	/*!
+	 * \brief catalogPathForSession give the path of the catalog of a session saved in outputFolder.
+	 */
+	static QString catalogPathForSession(QDir const& outputFolder, QString const& sessionId);
+	/*!
+	 * \brief listCatalogs list the catalogs of the sessions saved in outputFolder, oldest first.
+	 *
+	 * Only the sessions subfolder is listed, not the frames.
+	 */
+	static QStringList listCatalogs(QDir const& outputFolder);
+
+	static QByteArray encodeLine(Entry const& entry);
+	static bool decodeLine(QByteArray const& line, Entry & entry);
+
+protected:
+
+	static const qint64 frameSetsWindow;
+
+	mutable QMutex _mutex;
+
+	QFile _file;
+	QByteArray _pending;
+	int _nPending;
+	int _batchSize;
+
+	Stats _stats;
+	qint64 _lastFrameSetId;
+	QSet<qint64> _recentFrameSetIds; //!< the parts of a frameset may be saved out of order, from different threads.
+};
+
+#endif // SESSIONCATALOG_H
@@ -0,0 +1,592 @@
+#include "sessionjournal.h"
+
+#include "imageframe.h"
+#include "sessioncatalog.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+const QString SessionJournal::journalExtension = ".journal";
+
+namespace {
+
+const QByteArray openRecord = "open";
+const QByteArray fileRecord = "file";
+const QByteArray checkpointRecord = "checkpoint";
+const QByteArray closeRecord = "close";
+const QByteArray recoveredRecord = "recovered";
+
+const QString frameTimestampFormat = "yyyy_MM_dd_hh_mm_ss_zzz";
+
+QByteArray encodeString(QString const& txt) {
+	return txt.toUtf8().toPercentEncoding();
+}
+
+QString decodeString(QByteArray const& data) {
+	return QString::fromUtf8(QByteArray::fromPercentEncoding(data));
+}
+
+/*!
+ * \brief frameSetNameOf give the name of a frame without its stream, shared by all the frames of its frameset.
+ */
+QString frameSetNameOf(QString const& frameFileName) {
+	QString baseName = QFileInfo(frameFileName).baseName();
+	return baseName.left(baseName.lastIndexOf('_'));
+}
+
+QString readFirstFrameName(QString const& journalPath) {
+
+	QFile journal(journalPath);
+
+	if (!journal.open(QIODevice::ReadOnly)) {
+		return QString();
+	}
+
+	QList<QByteArray> fields = journal.readLine().trimmed().split('\t');
+
+	if (fields.size() < 2 or fields[0] != openRecord) {
+		return QString();
+	}
+
+	return decodeString(fields[1]);
+}
+
+/*!
+ * \brief truncatePartialRecord cut a text file after its last complete line.
+ * \return true if the file ended with a partial line.
+ */
+bool truncatePartialRecord(QString const& path) {
+
+	QFile file(path);
+
+	if (!file.exists() or !file.open(QIODevice::ReadWrite)) {
+		return false;
+	}
+
+	const qint64 size = file.size();
+	const qint64 blockSize = 4096;
+	qint64 end = size;
+
+	while (end > 0) {
+
+		qint64 start = std::max<qint64>(0, end - blockSize);
+
+		file.seek(start);
+		QByteArray block = file.read(end - start);
+		int pos = block.lastIndexOf('\n');
+
+		if (pos >= 0) {
+			qint64 keep = start + pos + 1;
+			return keep != size and file.resize(keep);
+		}
+
+		end = start;
+	}
+
+	return size > 0 and file.resize(0);
+}
+
+/*!
+ * \brief checkFrameFile check that a frame has been completely written, and fill the size and metadata of its catalog entry.
+ */
+bool checkFrameFile(QString const& path, SessionCatalog::Entry & entry) {
+
+	QFileInfo info(path);
+
+	if (!info.exists()) {
+		return false;
+	}
+
+	if (!path.endsWith(ImageFrame::rawFrameExtension)) {
+		// the other formats are written in one go by LibStevi, only the frames which have not been written at all are detected.
+		entry.offset = 0;
+		return info.size() > 0;
+	}
+
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	QByteArray header = file.read(ImageFrame::rawHeaderBytes);
+	ImageFrame::RawLayout layout;
+
+	if (header.size() != static_cast<int>(ImageFrame::rawHeaderBytes) or
+			!ImageFrame::readRawLayout(reinterpret_cast<uint8_t const*>(header.constData()), layout)) {
+		return false;
+	}
+
+	if (static_cast<quint64>(info.size()) < ImageFrame::rawHeaderBytes + layout.payloadBytes) {
+		return false;
+	}
+
+	entry.offset = static_cast<qint64>(ImageFrame::rawHeaderBytes);
+	entry.bytes = static_cast<qint64>(layout.height)*layout.width*layout.channels*layout.elementBytes;
+
+	entry.metadata.insert("width", QString::number(layout.width));
+	entry.metadata.insert("height", QString::number(layout.height));
+	entry.metadata.insert("channels", QString::number(layout.channels));
+	entry.metadata.insert("type", QString::number(layout.type));
+
+	if (layout.encoding != ImageFrame::RawPlain) {
+		entry.metadata.insert("encoding", QString::number(layout.encoding));
+	}
+
+	return true;
+}
+
+} // namespace
+
+SessionJournal::SessionJournal(QString const& journalPath, Config const& config, QObject *parent) :
+	QThread(parent),
+	_config(config),
+	_durableFrames(0),
+	_continue(true),
+	_file(journalPath)
+{
+	_framesFolder = QDir(QFileInfo(journalPath).absoluteDir().filePath(".."));
+}
+
+SessionJournal::~SessionJournal() {
+	close();
+}
+
+QString SessionJournal::journalPathForSession(QDir const& outputFolder, QString const& sessionId) {
+	return outputFolder.filePath(SessionCatalog::catalogsFolderName + "/session_" + sessionId + journalExtension);
+}
+
+void SessionJournal::setCheckpointCallback(CheckpointCallback const& callback) {
+	_checkpointCallback = callback;
+}
+
+bool SessionJournal::open(QString const& firstFrameName) {
+
+	QFileInfo journalInfo(_file.fileName());
+	journalInfo.absoluteDir().mkpath(".");
+
+	QMutexLocker locker(&_fileMutex);
+
+	if (!_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		return false;
+	}
+
+	locker.unlock();
+
+	QByteArray record = openRecord + '\t' + encodeString(firstFrameName) + '\t' + QByteArray::number(QDateTime::currentMSecsSinceEpoch());
+
+	if (!appendRecord(record)) {
+		return false;
+	}
+
+	// the journal must be found after a crash, so its directory entry is made durable too.
+	syncFile(journalInfo.absolutePath());
+
+	start();
+	return true;
+}
+
+void SessionJournal::addSessionFile(QString const& filePath) {
+
+	{
+		QMutexLocker locker(&_mutex);
+
+		if (_sessionFiles.contains(filePath)) {
+			return;
+		}
+
+		_sessionFiles << filePath;
+	}
+
+	appendRecord(fileRecord + '\t' + encodeString(_framesFolder.relativeFilePath(filePath)));
+}
+
+void SessionJournal::frameWritten(QString const& framePath, bool ok) {
+
+	if (!ok) {
+		return;
+	}
+
+	QMutexLocker locker(&_mutex);
+
+	_written << framePath;
+
+	if (_written.size() >= _config.checkpointFrames) {
+		_workAvailable.wakeOne();
+	}
+}
+
+void SessionJournal::frameRemoved(QString const& framePath) {
+	QMutexLocker locker(&_mutex);
+	_written.removeOne(framePath);
+}
+
+void SessionJournal::close() {
+
+	{
+		QMutexLocker locker(&_mutex);
+
+		if (!_continue) {
+			return;
+		}
+
+		_continue = false;
+		_workAvailable.wakeAll();
+	}
+
+	wait();
+
+	if (!_file.isOpen()) {
+		return;
+	}
+
+	// if the last checkpoint fails, the session is left open, to be checked by the recovery.
+	if (checkpoint()) {
+		appendRecord(closeRecord + '\t' + QByteArray::number(durableFrames()));
+	}
+
+	QMutexLocker locker(&_fileMutex);
+	_file.close();
+}
+
+qint64 SessionJournal::durableFrames() const {
+	QMutexLocker locker(&_mutex);
+	return _durableFrames;
+}
+
+void SessionJournal::run() {
+
+	QElapsedTimer sinceCheckpoint;
+	sinceCheckpoint.start();
+
+	QMutexLocker locker(&_mutex);
+
+	while (_continue) {
+
+		qint64 remainingMs = _config.checkpointIntervalMs - sinceCheckpoint.elapsed();
+
+		if (_written.size() < _config.checkpointFrames and remainingMs > 0) {
+			_workAvailable.wait(&_mutex, static_cast<unsigned long>(remainingMs));
+			continue;
+		}
+
+		locker.unlock();
+
+		if (!checkpoint()) {
+			QTextStream err(stderr);
+			err << "Failed to sync the recorded frames at checkpoint, in " << _framesFolder.absolutePath() << endl;
+		}
+
+		sinceCheckpoint.restart();
+		locker.relock();
+	}
+}
+
+bool SessionJournal::checkpoint() {
+
+	// the catalog is flushed first: the frames of its records have all been notified, and are part of this checkpoint.
+	qint64 records = (_checkpointCallback) ? _checkpointCallback() : 0;
+
+	if (records < 0) {
+		return false;
+	}
+
+	QStringList written;
+	QStringList sessionFiles;
+
+	{
+		QMutexLocker locker(&_mutex);
+		written.swap(_written);
+		sessionFiles = _sessionFiles;
+	}
+
+	bool ok = true;
+
+	if (_config.durability == "syncfs") {
+		ok = syncFileSystem(_framesFolder.absolutePath());
+	} else if (_config.durability == "fdatasync") {
+
+		for (QString const& path : written) {
+			ok = syncFile(path) and ok;
+		}
+
+		for (QString const& path : sessionFiles) {
+			if (QFile::exists(path)) { //the session files are created with their first record.
+				ok = syncFile(path) and ok;
+			}
+		}
+
+		ok = syncFile(_framesFolder.absolutePath()) and ok; //the directory entries of the new files.
+	}
+
+	qint64 durable;
+
+	{
+		QMutexLocker locker(&_mutex);
+		_durableFrames += written.size();
+		durable = _durableFrames;
+	}
+
+	QByteArray record = checkpointRecord + '\t' + QByteArray::number(records) + '\t' + QByteArray::number(durable) +
+			'\t' + QByteArray::number(QDateTime::currentMSecsSinceEpoch());
+
+	return appendRecord(record) and ok;
+}
+
+bool SessionJournal::appendRecord(QByteArray const& record) {
+
+	QMutexLocker locker(&_fileMutex);
+
+	if (!_file.isOpen()) {
+		return false;
+	}
+
+	QByteArray line = record + '\n';
+
+	bool ok = _file.write(line) == line.size();
+	ok = ok and _file.flush();
+	ok = ok and (_config.durability == "none" or fdatasync(_file.handle()) == 0);
+
+	return ok;
+}
+
+bool SessionJournal::syncFile(QString const& path) {
+
+	int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		return errno == ENOENT; //removed since it was written, e.g. exported while recording.
+	}
+
+	bool ok = fdatasync(fd) == 0;
+	::close(fd);
+
+	return ok;
+}
+
+bool SessionJournal::syncFileSystem(QString const& path) {
+
+	int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	bool ok = syncfs(fd) == 0;
+	::close(fd);
+
+	return ok;
+}
+
+SessionJournal::RecoveryReport SessionJournal::recoverSessions(QDir const& outputFolder) {
+
+	RecoveryReport report{0, 0, 0, 0, 0};
+
+	QDir journalsFolder(outputFolder.filePath(SessionCatalog::catalogsFolderName));
+
+	if (!journalsFolder.exists()) {
+		return report;
+	}
+
+	QStringList journals = journalsFolder.entryList({"*" + journalExtension}, QDir::Files, QDir::Name);
+	QStringList firstFrameNames;
+
+	for (QString const& journal : journals) {
+		firstFrameNames << readFirstFrameName(journalsFolder.filePath(journal));
+	}
+
+	QStringList sessionsStarts = firstFrameNames;
+	std::sort(sessionsStarts.begin(), sessionsStarts.end());
+
+	for (int i = 0; i < journals.size(); i++) {
+
+		// the frames of a session precede the first frame of the next session recorded in the same folder.
+		auto next = std::upper_bound(sessionsStarts.begin(), sessionsStarts.end(), firstFrameNames[i]);
+		QString nextSessionStart = (next != sessionsStarts.end()) ? *next : QString();
+
+		recoverSession(journalsFolder.filePath(journals[i]), nextSessionStart, report);
+	}
+
+	return report;
+}
+
+void SessionJournal::recoverSession(QString const& journalPath, QString const& nextSessionStart, RecoveryReport & report) {
+
+	bool journalTruncated = truncatePartialRecord(journalPath);
+
+	QFile journal(journalPath);
+
+	if (!journal.open(QIODevice::ReadOnly)) {
+		return;
+	}
+
+	QString firstFrameName;
+	QStringList sessionFiles;
+	qint64 durableRecords = 0;
+	bool complete = false;
+
+	QDir framesFolder(QFileInfo(journalPath).absoluteDir().filePath(".."));
+
+	for (QByteArray line = journal.readLine(); !line.isEmpty(); line = journal.readLine()) {
+
+		QList<QByteArray> fields = line.trimmed().split('\t');
+
+		if (fields[0] == openRecord and fields.size() > 1) {
+			firstFrameName = decodeString(fields[1]);
+		} else if (fields[0] == fileRecord and fields.size() > 1) {
+			sessionFiles << QDir::cleanPath(framesFolder.absoluteFilePath(decodeString(fields[1])));
+		} else if (fields[0] == checkpointRecord and fields.size() > 1) {
+			durableRecords = fields[1].toLongLong();
+		} else if (fields[0] == closeRecord or fields[0] == recoveredRecord) {
+			complete = true;
+		}
+	}
+
+	journal.close();
+
+	if (complete) {
+		return;
+	}
+
+	report.sessions++;
+	report.truncatedFiles += (journalTruncated) ? 1 : 0;
+
+	for (QString const& path : sessionFiles) {
+		report.truncatedFiles += (truncatePartialRecord(path)) ? 1 : 0;
+	}
+
+	QString catalogPath = QFileInfo(journalPath).absoluteDir().filePath(QFileInfo(journalPath).completeBaseName() + SessionCatalog::catalogExtension);
+
+	report.truncatedFiles += (truncatePartialRecord(catalogPath)) ? 1 : 0;
+
+	qint64 kept = 0;
+	qint64 recovered = 0;
+	qint64 removed = 0;
+
+	QFile catalog(catalogPath);
+
+	if (catalog.exists()) {
+
+		if (!catalog.open(QIODevice::ReadOnly)) {
+			return;
+		}
+
+		QByteArray recoveredCatalog;
+		QSet<QString> cataloged;
+		QString lastFrameSetName = firstFrameName; //the frames of the last cataloged frameset may be missing from the catalog.
+		qint64 lastFrameSetId = -1;
+		qint64 nRecords = 0;
+		bool changed = false;
+
+		for (QByteArray line = catalog.readLine(); !line.isEmpty(); line = catalog.readLine(), nRecords++) {
+
+			SessionCatalog::Entry entry;
+
+			if (!SessionCatalog::decodeLine(line, entry)) {
+				changed = true;
+				continue;
+			}
+
+			QString framePath = QDir::cleanPath(framesFolder.absoluteFilePath(entry.fileName));
+
+			// the records preceding the last checkpoint reference durable frames, the following ones are checked.
+			if (nRecords >= durableRecords) {
+
+				SessionCatalog::Entry checked = entry;
+
+				if (!checkFrameFile(framePath, checked)) {
+					QFile::remove(framePath);
+					removed++;
+					changed = true;
+					continue;
+				}
+			}
+
+			recoveredCatalog += line;
+			cataloged.insert(QFileInfo(framePath).fileName());
+			lastFrameSetName = std::max(lastFrameSetName, frameSetNameOf(framePath));
+			lastFrameSetId = std::max(lastFrameSetId, entry.frameSetId);
+			kept++;
+		}
+
+		catalog.close();
+
+		// the frames written after the last catalog flush are found from their names, which start with their timestamp
+		// (followed by the frameset id for playbacks), the frames of a frameset only differ by their stream.
+		QString previousFrameSetName;
+
+		for (QString const& file : framesFolder.entryList({"*.stevimg", "*" + ImageFrame::rawFrameExtension}, QDir::Files, QDir::Name)) {
+
+			// compared by frameset, the streams of a frameset do not sort in the order they are written.
+			if (frameSetNameOf(file) < lastFrameSetName or (!nextSessionStart.isEmpty() and file >= nextSessionStart) or cataloged.contains(file)) {
+				continue;
+			}
+
+			QString framePath = framesFolder.filePath(file);
+			QString baseName = QFileInfo(file).baseName();
+
+			SessionCatalog::Entry entry;
+
+			if (!checkFrameFile(framePath, entry)) {
+				QFile::remove(framePath);
+				removed++;
+				continue;
+			}
+
+			QString timestamp = baseName.left(frameTimestampFormat.size());
+			QString frameSetName = frameSetNameOf(file);
+
+			if (frameSetName != previousFrameSetName) {
+				// the missing frames of the last cataloged frameset keep its id.
+				if (frameSetName != lastFrameSetName or lastFrameSetId < 0) {
+					lastFrameSetId++;
+				}
+				previousFrameSetName = frameSetName;
+			}
+
+			entry.frameSetId = lastFrameSetId;
+			entry.stream = baseName.mid(baseName.lastIndexOf('_') + 1);
+			entry.fileName = framesFolder.relativeFilePath(framePath);
+			entry.timeMs = QDateTime::fromString(timestamp, frameTimestampFormat).toMSecsSinceEpoch();
+
+			recoveredCatalog += SessionCatalog::encodeLine(entry);
+			recovered++;
+			changed = true;
+		}
+
+		if (changed) {
+
+			QSaveFile rewritten(catalogPath);
+
+			if (!rewritten.open(QIODevice::WriteOnly) or rewritten.write(recoveredCatalog) != recoveredCatalog.size() or !rewritten.commit()) {
+				QTextStream err(stderr);
+				err << "Failed to rewrite the session catalog " << catalogPath << endl;
+				return;
+			}
+		}
+	}
+
+	report.keptFrames += kept;
+	report.recoveredFrames += recovered;
+	report.removedFrames += removed;
+
+	if (journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		QByteArray record = recoveredRecord + '\t' + QByteArray::number(kept) + '\t' + QByteArray::number(recovered) + '\t' + QByteArray::number(removed) + '\n';
+		journal.write(record);
+		journal.flush();
+		fdatasync(journal.handle());
+		journal.close();
+	}
+}
@@ -0,0 +1,137 @@
+#ifndef SESSIONJOURNAL_H
+#define SESSIONJOURNAL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <QFile>
+#include <QDir>
+
+#include <functional>
+
+/*!
+ * \brief The SessionJournal class make the frames of a recording session durable in batches, and record the progress.
+ *
+ * The written frames are accumulated, and a checkpoint is taken from a dedicated thread every checkpointFrames frames
+ * or checkpointIntervalMs ms: the frames written since the last checkpoint and the session files (catalog, infos tables,
+ * timing file) are synced to disk, then a checkpoint record giving the number of durable catalog records is appended
+ * to the journal. The data lost by a crash is bounded by the checkpoint cadence, and so is the cost of the syncs.
+ *
+ * The journal is a text file, stored next to the session catalog, with one tab separated record per line:
+ * open, file (a session file, relative to the output folder), checkpoint, close and recovered.
+ * A session whose journal has no close record has been interrupted, recoverSessions repairs it.
+ */
+class SessionJournal : public QThread
+{
+	Q_OBJECT
+public:
+
+	static const QString journalExtension;
+
+	struct Config {
+
+		Config() :
+			durability("fdatasync"),
+			checkpointFrames(256),
+			checkpointIntervalMs(1000)
+		{
+
+		}
+
+		QString durability; //!< "fdatasync" (each written file), "syncfs" (the whole file system at once) or "none".
+		int checkpointFrames;
+		int checkpointIntervalMs;
+	};
+
+	struct RecoveryReport {
+		int sessions;
+		qint64 keptFrames; //!< the cataloged frames which have been kept.
+		qint64 recoveredFrames; //!< the complete frames which were missing from the catalogs, and have been added.
+		qint64 removedFrames; //!< the partially written frames, which have been removed.
+		int truncatedFiles; //!< the session files which ended with a partial record.
+	};
+
+	/*!
+	 * \brief CheckpointCallback flush the session files to the system, and give the number of records of the catalog.
+	 *
+	 * A negative value means the session files could not be flushed, the checkpoint is then skipped.
+	 * The records of the catalog must only reference frames which have been notified to frameWritten before.
+	 */
+	using CheckpointCallback = std::function<qint64()>;
+
+	explicit SessionJournal(QString const& journalPath, Config const& config, QObject *parent = nullptr);
+	~SessionJournal();
+
+	static QString journalPathForSession(QDir const& outputFolder, QString const& sessionId);
+
+	void setCheckpointCallback(CheckpointCallback const& callback);
+
+	/*!
+	 * \brief open create the journal and start the checkpoints.
+	 * \param firstFrameName the name the first frame of the session cannot precede, used to find the frames missing from the catalog on recovery.
+	 */
+	bool open(QString const& firstFrameName);
+
+	/*!
+	 * \brief addSessionFile register a text file of the session, synced at each checkpoint and repaired on recovery.
+	 */
+	void addSessionFile(QString const& filePath);
+
+	/*!
+	 * \brief frameWritten notify that a frame has been completely written (from any thread).
+	 */
+	void frameWritten(QString const& framePath, bool ok);
+	/*!
+	 * \brief frameRemoved notify that a written frame has been removed (e.g. exported), it is not synced by the next checkpoint.
+	 */
+	void frameRemoved(QString const& framePath);
+
+	/*!
+	 * \brief close take a last checkpoint, then mark the session as complete.
+	 */
+	void close();
+
+	qint64 durableFrames() const;
+
+	virtual void run();
+
+	/*!
+	 * \brief recoverSessions repair the sessions recorded in outputFolder which have been interrupted.
+	 *
+	 * The partial records at the end of the session files are truncated, the catalog records following the last
+	 * checkpoint are checked, the partially written frames are removed, and the complete frames missing from the
+	 * catalog are added to it.
+	 */
+	static RecoveryReport recoverSessions(QDir const& outputFolder);
+
+protected:
+
+	bool checkpoint();
+	bool appendRecord(QByteArray const& record);
+
+	/*!
+	 * \brief syncFile sync the data of a file, a file which does not exist anymore needs no sync and is not an error.
+	 */
+	static bool syncFile(QString const& path);
+	static bool syncFileSystem(QString const& path);
+
+	static void recoverSession(QString const& journalPath, QString const& nextSessionStart, RecoveryReport & report);
+
+	Config _config;
+	CheckpointCallback _checkpointCallback;
+
+	QDir _framesFolder;
+
+	mutable QMutex _mutex;
+	QWaitCondition _workAvailable;
+	QStringList _written; //!< the frames written since the last checkpoint.
+	QStringList _sessionFiles;
+	qint64 _durableFrames;
+	bool _continue;
+
+	QMutex _fileMutex;
+	QFile _file;
+};
+
+#endif // SESSIONJOURNAL_H
@@ -0,0 +1,260 @@
+#include "simulatedcamera.h"
+
+#include "sessioncatalog.h"
+
+#include <QDir>
+#include <QMap>
+
+#include <thread>
+#include <vector>
+
+const int SimulatedCamera::nPatternFrames = 16;
+const int SimulatedCamera::maxReplayPreload = 64;
+
+SimulatedCamera::SimulatedCamera(Config const& config) :
+	_config(config),
+	_frameIndex(0),
+	_lateFrames(0)
+{
+	double fps = (_config.fps > 0) ? _config.fps : 30;
+	_period = std::chrono::nanoseconds(static_cast<qint64>(1e9/fps));
+
+	if (_config.source == Replay) {
+		listReplayFiles();
+	} else {
+		generatePattern();
+	}
+}
+
+bool SimulatedCamera::start() {
+
+	if (!isValid()) {
+		return false;
+	}
+
+	_frameIndex = 0;
+	_lateFrames = 0;
+	_startTime = std::chrono::steady_clock::now();
+
+	return true;
+}
+
+bool SimulatedCamera::treatNextFrame(FrameSetCallback const& callback) {
+
+	if (!isValid()) {
+		return false;
+	}
+
+	std::chrono::steady_clock::time_point due = _startTime + _frameIndex*_period;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	if (now < due) {
+		std::this_thread::sleep_until(due);
+	} else if (now - due > _period) {
+		// the consumer is too slow, restart the schedule from now instead of producing a burst of frames.
+		_lateFrames++;
+		_startTime = now - _frameIndex*_period;
+	}
+
+	if (!_frameSets.isEmpty()) {
+		FrameSet const& frameSet = _frameSets[_frameIndex % _frameSets.size()];
+		callback(frameSet.frameLeft, frameSet.frameRight, frameSet.frameRGB);
+	} else {
+		FrameSet frameSet = loadReplayFrameSet(_replayFiles[_frameIndex % _replayFiles.size()]);
+		callback(frameSet.frameLeft, frameSet.frameRight, frameSet.frameRGB);
+	}
+
+	_frameIndex++;
+
+	return true;
+}
+
+bool SimulatedCamera::stop() {
+	return true;
+}
+
+qint64 SimulatedCamera::lateFrames() const {
+	return _lateFrames;
+}
+
+void SimulatedCamera::generatePattern() {
+
+	const int h = _config.height;
+	const int w = _config.width;
+
+	if (h <= 0 or w <= 0) {
+		return;
+	}
+
+	std::vector<uint8_t> gray8(h*w);
+	std::vector<uint16_t> gray16(h*w);
+	std::vector<uint8_t> rgb(h*w*3);
+
+	_frameSets.reserve(nPatternFrames);
+
+	for (int k = 0; k < nPatternFrames; k++) {
+
+		FrameSet frameSet;
+
+		for (int stereoView = 0; stereoView < 2; stereoView++) {
+
+			const int shift = 4*k + 8*stereoView; //moving pattern, with a constant disparity between the two views.
+
+			ImageFrame frame;
+
+			if (_config.nirFormat == Y8) {
+				for (int i = 0; i < h; i++) {
+					for (int j = 0; j < w; j++) {
+						gray8[i*w + j] = static_cast<uint8_t>((i/4 + j + shift) ^ (i/16)*8);
+					}
+				}
+				frame = ImageFrame(gray8.data(),
+								   Multidim::Array<uint8_t,2>::ShapeBlock{h,w},
+								   Multidim::Array<uint8_t,2>::ShapeBlock{w,1},
+								   true);
+			} else if (_config.nirFormat == Y16) {
+				for (int i = 0; i < h; i++) {
+					for (int j = 0; j < w; j++) {
+						gray16[i*w + j] = static_cast<uint16_t>(((i/4 + j + shift)*97) & 0xFFFF);
+					}
+				}
+				frame = ImageFrame(gray16.data(),
+								   Multidim::Array<uint16_t,2>::ShapeBlock{h,w},
+								   Multidim::Array<uint16_t,2>::ShapeBlock{w,1},
+								   true);
+			}
+
+			if (stereoView == 0) {
+				frameSet.frameLeft = frame;
+			} else {
+				frameSet.frameRight = frame;
+			}
+		}
+
+		if (_config.withRgb) {
+			for (int i = 0; i < h; i++) {
+				for (int j = 0; j < w; j++) {
+					rgb[(i*w + j)*3] = static_cast<uint8_t>(j + 4*k);
+					rgb[(i*w + j)*3 + 1] = static_cast<uint8_t>(i);
+					rgb[(i*w + j)*3 + 2] = static_cast<uint8_t>((i + j)/2 + 4*k);
+				}
+			}
+			frameSet.frameRGB = ImageFrame(rgb.data(),
+										   Multidim::Array<uint8_t,3>::ShapeBlock{h,w,3},
+										   Multidim::Array<uint8_t,3>::ShapeBlock{3*w,3,1},
+										   true);
+		}
+
+		_frameSets.push_back(frameSet);
+	}
+}
+
+void SimulatedCamera::listReplayFiles() {
+
+	QDir folder(_config.replayFolder);
+
+	if (!folder.exists()) {
+		return;
+	}
+
+	QStringList catalogs = SessionCatalog::listCatalogs(folder);
+
+	if (!catalogs.isEmpty()) {
+		listCatalogReplayFiles(catalogs);
+	} else {
+		listFolderReplayFiles(folder);
+	}
+
+	if (_replayFiles.size() <= maxReplayPreload) {
+		for (ReplayFiles const& files : _replayFiles) {
+			_frameSets.push_back(loadReplayFrameSet(files));
+		}
+		_replayFiles.clear();
+	}
+}
+
+void SimulatedCamera::listCatalogReplayFiles(QStringList const& catalogs) {
+
+	for (QString const& catalogPath : catalogs) {
+
+		SessionCatalog::Index index;
+
+		if (!index.load(catalogPath)) {
+			continue;
+		}
+
+		for (qint64 frameSetId : index.frameSetIds()) {
+
+			ReplayFiles files;
+
+			for (SessionCatalog::Entry const& entry : index.frameSet(frameSetId)) {
+
+				QString path = index.framePath(entry);
+
+				if (entry.stream == "left") {
+					files.frameLeft = path;
+				} else if (entry.stream == "right") {
+					files.frameRight = path;
+				} else if (entry.stream == "rgb") {
+					files.frameRGB = path;
+				}
+			}
+
+			if (!files.frameLeft.isEmpty() or !files.frameRight.isEmpty() or !files.frameRGB.isEmpty()) {
+				_replayFiles.push_back(files);
+			}
+		}
+	}
+}
+
+void SimulatedCamera::listFolderReplayFiles(QDir const& folder) {
+
+	QStringList files = folder.entryList({"*.stevimg", "*" + ImageFrame::rawFrameExtension}, QDir::Files, QDir::Name);
+
+	QMap<QString, ReplayFiles> frameSets;
+
+	for (QString const& file : files) {
+
+		QString base = file.left(file.lastIndexOf('.'));
+		int streamSep = base.lastIndexOf('_');
+
+		if (streamSep < 0) {
+			continue;
+		}
+
+		QString frameSetId = base.left(streamSep);
+		QString stream = base.mid(streamSep+1);
+		QString path = folder.filePath(file);
+
+		if (stream == "left") {
+			frameSets[frameSetId].frameLeft = path;
+		} else if (stream == "right") {
+			frameSets[frameSetId].frameRight = path;
+		} else if (stream == "rgb") {
+			frameSets[frameSetId].frameRGB = path;
+		}
+	}
+
+	for (ReplayFiles const& files : frameSets) {
+		_replayFiles.push_back(files);
+	}
+}
+
+SimulatedCamera::FrameSet SimulatedCamera::loadReplayFrameSet(ReplayFiles const& files) const {
+
+	FrameSet ret;
+
+	if (!files.frameLeft.isEmpty()) {
+		ret.frameLeft = ImageFrame(files.frameLeft);
+	}
+
+	if (!files.frameRight.isEmpty()) {
+		ret.frameRight = ImageFrame(files.frameRight);
+	}
+
+	if (!files.frameRGB.isEmpty()) {
+		ret.frameRGB = ImageFrame(files.frameRGB);
+	}
+
+	return ret;
+}
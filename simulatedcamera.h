@@ -0,0 +1,112 @@
+#ifndef SIMULATEDCAMERA_H
+#define SIMULATEDCAMERA_H
+
+#include <QString>
+#include <QStringList>
+#include <QDir>
+#include <QVector>
+
+#include <chrono>
+#include <functional>
+
+#include "./imageframe.h"
+
+/*!
+ * \brief The SimulatedCamera class produce framesets without any hardware.
+ *
+ * It either generates synthetic patterns or replays the frames recorded in a folder,
+ * at a fixed rate. It is used to test and benchmark the acquisition pipeline on machines without a camera.
+ */
+class SimulatedCamera
+{
+public:
+
+	enum Source {
+		Pattern,
+		Replay
+	};
+
+	enum NirFormat {
+		NoNir,
+		Y8,
+		Y16
+	};
+
+	struct Config {
+
+		Config() :
+			source(Pattern),
+			replayFolder(),
+			nirFormat(Y8),
+			withRgb(true),
+			width(848),
+			height(480),
+			fps(30)
+		{
+
+		}
+
+		Source source;
+		QString replayFolder;
+
+		NirFormat nirFormat;
+		bool withRgb;
+		int width;
+		int height;
+
+		double fps;
+	};
+
+	using FrameSetCallback = std::function<void(ImageFrame const& frameLeft, ImageFrame const& frameRight, ImageFrame const& frameRGB)>;
+
+	static const int nPatternFrames;
+	static const int maxReplayPreload;
+
+	SimulatedCamera(Config const& config);
+
+	inline bool isValid() const { return !_frameSets.isEmpty() or !_replayFiles.isEmpty(); }
+
+	bool start();
+	/*!
+	 * \brief treatNextFrame wait until the next frameset is due, then call the callback with it.
+	 * \return false if no frameset could be produced.
+	 */
+	bool treatNextFrame(FrameSetCallback const& callback);
+	bool stop();
+
+	qint64 lateFrames() const;
+
+protected:
+
+	struct FrameSet {
+		ImageFrame frameLeft;
+		ImageFrame frameRight;
+		ImageFrame frameRGB;
+	};
+
+	struct ReplayFiles {
+		QString frameLeft;
+		QString frameRight;
+		QString frameRGB;
+	};
+
+	void generatePattern();
+	void listReplayFiles();
+	void listCatalogReplayFiles(QStringList const& catalogs);
+	void listFolderReplayFiles(QDir const& folder);
+
+	FrameSet loadReplayFrameSet(ReplayFiles const& files) const;
+
+	Config _config;
+
+	QVector<FrameSet> _frameSets;
+	QVector<ReplayFiles> _replayFiles;
+
+	qint64 _frameIndex;
+	qint64 _lateFrames;
+
+	std::chrono::steady_clock::time_point _startTime;
+	std::chrono::nanoseconds _period;
+};
+
+#endif // SIMULATEDCAMERA_H
@@ -0,0 +1,197 @@
+#include "statusdashboard.h"
+
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "recordingmonitor.h"
+
+namespace {
+
+const QStringList headers = {"source", "stream", "fps", "saved/s", "saved", "failed", "dropped",
+							 "queues c/w/x", "write MB/s", "free MB", "remaining", "state"};
+
+QString formatRate(qint64 count, qint64 previousCount, qint64 ms) {
+
+	if (ms <= 0 or count < previousCount) {
+		return "-"; //no previous status, or the counters have been reset.
+	}
+
+	return QString::number((count - previousCount)*1000.0/ms, 'f', 1);
+}
+
+} // namespace
+
+StatusSnapshot::StatusSnapshot() :
+	timeMs(0),
+	saving(false),
+	droppedFramesets(0),
+	captureQueued(0),
+	writesInFlight(0),
+	exportPending(0),
+	writeBytesPerSecond(0),
+	freeBytes(0),
+	remainingSeconds(-1),
+	sustainable(true)
+{
+
+}
+
+QString StatusSnapshot::toLine() const {
+
+	QStringList fields;
+
+	fields << ((saving) ? "y" : "n")
+		   << QString::number(droppedFramesets)
+		   << QString::number(captureQueued)
+		   << QString::number(writesInFlight)
+		   << QString::number(exportPending)
+		   << QString::number(static_cast<qint64>(writeBytesPerSecond))
+		   << QString::number(freeBytes/(1024*1024))
+		   << QString::number((remainingSeconds < 0) ? -1 : static_cast<qint64>(remainingSeconds))
+		   << ((sustainable) ? "s" : "u");
+
+	for (Stream const& stream : streams) {
+		fields << QString("%1:%2:%3:%4").arg(stream.name).arg(stream.captured).arg(stream.saved).arg(stream.failed);
+	}
+
+	return fields.join(' ');
+}
+
+bool StatusSnapshot::fromLine(QString const& line, qint64 timeMs, StatusSnapshot & snapshot) {
+
+	QStringList fields = line.split(' ', QString::SkipEmptyParts);
+
+	if (fields.size() < 9) {
+		return false;
+	}
+
+	bool ok = true;
+	bool fieldOk;
+
+	snapshot = StatusSnapshot();
+	snapshot.timeMs = timeMs;
+	snapshot.saving = fields[0] == "y";
+	snapshot.droppedFramesets = fields[1].toLongLong(&fieldOk); ok = ok and fieldOk;
+	snapshot.captureQueued = fields[2].toLongLong(&fieldOk); ok = ok and fieldOk;
+	snapshot.writesInFlight = fields[3].toLongLong(&fieldOk); ok = ok and fieldOk;
+	snapshot.exportPending = fields[4].toLongLong(&fieldOk); ok = ok and fieldOk;
+	snapshot.writeBytesPerSecond = fields[5].toDouble(&fieldOk); ok = ok and fieldOk;
+	snapshot.freeBytes = fields[6].toLongLong(&fieldOk)*1024*1024; ok = ok and fieldOk;
+	snapshot.remainingSeconds = fields[7].toDouble(&fieldOk); ok = ok and fieldOk;
+	snapshot.sustainable = fields[8] == "s";
+
+	for (int i = 9; i < fields.size(); i++) {
+
+		QStringList values = fields[i].split(':');
+
+		if (values.size() != 4) {
+			return false;
+		}
+
+		Stream stream;
+		stream.name = values[0];
+		stream.captured = values[1].toLongLong(&fieldOk); ok = ok and fieldOk;
+		stream.saved = values[2].toLongLong(&fieldOk); ok = ok and fieldOk;
+		stream.failed = values[3].toLongLong(&fieldOk); ok = ok and fieldOk;
+
+		snapshot.streams.push_back(stream);
+	}
+
+	return ok;
+}
+
+void StatusDashboard::addSource(QString const& source, StatusSnapshot const& snapshot) {
+
+	StatusSnapshot previous = _previous.value(source);
+	qint64 elapsedMs = (previous.timeMs > 0) ? snapshot.timeMs - previous.timeMs : 0;
+
+	_previous.insert(source, snapshot);
+
+	QStringList sourceColumns;
+	sourceColumns << QString::number(snapshot.droppedFramesets)
+				  << QString("%1/%2/%3").arg(snapshot.captureQueued).arg(snapshot.writesInFlight).arg(snapshot.exportPending)
+				  << ((snapshot.writeBytesPerSecond > 0) ? QString::number(snapshot.writeBytesPerSecond/(1024*1024), 'f', 1) : "-")
+				  << QString::number(snapshot.freeBytes/(1024*1024))
+				  << formatDuration(snapshot.remainingSeconds)
+				  << QString((snapshot.saving) ? "saving" : "idle") + ((snapshot.sustainable) ? "" : ", unsustainable");
+
+	bool first = true;
+
+	for (StatusSnapshot::Stream const& stream : snapshot.streams) {
+
+		if (stream.captured == 0 and stream.saved == 0 and stream.failed == 0) {
+			continue; //the stream is not enabled.
+		}
+
+		StatusSnapshot::Stream previousStream = {stream.name, 0, 0, 0};
+
+		for (StatusSnapshot::Stream const& candidate : previous.streams) {
+			if (candidate.name == stream.name) {
+				previousStream = candidate;
+			}
+		}
+
+		QStringList row;
+		row << ((first) ? source : "")
+			<< stream.name
+			<< formatRate(stream.captured, previousStream.captured, elapsedMs)
+			<< formatRate(stream.saved, previousStream.saved, elapsedMs)
+			<< QString::number(stream.saved)
+			<< QString::number(stream.failed);
+
+		if (first) {
+			row << sourceColumns;
+		}
+
+		_rows.push_back(row);
+		first = false;
+	}
+
+	if (first) { //no frames received yet.
+		_rows.push_back(QStringList() << source << "-" << "-" << "-" << "0" << "0" << sourceColumns);
+	}
+}
+
+void StatusDashboard::addUnavailableSource(QString const& source, QString const& reason) {
+	_rows.push_back(QStringList() << source << reason);
+}
+
+void StatusDashboard::print(QTextStream & out) {
+
+	QVector<int> widths(headers.size());
+
+	for (int i = 0; i < headers.size(); i++) {
+		widths[i] = headers[i].size();
+	}
+
+	for (QStringList const& row : _rows) {
+		// the reason of an unavailable source spans the whole line.
+		if (row.size() > 2) {
+			for (int i = 0; i < row.size(); i++) {
+				widths[i] = std::max(widths[i], row[i].size());
+			}
+		}
+	}
+
+	auto printRow = [&out, &widths] (QStringList const& row) {
+		for (int i = 0; i < row.size(); i++) {
+			out << ((i < row.size() - 1) ? row[i].leftJustified(widths[i]) + "  " : row[i]);
+		}
+		out << "\n";
+	};
+
+	printRow(headers);
+
+	for (QStringList const& row : _rows) {
+		printRow(row);
+	}
+
+	out << flush;
+
+	_rows.clear();
+}
+
+void StatusDashboard::forget(QString const& source) {
+	_previous.remove(source);
+}
@@ -0,0 +1,83 @@
+#ifndef STATUSDASHBOARD_H
+#define STATUSDASHBOARD_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+
+class QTextStream;
+
+/*!
+ * \brief The StatusSnapshot struct hold the counters and gauges of a recorder at a given time.
+ *
+ * The counters are cumulative, the rates are computed by the StatusDashboard from two snapshots,
+ * so that a snapshot can be sent as is to any number of remote viewers.
+ */
+struct StatusSnapshot {
+
+	struct Stream {
+		QString name;
+		qint64 captured;
+		qint64 saved;
+		qint64 failed;
+	};
+
+	StatusSnapshot();
+
+	/*!
+	 * \brief toLine serialize the snapshot, without its time, for the remote status action.
+	 *
+	 * format is: <saving y/n> <dropped framesets> <capture queued> <writes in flight> <export pending> <write B/s>
+	 * <free MB> <remaining s, -1 if unknown> <sustainable s/u> [<stream>:<captured>:<saved>:<failed> ...]
+	 */
+	QString toLine() const;
+	/*!
+	 * \brief fromLine parse a line written by toLine.
+	 * \return false if the line is malformed.
+	 */
+	static bool fromLine(QString const& line, qint64 timeMs, StatusSnapshot & snapshot);
+
+	qint64 timeMs;
+	bool saving;
+	QVector<Stream> streams;
+	qint64 droppedFramesets;
+	qint64 captureQueued;
+	qint64 writesInFlight;
+	qint64 exportPending;
+	double writeBytesPerSecond; //!< 0 if unknown
+	qint64 freeBytes;
+	double remainingSeconds; //!< negative if unknown
+	bool sustainable;
+};
+
+/*!
+ * \brief The StatusDashboard class format the status of several recorders in a single table.
+ *
+ * The frame rates are computed from the previous snapshot of the same source, so they are only known
+ * from the second status of a source on.
+ */
+class StatusDashboard
+{
+public:
+
+	void addSource(QString const& source, StatusSnapshot const& snapshot);
+	void addUnavailableSource(QString const& source, QString const& reason);
+
+	/*!
+	 * \brief print print the table of the sources added since the last print.
+	 */
+	void print(QTextStream & out);
+
+	/*!
+	 * \brief forget drop the previous snapshot of a source, e.g. after it disconnected.
+	 */
+	void forget(QString const& source);
+
+protected:
+
+	QMap<QString, StatusSnapshot> _previous;
+	QVector<QStringList> _rows;
+};
+
+#endif // STATUSDASHBOARD_H
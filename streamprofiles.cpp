@@ -0,0 +1,375 @@
+#include "streamprofiles.h"
+
+#include <librealsense2/rs.hpp>
+
+#include <QSettings>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+namespace {
+
+struct StreamSource {
+	rs2_stream type;
+	int index;
+};
+
+StreamSource streamSource(StreamProfiles::Stream stream) {
+	switch (stream) {
+	case StreamProfiles::Left:
+		return {RS2_STREAM_INFRARED, 1};
+	case StreamProfiles::Right:
+		return {RS2_STREAM_INFRARED, 2};
+	case StreamProfiles::Rgb:
+		return {RS2_STREAM_COLOR, -1};
+	case StreamProfiles::Depth:
+		return {RS2_STREAM_DEPTH, -1};
+	}
+	return {RS2_STREAM_ANY, -1};
+}
+
+rs2_format rsFormat(QString const& format) {
+	if (format == "y8") {
+		return RS2_FORMAT_Y8;
+	}
+	if (format == "y16") {
+		return RS2_FORMAT_Y16;
+	}
+	if (format == "rgb8") {
+		return RS2_FORMAT_RGB8;
+	}
+	if (format == "z16") {
+		return RS2_FORMAT_Z16;
+	}
+	return RS2_FORMAT_ANY;
+}
+
+QString formatName(rs2_format format) {
+	switch (format) {
+	case RS2_FORMAT_Y8:
+		return "y8";
+	case RS2_FORMAT_Y16:
+		return "y16";
+	case RS2_FORMAT_RGB8:
+		return "rgb8";
+	case RS2_FORMAT_Z16:
+		return "z16";
+	default:
+		break;
+	}
+	return "";
+}
+
+bool sourceMatches(StreamSource const& source, rs2::video_stream_profile const& profile) {
+
+	if (profile.stream_type() != source.type) {
+		return false;
+	}
+
+	return source.index < 0 or profile.stream_index() == source.index;
+}
+
+} // namespace
+
+QList<StreamProfiles::Stream> StreamProfiles::streams() {
+	return {Left, Right, Rgb, Depth};
+}
+
+QString StreamProfiles::streamName(Stream stream) {
+	switch (stream) {
+	case Left:
+		return "left";
+	case Right:
+		return "right";
+	case Rgb:
+		return "rgb";
+	case Depth:
+		return "depth";
+	}
+	return "";
+}
+
+bool StreamProfiles::streamFromName(QString const& name, Stream & stream) {
+
+	for (Stream s : streams()) {
+		if (streamName(s) == name.trimmed().toLower()) {
+			stream = s;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+StreamProfiles::Config StreamProfiles::defaults() {
+
+	QSettings settings;
+	int fps = settings.value("realsense/fps", 30).toInt();
+	int width = settings.value("realsense/width", 848).toInt();
+	int height = settings.value("realsense/height", 480).toInt();
+
+	settings.setValue("realsense/fps", fps);
+	settings.setValue("realsense/width", width);
+	settings.setValue("realsense/height", height);
+
+	Config config;
+
+	for (Stream stream : streams()) {
+		config[stream].width = width;
+		config[stream].height = height;
+		config[stream].fps = fps;
+	}
+
+	config[Rgb].format = "rgb8";
+
+	config[Depth].format = "z16";
+	config[Depth].enabled = false;
+
+	return config;
+}
+
+StreamProfiles::Config StreamProfiles::load(QString const& serial) {
+
+	Config config = defaults();
+
+	QSettings settings;
+	QString prefix = "realsense/devices/" + serial + "/";
+
+	for (Stream stream : streams()) {
+
+		QString key = prefix + streamName(stream);
+
+		if (!settings.contains(key)) {
+			continue;
+		}
+
+		Profile profile;
+
+		if (parseProfile(settings.value(key).toString(), profile) and isSupportedFormat(stream, profile.format)) {
+			config[stream] = profile;
+		}
+	}
+
+	store(serial, config);
+
+	return config;
+}
+
+void StreamProfiles::store(QString const& serial, Config const& config) {
+
+	QSettings settings;
+	QString prefix = "realsense/devices/" + serial + "/";
+
+	for (Stream stream : streams()) {
+		settings.setValue(prefix + streamName(stream), profileToString(config[stream]));
+	}
+}
+
+bool StreamProfiles::parseProfile(QString const& txt, Profile & profile) {
+
+	QString simplified = txt.simplified().toLower();
+
+	if (simplified == "off") {
+		profile.enabled = false;
+		return true;
+	}
+
+	static const QRegularExpression expr("^([a-z0-9]+) ([0-9]+)x([0-9]+)@([0-9]+)$");
+	QRegularExpressionMatch match = expr.match(simplified);
+
+	if (!match.hasMatch()) {
+		return false;
+	}
+
+	Profile parsed;
+	parsed.enabled = true;
+	parsed.format = match.captured(1);
+	parsed.width = match.captured(2).toInt();
+	parsed.height = match.captured(3).toInt();
+	parsed.fps = match.captured(4).toInt();
+
+	if (rsFormat(parsed.format) == RS2_FORMAT_ANY or parsed.width <= 0 or parsed.height <= 0 or parsed.fps <= 0) {
+		return false;
+	}
+
+	profile = parsed;
+	return true;
+}
+
+QString StreamProfiles::profileToString(Profile const& profile) {
+
+	if (!profile.enabled) {
+		return "off";
+	}
+
+	return QString("%1 %2x%3@%4").arg(profile.format).arg(profile.width).arg(profile.height).arg(profile.fps);
+}
+
+QString StreamProfiles::configToString(Config const& config) {
+
+	QStringList items;
+
+	for (Stream stream : streams()) {
+		items << streamName(stream) + "=" + profileToString(config[stream]);
+	}
+
+	return items.join(';');
+}
+
+bool StreamProfiles::isSupportedFormat(Stream stream, QString const& format) {
+
+	if (stream == Rgb) {
+		return format == "rgb8";
+	}
+
+	if (stream == Depth) {
+		return format == "z16";
+	}
+
+	return format == "y8" or format == "y16";
+}
+
+QStringList StreamProfiles::deviceProfiles(QString const& serial, Stream stream) {
+
+	QStringList ret;
+	rs2::device device;
+
+	if (!findDevice(serial, device)) {
+		return ret;
+	}
+
+	StreamSource source = streamSource(stream);
+
+	for (rs2::sensor const& sensor : device.query_sensors()) {
+		for (rs2::stream_profile const& p : sensor.get_stream_profiles()) {
+
+			if (!p.is<rs2::video_stream_profile>()) {
+				continue;
+			}
+
+			rs2::video_stream_profile vp = p.as<rs2::video_stream_profile>();
+
+			if (!sourceMatches(source, vp) or !isSupportedFormat(stream, formatName(vp.format()))) {
+				continue;
+			}
+
+			Profile profile;
+			profile.format = formatName(vp.format());
+			profile.width = vp.width();
+			profile.height = vp.height();
+			profile.fps = vp.fps();
+
+			QString txt = profileToString(profile);
+
+			if (!ret.contains(txt)) {
+				ret << txt;
+			}
+		}
+	}
+
+	return ret;
+}
+
+bool StreamProfiles::validate(QString const& serial, Config const& config, QString & error) {
+
+	if (enabledStreamsCount(config) == 0) {
+		error = "No stream enabled";
+		return false;
+	}
+
+	for (Stream stream : streams()) {
+		if (config[stream].enabled and !isSupportedFormat(stream, config[stream].format)) {
+			error = QString("Format %1 is not supported for the %2 stream").arg(config[stream].format).arg(streamName(stream));
+			return false;
+		}
+	}
+
+	// the infrared and depth streams come from the same stereo sensor, which runs in a single mode.
+	Profile const* stereoMode = nullptr;
+
+	for (Stream stream : {Left, Right, Depth}) {
+
+		Profile const& profile = config[stream];
+
+		if (!profile.enabled) {
+			continue;
+		}
+
+		if (stereoMode == nullptr) {
+			stereoMode = &profile;
+		} else if (profile.width != stereoMode->width or profile.height != stereoMode->height or profile.fps != stereoMode->fps) {
+			error = "The left, right and depth streams must have the same resolution and frame rate";
+			return false;
+		}
+	}
+
+	rs2::device device;
+
+	if (!findDevice(serial, device)) {
+		error = QString("RealSense device %1 is not connected").arg(serial);
+		return false;
+	}
+
+	for (Stream stream : streams()) {
+
+		if (!config[stream].enabled) {
+			continue;
+		}
+
+		QStringList available = deviceProfiles(serial, stream);
+		QString requested = profileToString(config[stream]);
+
+		if (!available.contains(requested)) {
+			error = QString("Device %1 does not support %2 for the %3 stream").arg(serial).arg(requested).arg(streamName(stream));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void StreamProfiles::enableStreams(rs2::config & rsConfig, Config const& config) {
+
+	for (Stream stream : streams()) {
+
+		Profile const& profile = config[stream];
+
+		if (!profile.enabled) {
+			continue;
+		}
+
+		StreamSource source = streamSource(stream);
+		rsConfig.enable_stream(source.type, source.index, profile.width, profile.height, rsFormat(profile.format), profile.fps);
+	}
+}
+
+int StreamProfiles::enabledStreamsCount(Config const& config) {
+	return static_cast<int>(std::count_if(config.profiles.begin(), config.profiles.end(), [] (Profile const& p) { return p.enabled; }));
+}
+
+int StreamProfiles::maxFps(Config const& config) {
+
+	int fps = 0;
+
+	for (Profile const& profile : config.profiles) {
+		if (profile.enabled) {
+			fps = std::max(fps, profile.fps);
+		}
+	}
+
+	return fps;
+}
+
+bool StreamProfiles::findDevice(QString const& serial, rs2::device & device) {
+
+	rs2::context ctx;
+
+	for (rs2::device const& dev : ctx.query_devices()) {
+		if (dev.supports(RS2_CAMERA_INFO_SERIAL_NUMBER) and serial == dev.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER)) {
+			device = dev;
+			return true;
+		}
+	}
+
+	return false;
+}
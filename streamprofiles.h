@@ -0,0 +1,105 @@
+#ifndef STREAMPROFILES_H
+#define STREAMPROFILES_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+#include <array>
+
+namespace rs2 {
+	class config;
+	class device;
+}
+
+/*!
+ * \brief The StreamProfiles class describe which RealSense streams are captured, and with which format, resolution and frame rate.
+ *
+ * The profiles are stored per device, in the realsense/devices/<serial>/<stream> settings, as text like "y16 1280x720@30" or "off".
+ * Devices without stored profiles use the realsense/width, realsense/height and realsense/fps settings for the infrared and color streams,
+ * the depth stream is disabled by default.
+ */
+class StreamProfiles
+{
+public:
+
+	enum Stream {
+		Left = 0,
+		Right = 1,
+		Rgb = 2,
+		Depth = 3
+	};
+
+	static const int StreamCount = 4;
+
+	struct Profile {
+
+		Profile() :
+			enabled(true),
+			format("y8"),
+			width(848),
+			height(480),
+			fps(30)
+		{
+
+		}
+
+		bool enabled;
+		QString format; //!< "y8" or "y16" for the infrared streams, "rgb8" for the color stream, "z16" for the depth stream.
+		int width;
+		int height;
+		int fps;
+	};
+
+	struct Config {
+
+		inline Profile& operator[](Stream stream) { return profiles[stream]; }
+		inline Profile const& operator[](Stream stream) const { return profiles[stream]; }
+
+		std::array<Profile, StreamCount> profiles;
+	};
+
+	static QList<Stream> streams();
+
+	static QString streamName(Stream stream);
+	static bool streamFromName(QString const& name, Stream & stream);
+
+	/*!
+	 * \brief defaults give the profiles used for devices without stored profiles.
+	 */
+	static Config defaults();
+
+	static Config load(QString const& serial);
+	static void store(QString const& serial, Config const& config);
+
+	/*!
+	 * \brief parseProfile parse a profile like "y8 848x480@30", or "off".
+	 */
+	static bool parseProfile(QString const& txt, Profile & profile);
+	static QString profileToString(Profile const& profile);
+	static QString configToString(Config const& config);
+
+	static bool isSupportedFormat(Stream stream, QString const& format);
+
+	/*!
+	 * \brief deviceProfiles list the profiles a connected device offers for a stream, in the formats the recorder can treat.
+	 */
+	static QStringList deviceProfiles(QString const& serial, Stream stream);
+
+	/*!
+	 * \brief validate check that a connected device can stream a configuration.
+	 * \param error set to a description of the problem when the configuration is not valid.
+	 */
+	static bool validate(QString const& serial, Config const& config, QString & error);
+
+	static void enableStreams(rs2::config & rsConfig, Config const& config);
+
+	static int enabledStreamsCount(Config const& config);
+	static int maxFps(Config const& config);
+
+protected:
+
+	static bool findDevice(QString const& serial, rs2::device & device);
+};
+
+#endif // STREAMPROFILES_H
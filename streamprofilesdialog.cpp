@@ -0,0 +1,53 @@
+#include "streamprofilesdialog.h"
+
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QVBoxLayout>
+
+StreamProfilesDialog::StreamProfilesDialog(QString const& serial, QWidget *parent) :
+	QDialog(parent),
+	_serial(serial),
+	_config(StreamProfiles::load(serial))
+{
+	setWindowTitle(QString("Stream profiles of %1").arg(serial));
+
+	QFormLayout* form = new QFormLayout();
+
+	for (StreamProfiles::Stream stream : StreamProfiles::streams()) {
+
+		QComboBox* box = new QComboBox(this);
+		box->addItem("off");
+		box->addItems(StreamProfiles::deviceProfiles(serial, stream));
+
+		QString current = StreamProfiles::profileToString(_config[stream]);
+
+		if (box->findText(current) < 0) { //keep the stored profile visible, even if the device does not offer it.
+			box->addItem(current);
+		}
+
+		box->setCurrentText(current);
+
+		form->addRow(StreamProfiles::streamName(stream), box);
+		_profilesBoxes.insert(stream, box);
+	}
+
+	QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+	connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+	connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	layout->addLayout(form);
+	layout->addWidget(buttons);
+}
+
+StreamProfiles::Config StreamProfilesDialog::config() const {
+
+	StreamProfiles::Config config = _config;
+
+	for (StreamProfiles::Stream stream : StreamProfiles::streams()) {
+		StreamProfiles::parseProfile(_profilesBoxes.value(stream)->currentText(), config[stream]);
+	}
+
+	return config;
+}
@@ -0,0 +1,31 @@
+#ifndef STREAMPROFILESDIALOG_H
+#define STREAMPROFILESDIALOG_H
+
+#include <QDialog>
+#include <QMap>
+
+#include "./streamprofiles.h"
+
+class QComboBox;
+
+/*!
+ * \brief The StreamProfilesDialog class let the user choose the profile of each stream of a RealSense camera,
+ * among the profiles supported by the device.
+ */
+class StreamProfilesDialog : public QDialog
+{
+	Q_OBJECT
+public:
+	explicit StreamProfilesDialog(QString const& serial, QWidget *parent = nullptr);
+
+	StreamProfiles::Config config() const;
+
+protected:
+
+	QString _serial;
+	StreamProfiles::Config _config;
+
+	QMap<StreamProfiles::Stream, QComboBox*> _profilesBoxes;
+};
+
+#endif // STREAMPROFILESDIALOG_H
@@ -0,0 +1,307 @@
+/*
+ * Stress tests of the inter-thread frame queues.
+ *
+ * The queues are exercised with each waiting strategy, with small capacities so that the indices wrap around
+ * many times. Configure with -DsanitizeThreads=ON so that ThreadSanitizer checks the memory ordering of the queues
+ * while the tests run.
+ *
+ * Example: framequeuetest
+ */
+
+#include "framequeue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<int> nFailures(0); //checks also fail from the producer threads.
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			nFailures++; \
+		} \
+	} while (false)
+
+const QueueWaiter::Strategy strategies[] = {QueueWaiter::Spin, QueueWaiter::Yield, QueueWaiter::Block};
+
+char const* strategyName(QueueWaiter::Strategy strategy) {
+
+	switch (strategy) {
+	case QueueWaiter::Spin:
+		return "spin";
+	case QueueWaiter::Yield:
+		return "yield";
+	case QueueWaiter::Block:
+		return "block";
+	}
+
+	return "unknown";
+}
+
+/*!
+ * \brief itemsPerProducer give the number of items pushed by each producer.
+ *
+ * Spinning threads only hand over the cpu when they are preempted, so fewer items are used on machines with few cores.
+ */
+int itemsPerProducer(QueueWaiter::Strategy strategy, int nThreads) {
+
+	if (strategy == QueueWaiter::Spin and std::thread::hardware_concurrency() < static_cast<unsigned int>(nThreads)) {
+		return 2000;
+	}
+
+	return 50000;
+}
+
+/*!
+ * \brief encodeItem pack the producer index and the item index, so that the consumer can check the order per producer.
+ */
+uint64_t encodeItem(int producer, int index) {
+	return (static_cast<uint64_t>(producer) << 32) | static_cast<uint32_t>(index);
+}
+
+/*!
+ * \brief checkFifo pop until the queue is closed and check that each producer's items have been received once each, in order.
+ */
+template<typename Queue>
+void checkFifo(Queue & queue, int nProducers, int nItems) {
+
+	std::vector<int> next(nProducers, 0);
+	int received = 0;
+	uint64_t item;
+
+	while (queue.pop(item)) {
+
+		int producer = static_cast<int>(item >> 32);
+		int index = static_cast<int>(item & 0xFFFFFFFF);
+
+		CHECK(producer >= 0 and producer < nProducers);
+
+		if (producer < 0 or producer >= nProducers) {
+			continue;
+		}
+
+		CHECK(index == next[producer]); //a gap is a lost item, a smaller index a duplicated one.
+		next[producer] = index + 1;
+		received++;
+	}
+
+	CHECK(received == nProducers*nItems);
+
+	for (int producer = 0; producer < nProducers; producer++) {
+		CHECK(next[producer] == nItems);
+	}
+}
+
+void testSpscFifo(QueueWaiter::Strategy strategy) {
+
+	const int nItems = itemsPerProducer(strategy, 2);
+	SpscQueue<uint64_t> queue(8, strategy);
+
+	std::thread producer([&queue, nItems] () {
+		for (int i = 0; i < nItems; i++) {
+			CHECK(queue.push(encodeItem(0, i)));
+		}
+		queue.close();
+	});
+
+	checkFifo(queue, 1, nItems);
+
+	producer.join();
+}
+
+void testMpscFifo(QueueWaiter::Strategy strategy) {
+
+	const int nProducers = 4;
+	const int nItems = itemsPerProducer(strategy, nProducers+1);
+	MpscQueue<uint64_t> queue(8, strategy);
+
+	std::atomic<int> running(nProducers);
+	std::vector<std::thread> producers;
+
+	for (int p = 0; p < nProducers; p++) {
+		producers.emplace_back([&queue, &running, p, nItems] () {
+			for (int i = 0; i < nItems; i++) {
+				CHECK(queue.push(encodeItem(p, i)));
+			}
+			if (--running == 0) {
+				queue.close();
+			}
+		});
+	}
+
+	checkFifo(queue, nProducers, nItems);
+
+	for (std::thread & producer : producers) {
+		producer.join();
+	}
+}
+
+template<typename Queue>
+void testClose(QueueWaiter::Strategy strategy) {
+
+	{
+		Queue queue(8, strategy);
+
+		for (int i = 0; i < 5; i++) {
+			CHECK(queue.push(encodeItem(0, i)));
+		}
+
+		queue.close();
+
+		CHECK(queue.isClosed());
+		CHECK(!queue.push(encodeItem(0, 5)));
+
+		uint64_t item;
+
+		for (int i = 0; i < 5; i++) {
+			CHECK(queue.pop(item, 1000));
+			CHECK(item == encodeItem(0, i));
+		}
+
+		// the remaining items have been drained, pop must return at once instead of waiting.
+		auto start = std::chrono::steady_clock::now();
+		CHECK(!queue.pop(item));
+		CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+	}
+
+	{ //close wakes up a consumer waiting without time limit.
+		Queue queue(8, strategy);
+		bool popped = true;
+
+		std::thread consumer([&queue, &popped] () {
+			uint64_t item;
+			popped = queue.pop(item);
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		queue.close();
+		consumer.join();
+
+		CHECK(!popped);
+	}
+
+	{ //close wakes up a producer waiting for a free slot.
+		Queue queue(2, strategy);
+		bool pushed = true;
+
+		CHECK(queue.push(encodeItem(0, 0)));
+		CHECK(queue.push(encodeItem(0, 1)));
+
+		std::thread producer([&queue, &pushed] () {
+			pushed = queue.push(encodeItem(0, 2));
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		queue.close();
+		producer.join();
+
+		CHECK(!pushed);
+	}
+}
+
+template<typename Queue>
+void testTimeouts(QueueWaiter::Strategy strategy) {
+
+	const auto timeout = std::chrono::milliseconds(50);
+
+	Queue queue(2, strategy);
+	uint64_t item;
+
+	auto start = std::chrono::steady_clock::now();
+	CHECK(!queue.pop(item, timeout.count()));
+	CHECK(std::chrono::steady_clock::now() - start >= timeout);
+
+	CHECK(queue.push(encodeItem(0, 0), 0));
+	CHECK(queue.push(encodeItem(0, 1), 0));
+
+	start = std::chrono::steady_clock::now();
+	CHECK(!queue.push(encodeItem(0, 2), timeout.count()));
+	CHECK(std::chrono::steady_clock::now() - start >= timeout);
+
+	// a timed out push leaves the queue unchanged.
+	CHECK(queue.pop(item, 0));
+	CHECK(item == encodeItem(0, 0));
+	CHECK(queue.pop(item, 0));
+	CHECK(item == encodeItem(0, 1));
+	CHECK(!queue.pop(item, 0));
+
+	// an item pushed while the consumer waits is received before the timeout.
+	std::thread producer([&queue] () {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		queue.push(encodeItem(0, 3));
+	});
+
+	CHECK(queue.pop(item, 10000));
+	CHECK(item == encodeItem(0, 3));
+
+	producer.join();
+}
+
+/*!
+ * \brief testSizeApprox check that the size read from a third thread stays within the capacity while the queue is used.
+ */
+template<typename Queue>
+void testSizeApprox(QueueWaiter::Strategy strategy) {
+
+	const int nItems = itemsPerProducer(strategy, 3);
+	Queue queue(4, strategy);
+
+	std::atomic<bool> done(false);
+
+	std::thread observer([&queue, &done] () {
+		while (!done) {
+			CHECK(queue.sizeApprox() <= queue.capacity());
+		}
+	});
+
+	std::thread producer([&queue, nItems] () {
+		for (int i = 0; i < nItems; i++) {
+			CHECK(queue.push(encodeItem(0, i)));
+		}
+		queue.close();
+	});
+
+	checkFifo(queue, 1, nItems);
+
+	producer.join();
+	done = true;
+	observer.join();
+
+	CHECK(queue.sizeApprox() == 0);
+}
+
+} // namespace
+
+int main() {
+
+	for (QueueWaiter::Strategy strategy : strategies) {
+
+		std::printf("%s strategy\n", strategyName(strategy));
+
+		testSpscFifo(strategy);
+		testMpscFifo(strategy);
+
+		testClose<SpscQueue<uint64_t>>(strategy);
+		testClose<MpscQueue<uint64_t>>(strategy);
+
+		testTimeouts<SpscQueue<uint64_t>>(strategy);
+		testTimeouts<MpscQueue<uint64_t>>(strategy);
+
+		testSizeApprox<SpscQueue<uint64_t>>(strategy);
+		testSizeApprox<MpscQueue<uint64_t>>(strategy);
+	}
+
+	if (nFailures > 0) {
+		std::printf("%d checks failed\n", nFailures.load());
+		return 1;
+	}
+
+	std::printf("all checks passed\n");
+	return 0;
+}
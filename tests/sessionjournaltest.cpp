@@ -0,0 +1,154 @@
+/*
+ * Tests of the session journal checkpoints and recovery.
+ *
+ * The incremental exporter removes the recorded frames while the recording goes on, sometimes before the checkpoint
+ * which syncs them. The checkpoints must not fail for those frames, otherwise the session is never marked as closed
+ * and the recovery later rewrites its catalog. The recovery of an interrupted session is checked too.
+ *
+ * Example: sessionjournaltest
+ */
+
+#include "sessionjournal.h"
+#include "sessioncatalog.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <cstdio>
+
+namespace {
+
+int nFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			nFailures++; \
+		} \
+	} while (false)
+
+bool writeFrame(QString const& path) {
+
+	QFile frame(path);
+
+	if (!frame.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	return frame.write(QByteArray(1024, '\x5a')) == 1024;
+}
+
+QByteArray lastRecord(QString const& journalPath) {
+
+	QFile journal(journalPath);
+
+	if (!journal.open(QIODevice::ReadOnly)) {
+		return QByteArray();
+	}
+
+	QList<QByteArray> lines = journal.readAll().trimmed().split('\n');
+	return lines.last();
+}
+
+void testFramesRemovedBeforeCheckpoint() {
+
+	QTemporaryDir folder;
+	CHECK(folder.isValid());
+
+	QDir outputFolder(folder.path());
+	QString journalPath = SessionJournal::journalPathForSession(outputFolder, "2024_01_01_00_00_00_000");
+
+	SessionJournal::Config config;
+	config.durability = "fdatasync";
+	config.checkpointFrames = 1000;
+	config.checkpointIntervalMs = 60000; //the only checkpoint is the one taken by close.
+
+	SessionJournal journal(journalPath, config);
+	CHECK(journal.open("2024_01_01_00_00_00_000"));
+
+	QStringList frames;
+
+	for (int i = 0; i < 4; i++) {
+		frames << outputFolder.filePath(QString("2024_01_01_00_00_00_%1_left.stevimg").arg(i + 1, 3, 10, QChar('0')));
+		CHECK(writeFrame(frames.last()));
+		journal.frameWritten(frames.last(), true);
+	}
+
+	// exported and notified, then exported without notification (as when the checkpoint already took the frame).
+	CHECK(QFile::remove(frames[0]));
+	journal.frameRemoved(frames[0]);
+	CHECK(QFile::remove(frames[1]));
+
+	journal.close();
+
+	CHECK(lastRecord(journalPath).startsWith("close"));
+	CHECK(journal.durableFrames() == 3);
+
+	SessionJournal::RecoveryReport report = SessionJournal::recoverSessions(outputFolder);
+	CHECK(report.sessions == 0);
+	CHECK(QFile::exists(frames[2]));
+	CHECK(QFile::exists(frames[3]));
+}
+
+void testRecoverLastFrameSet() {
+
+	QTemporaryDir folder;
+	CHECK(folder.isValid());
+
+	QDir outputFolder(folder.path());
+	QString sessionId = "2024_01_01_00_00_00_000";
+	QString journalPath = SessionJournal::journalPathForSession(outputFolder, sessionId);
+	QString catalogPath = SessionCatalog::catalogPathForSession(outputFolder, sessionId);
+
+	// an interrupted session: the left frame of the last frameset is cataloged, its depth frame is not.
+	outputFolder.mkpath(SessionCatalog::catalogsFolderName);
+
+	QFile journal(journalPath);
+	CHECK(journal.open(QIODevice::WriteOnly));
+	journal.write("open\t" + sessionId.toUtf8() + "\t0\n");
+	journal.close();
+
+	QString frameSetName = "2024_01_01_00_00_00_001";
+	CHECK(writeFrame(outputFolder.filePath(frameSetName + "_left.stevimg")));
+	CHECK(writeFrame(outputFolder.filePath(frameSetName + "_depth.stevimg")));
+
+	SessionCatalog::Entry entry;
+	entry.frameSetId = 0;
+	entry.stream = "left";
+	entry.fileName = frameSetName + "_left.stevimg";
+
+	QFile catalog(catalogPath);
+	CHECK(catalog.open(QIODevice::WriteOnly));
+	catalog.write(SessionCatalog::encodeLine(entry));
+	catalog.close();
+
+	SessionJournal::RecoveryReport report = SessionJournal::recoverSessions(outputFolder);
+	CHECK(report.sessions == 1);
+	CHECK(report.keptFrames == 1);
+	CHECK(report.recoveredFrames == 1); //the depth frame sorts before the cataloged left frame.
+
+	SessionCatalog::Index index;
+	CHECK(index.load(catalogPath));
+	CHECK(index.entries().size() == 2);
+
+	for (SessionCatalog::Entry const& recovered : index.entries()) {
+		CHECK(recovered.frameSetId == 0);
+	}
+}
+
+} // namespace
+
+int main() {
+
+	testFramesRemovedBeforeCheckpoint();
+	testRecoverLastFrameSet();
+
+	if (nFailures > 0) {
+		std::printf("%d checks failed\n", nFailures);
+		return 1;
+	}
+
+	std::printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,242 @@
+#include "threadtuning.h"
+
+#include <QSettings>
+#include <QStringList>
+#include <QTextStream>
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include <algorithm>
+
+QString ThreadTuning::roleName(Role role) {
+	switch (role) {
+	case Grabber:
+		return "grabber";
+	case Writer:
+		return "writer";
+	case Network:
+		return "network";
+	case Exporter:
+		return "exporter";
+	}
+	return "";
+}
+
+bool ThreadTuning::roleFromName(QString const& name, Role & role) {
+
+	for (Role r : {Grabber, Writer, Network, Exporter}) {
+		if (roleName(r) == name.trimmed().toLower()) {
+			role = r;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+ThreadTuning::Config ThreadTuning::load(Role role) {
+
+	Config config;
+
+	if (role == Exporter) {
+		config.policy = "idle";
+	}
+
+	QSettings settings;
+	QString prefix = "threads/" + roleName(role) + "/";
+
+	QString cpus = settings.value(prefix + "cpus", "all").toString();
+	config.policy = settings.value(prefix + "policy", config.policy).toString().toLower();
+	config.priority = settings.value(prefix + "priority", config.priority).toInt();
+
+	if (!parseCpuList(cpus, config.cpus)) {
+		QTextStream err(stderr);
+		err << "Invalid cpu list " << cpus << " for the " << roleName(role) << " thread, using all cpus" << endl;
+		config.cpus.clear();
+	}
+
+	if (!isValidPolicy(config.policy)) {
+		QTextStream err(stderr);
+		err << "Invalid scheduling policy " << config.policy << " for the " << roleName(role) << " thread, using other" << endl;
+		config.policy = "other";
+	}
+
+	store(role, config);
+
+	return config;
+}
+
+void ThreadTuning::store(Role role, Config const& config) {
+
+	QSettings settings;
+	QString prefix = "threads/" + roleName(role) + "/";
+
+	settings.setValue(prefix + "cpus", cpuListToString(config.cpus));
+	settings.setValue(prefix + "policy", config.policy);
+	settings.setValue(prefix + "priority", config.priority);
+}
+
+bool ThreadTuning::parseCpuList(QString const& txt, QVector<int> & cpus) {
+
+	cpus.clear();
+
+	QString list = txt.trimmed().toLower();
+
+	if (list.isEmpty() or list == "all") {
+		return true;
+	}
+
+	for (QString const& item : list.split(',', QString::SkipEmptyParts)) {
+
+		QStringList bounds = item.split('-');
+		bool ok1 = false;
+		bool ok2 = false;
+
+		if (bounds.size() == 1) {
+			int cpu = bounds[0].toInt(&ok1);
+			if (!ok1 or cpu < 0 or cpu >= CPU_SETSIZE) {
+				return false;
+			}
+			cpus.push_back(cpu);
+		} else if (bounds.size() == 2) {
+			int first = bounds[0].toInt(&ok1);
+			int last = bounds[1].toInt(&ok2);
+			if (!ok1 or !ok2 or first < 0 or last < first or last >= CPU_SETSIZE) {
+				return false;
+			}
+			for (int cpu = first; cpu <= last; cpu++) {
+				cpus.push_back(cpu);
+			}
+		} else {
+			return false;
+		}
+	}
+
+	std::sort(cpus.begin(), cpus.end());
+	cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+	return true;
+}
+
+QString ThreadTuning::cpuListToString(QVector<int> const& cpus) {
+
+	if (cpus.isEmpty()) {
+		return "all";
+	}
+
+	QStringList items;
+
+	for (int cpu : cpus) {
+		items << QString::number(cpu);
+	}
+
+	return items.join(',');
+}
+
+bool ThreadTuning::isValidPolicy(QString const& policy) {
+	return policy == "other" or policy == "fifo" or policy == "rr" or policy == "idle";
+}
+
+bool ThreadTuning::applyToCurrentThread(Role role) {
+
+	Config config = load(role);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	bool ok = true;
+	pthread_t self = pthread_self();
+
+	// the name is limited to 15 characters by the kernel.
+	pthread_setname_np(self, QString("rsnir-" + roleName(role)).left(15).toLatin1().constData());
+
+	if (!config.cpus.isEmpty()) {
+
+		cpu_set_t cpuset;
+		CPU_ZERO(&cpuset);
+
+		for (int cpu : config.cpus) {
+			CPU_SET(cpu, &cpuset);
+		}
+
+		int code = pthread_setaffinity_np(self, sizeof(cpu_set_t), &cpuset);
+
+		if (code != 0) {
+			err << "Could not pin the " << roleName(role) << " thread to cpus " << cpuListToString(config.cpus) << ": " << strerror(code) << endl;
+			ok = false;
+		}
+	}
+
+	if (config.policy != "other") {
+
+		int policy = SCHED_RR;
+
+		if (config.policy == "fifo") {
+			policy = SCHED_FIFO;
+		} else if (config.policy == "idle") {
+			policy = SCHED_IDLE;
+		}
+
+		sched_param param;
+		param.sched_priority = std::max(sched_get_priority_min(policy), std::min(sched_get_priority_max(policy), config.priority));
+
+		int code = pthread_setschedparam(self, policy, &param);
+
+		if (code != 0) {
+			err << "Could not set the " << config.policy << " scheduling policy (priority " << param.sched_priority << ") for the "
+				<< roleName(role) << " thread: " << strerror(code) << endl;
+			ok = false;
+		}
+	}
+
+	out << "Thread " << roleName(role) << ": " << describeCurrentThread() << endl;
+
+	return ok;
+}
+
+QString ThreadTuning::describeCurrentThread() {
+
+	pthread_t self = pthread_self();
+
+	int policy;
+	sched_param param;
+	QString policyName = "unknown";
+	int priority = 0;
+
+	if (pthread_getschedparam(self, &policy, &param) == 0) {
+		switch (policy) {
+		case SCHED_OTHER:
+			policyName = "other";
+			break;
+		case SCHED_FIFO:
+			policyName = "fifo";
+			break;
+		case SCHED_RR:
+			policyName = "rr";
+			break;
+		case SCHED_IDLE:
+			policyName = "idle";
+			break;
+		default:
+			break;
+		}
+		priority = param.sched_priority;
+	}
+
+	QVector<int> cpus;
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+
+	if (pthread_getaffinity_np(self, sizeof(cpu_set_t), &cpuset) == 0) {
+		int nCpus = CPU_COUNT(&cpuset);
+		for (int cpu = 0; cpu < CPU_SETSIZE and cpus.size() < nCpus; cpu++) {
+			if (CPU_ISSET(cpu, &cpuset)) {
+				cpus.push_back(cpu);
+			}
+		}
+	}
+
+	return QString("policy %1, priority %2, cpus %3").arg(policyName).arg(priority).arg(cpus.isEmpty() ? QString("unknown") : cpuListToString(cpus));
+}
@@ -0,0 +1,69 @@
+#ifndef THREADTUNING_H
+#define THREADTUNING_H
+
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief The ThreadTuning class configure the cpu affinity and the scheduling policy of the application threads.
+ *
+ * The configuration of each thread role is read from the settings (threads/<role>/cpus, threads/<role>/policy and threads/<role>/priority),
+ * and applied by the thread itself when it starts. Real time policies usually require CAP_SYS_NICE or an rtprio limit,
+ * when they are not permitted the thread keeps the default policy and the failure is reported.
+ * The exporter thread uses the idle policy by default, so that it only runs on cpu time the capture does not need.
+ */
+class ThreadTuning
+{
+public:
+
+	enum Role {
+		Grabber,
+		Writer,
+		Network,
+		Exporter
+	};
+
+	struct Config {
+
+		Config() :
+			cpus(),
+			policy("other"),
+			priority(0)
+		{
+
+		}
+
+		QVector<int> cpus; //!< empty means all the cpus.
+		QString policy; //!< "other", "fifo", "rr" or "idle".
+		int priority; //!< the real time priority, for the fifo and rr policies.
+	};
+
+	static QString roleName(Role role);
+	static bool roleFromName(QString const& name, Role & role);
+
+	static Config load(Role role);
+	static void store(Role role, Config const& config);
+
+	/*!
+	 * \brief parseCpuList parse a list of cpus like "2,4-6", or "all" (which gives an empty list).
+	 */
+	static bool parseCpuList(QString const& txt, QVector<int> & cpus);
+	static QString cpuListToString(QVector<int> const& cpus);
+
+	static bool isValidPolicy(QString const& policy);
+
+	/*!
+	 * \brief applyToCurrentThread apply the configuration of role to the calling thread, and print the policy actually applied.
+	 *
+	 * The thread is also named rsnir-<role>, so that its cpu time can be told apart in the metrics.
+	 * \return true if the configuration could be fully applied.
+	 */
+	static bool applyToCurrentThread(Role role);
+
+	/*!
+	 * \brief describeCurrentThread give the scheduling policy, priority and cpus of the calling thread.
+	 */
+	static QString describeCurrentThread();
+};
+
+#endif // THREADTUNING_H
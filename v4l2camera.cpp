@@ -11,8 +11,8 @@
 #include <sys/mman.h>
 
 #include <QDir>
-#include <QTextStream>
-#include <QDebug>
+
+#include "logging.h"
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
 
@@ -238,11 +238,9 @@ bool V4L2Camera::init() {
 
 	struct v4l2_capability cap;
 
-	QTextStream err(stderr);
-
 	if (-1 == xioctl(_file_descriptor, VIDIOC_QUERYCAP, &cap)) {
 		if (EINVAL == errno) {
-			err << _descriptor.index << " " << _descriptor.name << " is not a valid V4L2 device" << endl;
+			qCWarning(lcCamera).noquote() << _descriptor.index << _descriptor.name << "is not a valid V4L2 device";
 			return false;
 		} else {
 			return false;
@@ -250,7 +248,7 @@ bool V4L2Camera::init() {
 	}
 
 	if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
-		err << _descriptor.index << " " << _descriptor.name << " is not a V4L2 capture device" << endl;
+		qCWarning(lcCamera).noquote() << _descriptor.index << _descriptor.name << "is not a V4L2 capture device";
 		return false;
 	}
 
@@ -376,8 +374,6 @@ bool V4L2Camera::init_streammode() {
 
 	struct v4l2_requestbuffers req;
 
-	QTextStream err(stderr);
-
 	CLEAR(req);
 
 	req.count = 4;
@@ -386,7 +382,7 @@ bool V4L2Camera::init_streammode() {
 
 	if (-1 == xioctl(_file_descriptor, VIDIOC_REQBUFS, &req)) {
 		if (EINVAL == errno) {
-			err << _descriptor.index << " " << _descriptor.name << " does not support memory mapping" << endl;
+			qCWarning(lcCamera).noquote() << _descriptor.index << _descriptor.name << "does not support memory mapping";
 			return false;
 		} else {
 			return false;
@@ -394,7 +390,7 @@ bool V4L2Camera::init_streammode() {
 	}
 
 	if (req.count < 2) {
-		err << "Insufficient buffer memory on " << _descriptor.index << " " << _descriptor.name;
+		qCCritical(lcCamera).noquote() << "Insufficient buffer memory on" << _descriptor.index << _descriptor.name;
 			exit(EXIT_FAILURE);
 		}
 
@@ -402,7 +398,7 @@ bool V4L2Camera::init_streammode() {
 	_n_buffers = req.count;
 
 	if (!_buffers) {
-		err << "Out of memory" << endl;
+		qCWarning(lcCamera) << "Out of memory";
 		return false;
 	}
 
@@ -450,16 +446,14 @@ void V4L2Camera::deinit_streammode() {
 
 bool V4L2Camera::set_viewArray(int height, int width, int colorSpaceCode, int colorFormat) {
 
-	QTextStream err(stderr);
-
 	if (colorSpaceCode == V4L2_COLORSPACE_JPEG) {
-		err << "Colorspace is jpg, which is not supported" << endl;
+		qCWarning(lcCamera) << "Colorspace is jpg, which is not supported";
 	}
 
 	int c;
 
 	QByteArray colorFormatCode(reinterpret_cast<char*>(&colorFormat), 4);
-	qDebug() << "configuring camera with colorspace" << colorFormatCode;
+	qCDebug(lcCamera) << "Configuring camera with color format" << colorFormatCode;
 
 	_colorSpace = QString::fromLocal8Bit(colorFormatCode);
 
@@ -470,7 +464,7 @@ bool V4L2Camera::set_viewArray(int height, int width, int colorSpaceCode, int co
 	} else if (colorFormat == V4L2_PIX_FMT_ABGR32 or colorFormat == V4L2_PIX_FMT_ARGB32) {
 		c = 4;
 	} else {
-		err << "Color format " << colorFormatCode << " is not supported" << endl;
+		qCWarning(lcCamera) << "Color format" << colorFormatCode << "is not supported";
 		return false;
 	}
 
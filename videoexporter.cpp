@@ -0,0 +1,262 @@
+#include "videoexporter.h"
+
+#include "frameencoders.h"
+#include "imageframe.h"
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+
+#include <algorithm>
+#include <vector>
+
+const QString VideoExporter::indexExtension = ".index";
+
+namespace {
+
+const double defaultFps = 30;
+
+cv::Mat wrapPixels(Multidim::Array<uint8_t, 2> & img) {
+
+	const int h = img.shape()[0];
+	const int w = img.shape()[1];
+
+	if (img.strides()[1] == 1) {
+		return cv::Mat(h, w, CV_8UC1, &img.atUnchecked(0,0), img.strides()[0]);
+	}
+
+	cv::Mat packed(h, w, CV_8UC1);
+
+	for (int i = 0; i < h; i++) {
+		for (int j = 0; j < w; j++) {
+			packed.ptr<uint8_t>(i)[j] = img.atUnchecked(i,j);
+		}
+	}
+
+	return packed;
+}
+
+cv::Mat wrapPixels(Multidim::Array<uint8_t, 3> & img) {
+
+	const int h = img.shape()[0];
+	const int w = img.shape()[1];
+	const int c = img.shape()[2];
+
+	if (img.strides()[2] == 1 and img.strides()[1] == c) {
+		return cv::Mat(h, w, CV_8UC(c), &img.atUnchecked(0,0,0), img.strides()[0]);
+	}
+
+	cv::Mat packed(h, w, CV_8UC(c));
+
+	for (int i = 0; i < h; i++) {
+		for (int j = 0; j < w; j++) {
+			for (int k = 0; k < c; k++) {
+				packed.ptr<uint8_t>(i)[j*c + k] = img.atUnchecked(i,j,k);
+			}
+		}
+	}
+
+	return packed;
+}
+
+bool toBgr(cv::Mat const& pixels, cv::Mat & bgr) {
+
+	switch (pixels.channels()) {
+	case 1:
+		cv::cvtColor(pixels, bgr, cv::COLOR_GRAY2BGR);
+		return true;
+	case 3:
+		cv::cvtColor(pixels, bgr, cv::COLOR_RGB2BGR);
+		return true;
+	case 4:
+		cv::cvtColor(pixels, bgr, cv::COLOR_RGBA2BGR);
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*!
+ * \brief loadBgr read a recorded 8 bits frame as a bgr image, the layout VideoWriter expects.
+ */
+bool loadBgr(QString const& path, cv::Mat & bgr) {
+
+	ImageFrame frame(path);
+
+	if (frame.grayscale8() != nullptr) {
+		return toBgr(wrapPixels(*frame.grayscale8()), bgr);
+	}
+
+	if (frame.multichannels8() == nullptr) {
+		return false;
+	}
+
+	FrameEncoders::ColorConversion convert = FrameEncoders::colorConversion(frame.additionalInfos().value(ImageFrame::colorSpaceKey));
+
+	if (!convert) {
+		return toBgr(wrapPixels(*frame.multichannels8()), bgr);
+	}
+
+	Multidim::Array<uint8_t, 3> rgb = convert(*frame.multichannels8());
+
+	if (rgb.empty()) {
+		return false;
+	}
+
+	return toBgr(wrapPixels(rgb), bgr);
+}
+
+QString uniqueBasePath(QString const& basePath, QString const& extension) {
+
+	// frames left by a previous export are encoded in a new video, the previous one is kept.
+	QString ret = basePath;
+
+	for (int i = 2; QFile::exists(ret + extension); i++) {
+		ret = basePath + "_" + QString::number(i);
+	}
+
+	return ret;
+}
+
+} // namespace
+
+VideoExporter::Config VideoExporter::Config::fromSettings() {
+
+	Config config;
+
+	QSettings settings;
+	QString fourcc = settings.value("export/video/fourcc", config.fourcc).toString();
+	QString extension = settings.value("export/video/extension", config.extension).toString().trimmed();
+	config.fps = std::max(0., settings.value("export/video/fps", config.fps).toDouble());
+
+	if (fourcc.size() == 4) {
+		config.fourcc = fourcc;
+	}
+
+	if (!extension.isEmpty()) {
+		config.extension = (extension.startsWith('.')) ? extension : "." + extension;
+	}
+
+	settings.setValue("export/video/fourcc", config.fourcc);
+	settings.setValue("export/video/extension", config.extension);
+	settings.setValue("export/video/fps", config.fps);
+
+	return config;
+}
+
+VideoExporter::VideoExporter(Config const& config) :
+	_config(config)
+{
+
+}
+
+bool VideoExporter::exportVideo(QVector<Frame> const& frames, QString const& videoBasePath, Result & result) const {
+
+	result.written = 0;
+	result.skipped = 0;
+	result.videoPath = uniqueBasePath(videoBasePath, _config.extension) + _config.extension;
+	result.error.clear();
+
+	if (frames.isEmpty()) {
+		result.error = "No frames to encode";
+		return false;
+	}
+
+	double fps = (_config.fps > 0) ? _config.fps : frameRate(frames);
+
+	if (fps <= 0) {
+		fps = defaultFps;
+	}
+
+	QByteArray fourcc = _config.fourcc.toLatin1();
+
+	cv::VideoWriter writer;
+	cv::Size size;
+	cv::Mat bgr;
+
+	QFile index(result.videoPath + indexExtension);
+	QTextStream indexStream;
+
+	QStringList encoded;
+
+	for (Frame const& frame : frames) {
+
+		if (!loadBgr(frame.path, bgr)) {
+			result.skipped++;
+			continue;
+		}
+
+		if (!writer.isOpened()) {
+
+			size = bgr.size();
+
+			if (!writer.open(result.videoPath.toStdString(), cv::VideoWriter::fourcc(fourcc[0], fourcc[1], fourcc[2], fourcc[3]), fps, size, true)) {
+				result.error = QString("Could not open a %1 video writer for %2").arg(_config.fourcc).arg(result.videoPath);
+				return false;
+			}
+
+			if (!index.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+				writer.release();
+				QFile::remove(result.videoPath);
+				result.error = QString("Could not write the video index %1").arg(index.fileName());
+				return false;
+			}
+
+			indexStream.setDevice(&index);
+		}
+
+		if (bgr.size() != size) {
+			result.skipped++;
+			continue;
+		}
+
+		writer.write(bgr);
+
+		indexStream << result.written << '\t' << frame.timeMs << '\t' << QFileInfo(frame.path).fileName() << '\n';
+		result.written++;
+
+		encoded << frame.path;
+	}
+
+	if (!writer.isOpened()) {
+		result.error = "None of the frames could be read";
+		return false;
+	}
+
+	writer.release();
+	indexStream.flush();
+	index.close();
+
+	for (QString const& path : encoded) {
+		QFile::remove(path);
+		QFile::remove(path + ".infos");
+	}
+
+	return true;
+}
+
+double VideoExporter::frameRate(QVector<Frame> const& frames) {
+
+	std::vector<qint64> intervals;
+	intervals.reserve(frames.size());
+
+	for (int i = 1; i < frames.size(); i++) {
+		qint64 interval = frames[i].timeMs - frames[i-1].timeMs;
+
+		if (interval > 0) {
+			intervals.push_back(interval);
+		}
+	}
+
+	if (intervals.empty()) {
+		return 0;
+	}
+
+	std::nth_element(intervals.begin(), intervals.begin() + intervals.size()/2, intervals.end());
+
+	return 1000./intervals[intervals.size()/2];
+}
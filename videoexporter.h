@@ -0,0 +1,71 @@
+#ifndef VIDEOEXPORTER_H
+#define VIDEOEXPORTER_H
+
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief The VideoExporter class encode the frames of a stream into a single video file, with OpenCV's VideoWriter.
+ *
+ * It is used for the streams whose export format is "video" (the rgb stream), for which reviewable footage is enough.
+ * The video has a constant frame rate, so the timestamps of the frames are kept in a side index, next to the video,
+ * with one tab separated line per frame: the frame number in the video, its timestamp (ms) and the recorded file name.
+ */
+class VideoExporter
+{
+public:
+
+	static const QString indexExtension;
+
+	struct Config {
+
+		Config() :
+			fourcc("MJPG"),
+			extension(".avi"),
+			fps(0)
+		{
+
+		}
+
+		/*!
+		 * \brief fromSettings load the configuration from the export/video/ settings (and write back the defaults).
+		 */
+		static Config fromSettings();
+
+		QString fourcc; //!< the codec, as a four characters code.
+		QString extension; //!< the container, from the extension of the video file.
+		double fps; //!< 0 means deduced from the frame timestamps.
+	};
+
+	struct Frame {
+		QString path;
+		qint64 timeMs;
+	};
+
+	struct Result {
+		int written;
+		int skipped; //!< the frames which could not be read, they are kept as recorded.
+		QString videoPath;
+		QString error;
+	};
+
+	explicit VideoExporter(Config const& config = Config());
+
+	/*!
+	 * \brief exportVideo encode frames into videoBasePath + the configured extension, then remove the frames which have been encoded.
+	 * \param frames the frames, in chronological order.
+	 * \return false if the video could not be written, the frames are then all kept.
+	 */
+	bool exportVideo(QVector<Frame> const& frames, QString const& videoBasePath, Result & result) const;
+
+	/*!
+	 * \brief frameRate give the median frame rate of a sequence of frames, or 0 if it cannot be deduced.
+	 */
+	static double frameRate(QVector<Frame> const& frames);
+
+protected:
+
+	Config _config;
+};
+
+#endif // VIDEOEXPORTER_H